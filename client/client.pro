@@ -2,7 +2,7 @@ QT += core gui network sql
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 QT += multimedia
 
-CONFIG += c++11
+CONFIG += c++17
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -10,7 +10,13 @@ CONFIG += c++11
 
 TARGET = client
 
+INCLUDEPATH += ../common
+
+include(../core/seabattle-core.pri)
+
 SOURCES += \
+    ../common/framedecoder.cpp \
+    ../common/protocol.cpp \
     controller.cpp \
     field.cpp \
     fightshistorywindow.cpp \
@@ -20,6 +26,8 @@ SOURCES += \
     model.cpp
 
 HEADERS += \
+    ../common/framedecoder.hpp \
+    ../common/protocol.hpp \
     config.hpp \
     constants.hpp \
     controller.hpp \
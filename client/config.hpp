@@ -15,4 +15,10 @@
 /// Путь к директории со звуками
 #define SOUNDS_DIRECTORY_PATH "/sounds/"
 
+/// Строк истории боёв в одной странице HISTORY:PAGE
+#define HISTORY_PAGE_SIZE 20
+
+/// За сколько строк до конца таблицы истории запрашивать следующую страницу
+#define HISTORY_PREFETCH_ROWS 5
+
 #endif // CONFIG_H
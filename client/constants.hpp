@@ -9,11 +9,13 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include "rules.hpp"
+
 /// Ширина игрового поля по умолчанию
-const int FIELD_WIDTH_DEFAULT  = 10;
+const int FIELD_WIDTH_DEFAULT  = Rules::WIDTH;
 
 /// Высота игрового поля по умолчанию
-const int FIELD_HEIGHT_DEFAULT = 10;
+const int FIELD_HEIGHT_DEFAULT = Rules::HEIGHT;
 
 /// Ширина изображения поля по умолчанию
 const int FIELD_IMG_WIDTH_DEFAULT  = 216;
@@ -45,19 +47,22 @@ const int ENEMYFIELD_IMG_REL_X = ENEMYFIELD_IMG_X;
 /// Относительная Y-координата изображения поля противника
 const int ENEMYFIELD_IMG_REL_Y = 39;
 
+/// Правила на выбор при начале игры (RuleSet), первые - классические
+const char* const GAME_RULES_PRESETS[] = { "10x10/4,3,2,1", "16x16/5,4,3,2,1", "30x30/12,9,6,3,2", "100x100/40,30,20,10,5,3,2,1" };
+
 /// Максимальная длина корабля
-const int SHIP_MAXLEN = 4;
+const int SHIP_MAXLEN = Rules::SHIP_LENGTH_MAX;
 
 /// Количество кораблей длиной 1
-const int SHIP1_NUM = 4;
+const int SHIP1_NUM = Rules::shipCount(1);
 
 /// Количество кораблей длиной 2
-const int SHIP2_NUM = 3;
+const int SHIP2_NUM = Rules::shipCount(2);
 
 /// Количество кораблей длиной 3
-const int SHIP3_NUM = 2;
+const int SHIP3_NUM = Rules::shipCount(3);
 
 /// Количество кораблей длиной 4
-const int SHIP4_NUM = 1;
+const int SHIP4_NUM = Rules::shipCount(4);
 
 #endif // CONSTANTS_H
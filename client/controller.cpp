@@ -9,6 +9,7 @@
 
 #include "controller.hpp"
 #include <QMouseEvent>
+#include <algorithm>
 
 /**
  * @brief Конструктор.
@@ -48,11 +49,12 @@ Controller::~Controller()
  * @brief Преобразование координат мыши в координаты поля.
  * @param pos Позиция мыши
  * @param owner Владелец поля (MY_FIELD или ENEMY_FIELD)
+ * @param field Поле (размер в клетках зависит от правил игры)
  * @return Координаты на поле или (-1, -1) если позиция вне поля
  * 
  * Преобразует координаты мыши в координаты на игровом поле с учетом смещения.
  */
-QPoint getFieldCoord(const QPoint& pos, Field::Owner owner)
+QPoint getFieldCoord(const QPoint& pos, Field::Owner owner, const Field& field)
 {
     QPoint res;
     res.setX(-1);
@@ -76,8 +78,8 @@ QPoint getFieldCoord(const QPoint& pos, Field::Owner owner)
        pos.y() < shift_y || pos.y() > (shift_y + FIELD_IMG_HEIGHT_DEFAULT)   )
         return res;
 
-    res.setX(1.0*FIELD_WIDTH_DEFAULT *(pos.x()-shift_x)/FIELD_IMG_WIDTH_DEFAULT );
-    res.setY(1.0*FIELD_HEIGHT_DEFAULT*(pos.y()-shift_y)/FIELD_IMG_HEIGHT_DEFAULT);
+    res.setX(std::min(field.getWidth()  - 1, (int)(1.0*field.getWidth() *(pos.x()-shift_x)/FIELD_IMG_WIDTH_DEFAULT )));
+    res.setY(std::min(field.getHeight() - 1, (int)(1.0*field.getHeight()*(pos.y()-shift_y)/FIELD_IMG_HEIGHT_DEFAULT)));
 
     qDebug() << "X: " << pos.x() - shift_x;
     qDebug() << "Y: " << pos.y() - shift_y;
@@ -106,7 +108,7 @@ void Controller::onMousePressed(const QPoint& pos, QMouseEvent* event, QLabel* a
 //                                 ||
 //       state == ST_WAITING_PLACING )
     {
-        QPoint point = getFieldCoord(pos, Field::MY_FIELD);
+        QPoint point = getFieldCoord(pos, Field::MY_FIELD, model_->getMyField());
 
         if( point.x() == -1 || point.y() == -1 )
             return;
@@ -155,7 +157,7 @@ void Controller::onMousePressed(const QPoint& pos, QMouseEvent* event, QLabel* a
 
     if(model_->getState() == ST_MAKING_STEP)
     {
-        QPoint point = getFieldCoord(pos, Field::ENEMY_FIELD);
+        QPoint point = getFieldCoord(pos, Field::ENEMY_FIELD, model_->getEnemyField());
         if(point.x() == -1 || point.y() == -1)
             return;
 
@@ -172,7 +174,10 @@ void Controller::onMousePressed(const QPoint& pos, QMouseEvent* event, QLabel* a
 
             QString shotMessage = "GAME:" + QString::number(model_->getGameId()) + ":" + model_->getLogin() + ":" + "SHOT:" + QString::number(point.x()) + ":" + QString::number(point.y()); // GAME:<gameId>:<my_login>:SHOT:<x>:<y>
 
-            socket_->write((shotMessage+"@").toUtf8());
+            if (model_->getProtocolVersion() >= PROTOCOL_VERSION_BINARY)
+                socket_->write(Protocol::encodeShot(model_->getGameId(), point.x(), point.y()));
+            else
+                socket_->write((shotMessage+"@").toUtf8());
             qDebug() << shotMessage;
         }
         else if (event->button() == Qt::RightButton)
@@ -211,7 +216,7 @@ void Controller::onMousePressed(const QPoint& pos, QMouseEvent* event, QLabel* a
 
     if(model_->getState() == ST_WAITING_STEP)
     {
-        QPoint point = getFieldCoord(pos, Field::ENEMY_FIELD);
+        QPoint point = getFieldCoord(pos, Field::ENEMY_FIELD, model_->getEnemyField());
         if(point.x() == -1 || point.y() == -1)
             return;
 
@@ -11,7 +11,7 @@
 #include <QPainter>
 #include "field.hpp"
 #include "images.hpp"
-#include "qmath.h"
+#include "protocol.hpp"
 #include <QDebug>
 
 /**
@@ -54,6 +54,7 @@ Field& Field::operator=(const Field& other)
     if (this == &other)
         return *this;
 
+    rules_      = other.rules_      ;
     width_      = other.width_      ;
     height_     = other.height_     ;
     area_       = other.area_       ;
@@ -134,14 +135,6 @@ void Field::setStateCell(int x, int y, CellState cell)
     qDebug() << "ERROR: no such cell (" << x << "," << y << ")";
 }
 
-void Field::setStateCell(int index_bordered, CellState cell)
-{
-    if(index_bordered < (width_ + 2) * (height_ + 2))
-    {
-        return;
-    }
-}
-
 QString Field::getStateFieldStr() const
 {
     QString result = "";
@@ -175,22 +168,22 @@ QVector<CellDraw> fieldDrawFromStr(QString fieldDrawStr)
 {
     QVector<CellDraw> fieldDraw;
 
-    if (fieldDrawStr.size() < FIELD_WIDTH_DEFAULT*FIELD_HEIGHT_DEFAULT)
+    // поле приходит упакованным по 3 бита на клетку (Protocol::encodeFieldDrawText)
+    if (!Protocol::decodeFieldDrawText(fieldDrawStr, fieldDraw))
     {
-        qDebug() << "Wrong fieldDrawStr size";
+        qDebug() << "fieldDrawFromStr(str): wrong string!";
+        fieldDraw.clear();
         return fieldDraw;
     }
 
-    for(QString::iterator cell_it = fieldDrawStr.begin(); cell_it != fieldDrawStr.end(); ++cell_it)
+    for (int i = 0; i < fieldDraw.size(); i++)
     {
-        if (cell_it->digitValue() < (int)CellDraw::CELL_EMPTY || cell_it->digitValue() > (int)CellDraw::CELL_MARK)
+        if (fieldDraw[i] > CellDraw::CELL_MARK)
         {
-            qDebug() << "fieldDrawFromStr(str): wrong string!";
+            qDebug() << "fieldDrawFromStr(str): wrong cell state!";
             fieldDraw.clear();
             break;
         }
-
-        fieldDraw.push_back((CellDraw)cell_it->digitValue());
     }
 
     return fieldDraw;
@@ -251,6 +244,15 @@ void Field::setDrawField(QVector<CellDraw> field)
     fieldDraw_ = field;
 }
 
+void Field::applyDrawRanges(const QVector<CellRange>& ranges)
+{
+    for (const CellRange& range : ranges)
+    {
+        for (int i = range.start_; i < range.start_ + range.count_ && i < fieldDraw_.size(); i++)
+            fieldDraw_[i] = (CellDraw)range.state_;
+    }
+}
+
 void Field::initMyDrawField()
 {
     fieldDraw_.clear();
@@ -286,15 +288,102 @@ int Field::getArea() const
     return area_;
 }
 
+void Field::setRules(const RuleSet& rules)
+{
+    rules_  = rules;
+    width_  = rules.getWidth();
+    height_ = rules.getHeight();
+    area_   = rules.getArea();
+
+    clear();
+
+    fieldImage_ = QImage();     // размер клетки на изображении изменился
+    paintedDraw_.clear();
+}
+
+const RuleSet& Field::getRules() const
+{
+    return rules_;
+}
+
+/**
+ * @brief Получение расстановки списком кораблей.
+ * @param ships Корабли расстановки
+ * @return false, если клетки не складываются в прямые корабли
+ *
+ * Корабль начинается с клетки, у которой нет соседа слева и сверху, и
+ * продолжается вправо или вниз. Клетки, не попавшие ни в один такой корабль
+ * (углы, кресты), означают неправильную расстановку.
+ */
+bool Field::getShips(std::vector<Ship>& ships) const
+{
+    auto isShip = [this](int x, int y)
+    {
+        return x >= 0 && y >= 0 && x < width_ && y < height_ && fieldState_[width_*y+x] != CL_ST_EMPTY;
+    };
+
+    ships.clear();
+    int decks = 0;
+    int covered = 0;
+
+    for (int y = 0; y < height_; y++)
+    {
+        for (int x = 0; x < width_; x++)
+        {
+            if (!isShip(x, y))
+                continue;
+
+            decks++;
+
+            if (isShip(x - 1, y) || isShip(x, y - 1))
+                continue;
+
+            bool vertical = isShip(x, y + 1);
+            int length = 1;
+            while (vertical ? isShip(x, y + length) : isShip(x + length, y))
+                length++;
+
+            ships.push_back(Ship{ x, y, length, vertical });
+            covered += length;
+        }
+    }
+
+    return covered == decks;
+}
+
+void Field::setShips(const std::vector<Ship>& ships)
+{
+    fieldState_.fill(CL_ST_EMPTY, area_);
+
+    for (const Ship& ship : ships)
+    {
+        for (int i = 0; i < ship.length_; i++)
+        {
+            int x = ship.x_ + (ship.vertical_ ? 0 : i);
+            int y = ship.y_ + (ship.vertical_ ? i : 0);
+
+            if (x >= 0 && y >= 0 && x < width_ && y < height_)
+                fieldState_[width_*y+x] = CL_ST_UNDEFINED;
+        }
+    }
+}
+
 QImage Field::getFieldImage()
 {
-    QImage image(FIELD_IMG_WIDTH_DEFAULT, FIELD_IMG_HEIGHT_DEFAULT, QImage::Format_ARGB32);
+    if (fieldImage_.isNull() || paintedDraw_.size() != fieldDraw_.size())
+    {
+        fieldImage_ = QImage(FIELD_IMG_WIDTH_DEFAULT, FIELD_IMG_HEIGHT_DEFAULT, QImage::Format_ARGB32);
+        fieldImage_.fill(0);  // empty image
+        paintedDraw_.fill(CELL_EMPTY, fieldDraw_.size());   // пустая клетка прозрачна, рисовать её не нужно
+    }
+
     CellDraw cell;
-    image.fill(0);  // empty image
-    QPainter painter(&image);
+    QPainter painter(&fieldImage_);
 
-    double cfx = 1.0 * FIELD_IMG_WIDTH_DEFAULT /FIELD_WIDTH_DEFAULT ;
-    double cfy = 1.0 * FIELD_IMG_HEIGHT_DEFAULT/FIELD_HEIGHT_DEFAULT;
+    // изображение одного размера при любых правилах, клетка сжимается под размер поля
+    double cfx = 1.0 * FIELD_IMG_WIDTH_DEFAULT /width_ ;
+    double cfy = 1.0 * FIELD_IMG_HEIGHT_DEFAULT/height_;
+    bool scaled = width_ != FIELD_WIDTH_DEFAULT || height_ != FIELD_HEIGHT_DEFAULT;
 
     for(int i = 0; i < width_; i++)
     {
@@ -302,38 +391,58 @@ QImage Field::getFieldImage()
         {
             cell = getCell(i, j);
 
+            if (cell == paintedDraw_[width_*j+i])   // клетка не менялась
+                continue;
+
             int x = i*cfx;
             int y = j*cfy;
+            QRect rect(x, y, (int)((i+1)*cfx) - x, (int)((j+1)*cfy) - y);
+
+            // картинки нарисованы под клетку классического поля, на других полях вписываем их в клетку
+            auto drawPicture = [&](const QString& name, int dy)
+            {
+                if (scaled)
+                    painter.drawImage(rect, pictures.get(name));
+                else
+                    painter.drawImage(x, y + dy, pictures.get(name));
+            };
+
+            // стираем прежнее состояние клетки
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(rect, Qt::transparent);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+            paintedDraw_[width_*j+i] = cell;
 
             switch(cell)
             {
             case CELL_DOT:
             {
-                painter.drawImage(x, y, pictures.get("dot"));
+                drawPicture("dot", 0);
                 break;
             }
 
             case CELL_LIVE:
             {
-                painter.drawImage(x, y, pictures.get("live"));
+                drawPicture("live", 0);
                 break;
             }
 
             case CELL_DAMAGED:
             {
-                painter.drawImage(x, y, pictures.get("damaged"));
+                drawPicture("damaged", 0);
                 break;
             }
 
             case CELL_KILLED:
             {
-                painter.drawImage(x, y, pictures.get("killed"));
+                drawPicture("killed", 0);
                 break;
             }
 
             case CELL_MARK:
             {
-                painter.drawImage(x, y+1, pictures.get("flag"));
+                drawPicture("flag", 1);
                 break;
             }
 
@@ -345,7 +454,7 @@ QImage Field::getFieldImage()
 
     painter.end();
 
-    return image;
+    return fieldImage_;
 }
 
 void Field::generate()
@@ -372,263 +481,42 @@ void Field::generate()
     qDebug() << "Generated field (draw ): " + getDrawFieldStr();
 }
 
-void printField(const QVector<CellState>& field)
-{
-    int width = sqrt(field.size());
-    int height = width;
-
-    QDebug debugOut = qDebug();
-    debugOut << "\n";
-    for(int i = 0; i < height; i++)
-    {
-        for(int j = 0; j < width; j++)
-        {
-           debugOut << (int)(field[i*width+j]) << " ";
-        }
-        debugOut << "\n";
-    }
-}
-
-void printField(const QVector<CellDraw>& field)
-{
-    int width = sqrt(field.size());
-    int height = width;
-
-    QDebug debugOut = qDebug();
-    debugOut << "\n";
-    for(int i = 0; i < height; i++)
-    {
-        for(int j = 0; j < width; j++)
-        {
-           debugOut << field[i*width+j] << " ";
-        }
-        debugOut << "\n";
-    }
-}
-
-int Field::shipNum(int size, const QVector<CellState>& fieldStateWithBorders)  // checks the number of ships with <size> blocks
-{
-    if (fieldStateWithBorders.size() != (height_+2)*(width_+2))
-    {
-        qDebug() << "Wrong size of the fieldStateWithBorders :" << fieldStateWithBorders.size() << " instead of " << (height_+2)*(width_+2);
-        return false;
-    }
-
-    int shipNumber = 0;
-
-    for(int j = 0; j < width_+2; j++)
-    {
-        for(int i = 0; i < height_+2; i++)
-        {
-            if(isShip(size, i, j, fieldStateWithBorders))
-            {
-                shipNumber++;
-                qDebug() << "найден" << shipNumber << "й корабль размера size =" << size;
-            }
-        }
-    }
-
-    return shipNumber;
-}
-
-bool Field::isShip(int size, int x, int y, const QVector<CellState>& fieldStateWithBorders)
-{
-    if (size < 0 || size > SHIP_MAXLEN)
-        return false;
-
-    int index = (width_+2)*y+x;
-    int length = 0;
-    int delta = 0;
-
-    if (fieldStateWithBorders[index] == CL_ST_TOP)
-    {
-        delta = width_+2;
-
-        index += delta;
-        length = 1;
-
-        while (fieldStateWithBorders[index] != CL_ST_EMPTY)
-        {
-            length++;
-            index += delta;
-        }
-    }
-
-    else if (fieldStateWithBorders[index] == CL_ST_LEFT)
-    {
-        delta = 1;
-
-        index += delta;
-        length = 1;
-
-        while (fieldStateWithBorders[index] != CL_ST_EMPTY)
-        {
-            length++;
-            index += delta;
-        }
-    }
-
-    else if (fieldStateWithBorders[index] == CL_ST_CENTER)
-    {
-        length = 1;
-    }
-
-    if (length == size)
-        return true;
-
-    return false;
-}
-
-bool Field::CheckDiagonalCollisions(const QVector<CellState>& fieldStateWithBorders)
-{
-    if (fieldStateWithBorders.size() != (height_+2)*(width_+2))
-    {
-        qDebug() << "Wrong size of the fieldStateWithBorders :" << fieldStateWithBorders.size() << " instead of " << (height_+2)*(width_+2);
-        return false;
-    }
-
-    for(int i = 0; i < height_; i++)
-    {
-        for(int j = 0; j < width_; j++)
-        {
-            int index = (width_+2)*(i+1)+(j+1);
-            if(fieldStateWithBorders[index] == CL_ST_EMPTY)
-            {
-                continue;
-            }
-
-            if(fieldStateWithBorders[index - (width_ + 2) - 1] != CL_ST_EMPTY ||
-               fieldStateWithBorders[index - (width_ + 2) + 1] != CL_ST_EMPTY ||
-               fieldStateWithBorders[index + (width_ + 2) + 1] != CL_ST_EMPTY ||
-               fieldStateWithBorders[index + (width_ + 2) - 1] != CL_ST_EMPTY   )
-            {
-                return false;
-            }
-        }
-    }
-
-    return true;
-}
-
-bool Field::CheckLength(QVector<CellState>& fieldStateWithBorders) // тут если чё нихуя правильно не работает, надеюсь бы отдебажим как проснемся :))
-{
-    if (fieldStateWithBorders.size() != (height_+2)*(width_+2))
-    {
-        qDebug() << "Wrong size of the fieldStateWithBorders :" << fieldStateWithBorders.size() << " instead of " << (height_+2)*(width_+2);
-        return false;
-    }
-
-    for(int i = 0; i < height_; i++)
-    {
-        for(int j = 0; j < width_; j++)
-        {
-            int index = (width_+2)*(i + 1) + (j+1);
-            if(fieldStateWithBorders[index] == CL_ST_UNDEFINED)
-            {
-                if(fieldStateWithBorders[index+1] != CL_ST_EMPTY) //horizontal ship (go from left toright)
-                {
-                    fieldStateWithBorders[index] = CL_ST_LEFT;
-
-                    int length = 2;
-                    int delta = 1;
-                    index += delta;
-
-                    while(fieldStateWithBorders[index+delta] != CL_ST_EMPTY)
-                    {
-                         fieldStateWithBorders[index] = CL_ST_HMIDDLE;
-                         index += delta;
-                         length++;
-                    }
-
-                    fieldStateWithBorders[index] = CL_ST_RIGHT;
-
-                    qDebug() << "length of the horizontal ship: " << length;
-
-                    if(length > SHIP_MAXLEN)
-                        return false;
-
-                    continue;
-                }
-
-                if(fieldStateWithBorders[index+width_+2] != CL_ST_EMPTY) // vertical ship (go from up to down)
-                {
-                    fieldStateWithBorders[index] = CL_ST_TOP;
-
-                    int length = 2;
-                    int delta = width_+2;
-                    index += delta;
-
-                    while(fieldStateWithBorders[index+delta] != CL_ST_EMPTY)
-                    {
-                         fieldStateWithBorders[index] = CL_ST_VMIDDLE;
-                         index += delta;
-                         length++;
-                    }
-
-                    fieldStateWithBorders[index] = CL_ST_BOTTOM;
-
-                    qDebug() << "length of the vertical ship: " << length;
-
-                    if(length > SHIP_MAXLEN)
-                        return false;
-
-                    continue;
-                 }
-
-                 fieldStateWithBorders[index] = CL_ST_CENTER;
-                 qDebug() << "length of the ship: 1";
-            }
-        }
-    }
-
-    printField(fieldStateWithBorders);
-
-    return true;
-}
-
 /**
  * @brief Проверка корректности размещения кораблей.
  * @return true если размещение корректно, false в противном случае
  * 
- * Проверяет корректность размещения кораблей на поле согласно правилам игры:
+ * Правила те же, что проверяет сервер (Board::isCorrect из libseabattle-core):
  * - Корабли не должны соприкасаться
  * - Корабли должны быть размещены в пределах поля
  * - Количество кораблей каждого типа должно соответствовать правилам
+ *
+ * Для неклассических правил расстановка собирается в список кораблей и
+ * проверяется SparseBoard, как на сервере.
  */
-bool Field::isCorrect()
+bool Field::isCorrect() const
 {
-    qDebug() << "isCorrect() input field dump::";
-    printField(fieldState_);
-
-    QVector<CellState> fieldStateWithBorders((width_+2)*(height_+2));
-    fieldStateWithBorders.fill(CL_ST_EMPTY);
-
-    for(int i = 0; i < height_; i++)
+    if (!rules_.isClassic())
     {
-        for(int j = 0; j < width_; j++)
-        {
-            fieldStateWithBorders[(width_+2)*(i+1)+(j+1)] = fieldState_[width_*i+j];
-        }
-    }
+        std::vector<Ship> ships;
+        if (!getShips(ships))
+            return false;
 
-    qDebug() << "Copied field dump:";
-    printField(fieldStateWithBorders);
+        SparseBoard board(rules_);
+        board.setShips(ships);
 
-    if(CheckDiagonalCollisions(fieldStateWithBorders) == false)
-    {
-        return false;
+        return board.isCorrect();
     }
 
-    if(CheckLength(fieldStateWithBorders) == false)
+    Bitboard ships;
+
+    for (int i = 0; i < fieldState_.size() && i < area_; i++)
     {
-        return false;
+        if (fieldState_[i] != CL_ST_EMPTY)
+            ships.set(i);
     }
 
-    qDebug() << "Copied field dump after CheckLength():";
-    printField(fieldStateWithBorders);
+    ClassicBoard board;
+    board.setShips(ships);
 
-    return  (shipNum(1, fieldStateWithBorders) == SHIP1_NUM &&
-             shipNum(2, fieldStateWithBorders) == SHIP2_NUM &&
-             shipNum(3, fieldStateWithBorders) == SHIP3_NUM &&
-             shipNum(4, fieldStateWithBorders) == SHIP4_NUM   );
+    return board.isCorrect();
 }
@@ -4,37 +4,12 @@
 #include <QVector>
 #include <QDebug>
 #include <QString>
+#include <QImage>
 #include "config.hpp"
 #include "constants.hpp"
-
-/**
- * @brief Состояния клетки для отрисовки
- */
-enum CellDraw
-{
-    CELL_EMPTY = 0  ,   ///< Пустое поле
-    CELL_LIVE       ,   ///< Часть живого корабля (ещё не попали)
-    CELL_DOT        ,   ///< Выстрел - промах
-    CELL_DAMAGED    ,   ///< Подбитое поле частично подбитого корабля
-    CELL_KILLED     ,   ///< Поле полностью подбитого корабля
-    CELL_MARK       ,   ///< Помеченное пользователем поле (как флажок в сапёре)
-};
-
-/**
- * @brief Состояния клетки для внутреннего представления
- */
-enum CellState
-{
-    CL_ST_EMPTY     = 0,    ///< Пустая клетка
-    CL_ST_CENTER    = 1,    ///< Центральная клетка (единичный корабль)
-    CL_ST_TOP       = 2,    ///< Верхняя клетка корабля (вертикального)
-    CL_ST_BOTTOM    = 3,    ///< Нижняя клетка корабля (вертикального)
-    CL_ST_VMIDDLE   = 4,    ///< Серединная клетка вертикально ориентированного корабля
-    CL_ST_HMIDDLE   = 5,    ///< Серединная клетка горизонтально ориентированного корабля
-    CL_ST_LEFT      = 6,    ///< Левая клетка корабля (горизонтального)
-    CL_ST_RIGHT     = 7,    ///< Правая клетка корабля (горизонтального)
-    CL_ST_UNDEFINED = 8,    ///< Неопределённое непустое состояние клетки
-};
+#include "protocol.hpp"
+#include "board.hpp"    // CellDraw, CellState и правила - из libseabattle-core
+#include "sparseboard.hpp"
 
 /**
  * @brief Класс игрового поля
@@ -84,7 +59,6 @@ public:
      * @param cell Новое состояние
      */
     void setStateCell(int x, int y, CellState cell);
-    void setStateCell(int index_bordered, CellState cell);
 
     /**
      * @brief Получить строковое представление внутреннего состояния поля
@@ -104,6 +78,12 @@ public:
     void setDrawField(QVector<CellDraw> field);
     void setStateField(QVector<CellState> field);
 
+    /**
+     * @brief Применить изменённые клетки отрисовки (FIELD:DIFF)
+     * @param ranges Отрезки клеток с новым состоянием
+     */
+    void applyDrawRanges(const QVector<CellRange>& ranges);
+
     /**
      * @brief Инициализировать поле для отрисовки
      */
@@ -116,6 +96,9 @@ public:
 
     /**
      * @brief Получить изображение поля
+     *
+     * Изображение кешируется: перерисовываются только клетки, чьё состояние
+     * изменилось с прошлого вызова.
      * @return QImage с отрисованным полем
      */
     QImage getFieldImage();
@@ -130,62 +113,48 @@ public:
     int getArea() const;
 
     /**
-     * @brief Проверить корректность расстановки кораблей
-     * @return true если расстановка корректна
+     * @brief Сменить правила игры: размер поля и флот
+     *
+     * Поле очищается, кеш изображения сбрасывается.
+     * @param rules Правила
      */
-    bool isCorrect();
-    bool CheckDiagonalCollisions(const QVector<CellState>& fieldStateWithBorders);
-    bool CheckLength(QVector<CellState>& fieldState);
+    void setRules(const RuleSet& rules);
 
-private:
-    /**
-     * @brief Подсчитать количество кораблей заданного размера
-     * @param size Размер корабля
-     * @param fieldStateWithBorders Состояние поля с границами
-     * @return Количество кораблей
-     */
-    int shipNum(int size, const QVector<CellState>& fieldStateWithBorders);
+    const RuleSet& getRules() const;
 
     /**
-     * @brief Проверить, является ли клетка началом корабля заданного размера
-     * @param size Размер корабля
-     * @param x Координата X
-     * @param y Координата Y
-     * @param fieldStateWithBorders Состояние поля с границами
-     * @return true если клетка является началом корабля
+     * @brief Получить расстановку списком кораблей
+     * @param ships Корабли (начало, длина, направление)
+     * @return false, если клетки не складываются в прямые корабли
      */
-    bool isShip(int size, int x, int y, const QVector<CellState>& fieldStateWithBorders);
+    bool getShips(std::vector<Ship>& ships) const;
 
     /**
-     * @brief Проверить возможность размещения корабля
-     * @param x Координата X начала корабля
-     * @param y Координата Y начала корабля
-     * @param size Размер корабля
-     * @param horizontal true если корабль горизонтальный
-     * @return true если корабль можно разместить
+     * @brief Установить расстановку из списка кораблей
+     * @param ships Корабли (клетки вне поля пропускаются)
      */
-    bool canPlaceShip(int x, int y, int size, bool horizontal);
+    void setShips(const std::vector<Ship>& ships);
 
     /**
-     * @brief Разместить корабль на поле
-     * @param x Координата X начала корабля
-     * @param y Координата Y начала корабля
-     * @param size Размер корабля
-     * @param horizontal true если корабль горизонтальный
+     * @brief Проверить корректность расстановки кораблей
+     * @return true если расстановка корректна
      */
-    void placeShip(int x, int y, int size, bool horizontal);
+    bool isCorrect() const;
 
 private:
+    RuleSet rules_;      ///< Правила игры
     int width_;          ///< Ширина поля
     int height_;         ///< Высота поля
     int area_;           ///< Площадь поля
     QVector<CellState> fieldState_;  ///< Внутреннее состояние поля
     QVector<CellDraw> fieldDraw_;    ///< Состояние поля для отрисовки
+    QVector<CellDraw> paintedDraw_;  ///< Состояния клеток, уже нарисованные в fieldImage_
+    QImage fieldImage_;              ///< Кеш изображения поля
 };
 
 /**
  * @brief Преобразовать строку в вектор состояний отрисовки
- * @param fieldDrawStr Строка с состояниями
+ * @param fieldDrawStr Упакованное поле (base64url, 3 бита на клетку)
  * @return Вектор состояний
  */
 QVector<CellDraw> fieldDrawFromStr(QString fieldDrawStr);
@@ -1,12 +1,17 @@
 #include "fightshistorywindow.h"
 #include "ui_fightshistorywindow.h"
+#include "config.hpp"
+#include "protocol.hpp"
 #include <QDialog>
+#include <QScrollBar>
 #include <QVBoxLayout>
 #include <QLabel>
 
 FightsHistoryWindow::FightsHistoryWindow(QWidget *parent) :
     QDialog(parent),
-    ui(new Ui::FightsHistoryWindow)
+    ui(new Ui::FightsHistoryWindow),
+    nextCursor_(0),
+    pendingCursor_(-1)
 {
     ui->setupUi(this);
 
@@ -34,6 +39,8 @@ FightsHistoryWindow::FightsHistoryWindow(QWidget *parent) :
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addWidget(ui->tableWidget);
     setLayout(layout);
+
+    connect(ui->tableWidget->verticalScrollBar(), &QScrollBar::valueChanged, this, &FightsHistoryWindow::on_scrolled);
 }
 
 FightsHistoryWindow::~FightsHistoryWindow()
@@ -41,6 +48,28 @@ FightsHistoryWindow::~FightsHistoryWindow()
     delete ui;
 }
 
+/**
+ * @brief Развернуть упакованную расстановку в клетки ■/□
+ *
+ * Старые записи истории уже хранят клетки символами, они возвращаются как есть.
+ */
+static QString unpackHistoryField(const QString& fieldText)
+{
+    QString fieldBin;
+
+    if (!Protocol::decodeFieldText(fieldText, fieldBin))
+        return fieldText;
+
+    QString cells(fieldBin.size(), QChar(0x25A1));
+    for (int i = 0; i < fieldBin.size(); i++)
+    {
+        if (fieldBin[i] == '1')
+            cells[i] = QChar(0x25A0);
+    }
+
+    return cells;
+}
+
 void FightsHistoryWindow::addGameEmdingStr(QString& gameEndingStr, int rowIndex)
 {
     int currentRowCount = ui->tableWidget->rowCount();
@@ -52,7 +81,7 @@ void FightsHistoryWindow::addGameEmdingStr(QString& gameEndingStr, int rowIndex)
 
     QString str = "";
 
-    QString field1 = gameInfo[2];
+    QString field1 = unpackHistoryField(gameInfo[2]);
     QLabel* field1Label = new QLabel;
     QTableWidgetItem* field1Item = new QTableWidgetItem;
     qDebug() << "field1: " << field1;
@@ -68,7 +97,7 @@ void FightsHistoryWindow::addGameEmdingStr(QString& gameEndingStr, int rowIndex)
 
     str.clear();
 
-    QString field2 = gameInfo[3];
+    QString field2 = unpackHistoryField(gameInfo[3]);
     QLabel* field2Label = new QLabel;
     QTableWidgetItem* field2Item = new QTableWidgetItem;
     qDebug() << "field2: " << field2;
@@ -106,3 +135,59 @@ void FightsHistoryWindow::fillTable(QStringList& gameEndingsStrList)
         addGameEmdingStr(gameEndingsStrList[rowIndex], rowIndex);
     }
 }
+
+void FightsHistoryWindow::resetPages()
+{
+    ui->tableWidget->clearContents();
+    ui->tableWidget->setRowCount(0);
+
+    nextCursor_ = 0;
+    pendingCursor_ = 0;
+    emit pageRequested(0, HISTORY_PAGE_SIZE);
+}
+
+void FightsHistoryWindow::appendPage(qint64 cursor, qint64 nextCursor, QStringList& gameEndingsStrList)
+{
+    if (cursor != pendingCursor_)   // ответ на запрос до resetPages()
+        return;
+
+    pendingCursor_ = -1;
+    nextCursor_ = nextCursor;
+
+    int firstRow = ui->tableWidget->rowCount();
+    ui->tableWidget->setRowCount(firstRow + gameEndingsStrList.size());
+
+    for (int i = 0; i < gameEndingsStrList.size(); i++)
+        addGameEmdingStr(gameEndingsStrList[i], firstRow + i);
+
+    // страница не заполнила окно - прокрутки не будет, догружаем сразу
+    on_scrolled(ui->tableWidget->verticalScrollBar()->value());
+}
+
+void FightsHistoryWindow::prependGameEnding(QString& gameEndingStr)
+{
+    if (pendingCursor_ == 0)    // первая страница ещё не пришла и уже содержит эту игру
+        return;
+
+    ui->tableWidget->insertRow(0);
+    addGameEmdingStr(gameEndingStr, 0);
+}
+
+void FightsHistoryWindow::requestNextPage()
+{
+    if (nextCursor_ == 0 || pendingCursor_ != -1)
+        return;
+
+    pendingCursor_ = nextCursor_;
+    emit pageRequested(nextCursor_, HISTORY_PAGE_SIZE);
+}
+
+void FightsHistoryWindow::on_scrolled(int value)
+{
+    int lastVisibleRow = ui->tableWidget->rowAt(ui->tableWidget->viewport()->height() - 1);
+    if (lastVisibleRow < 0)     // ниже последней строки пусто
+        lastVisibleRow = ui->tableWidget->rowCount() - 1;
+
+    if (value >= ui->tableWidget->verticalScrollBar()->maximum() || lastVisibleRow >= ui->tableWidget->rowCount() - HISTORY_PREFETCH_ROWS)
+        requestNextPage();
+}
@@ -51,8 +51,49 @@ public:
      */
     void fillTable(QStringList& gameEndingsStrList);
 
+    /**
+     * @brief Очистить таблицу и запросить первую страницу истории
+     */
+    void resetPages();
+
+    /**
+     * @brief Дописать страницу истории в конец таблицы
+     * @param cursor Курсор, на который пришёл ответ (устаревшие ответы пропускаются)
+     * @param nextCursor Курсор следующей страницы (0 - страниц больше нет)
+     * @param gameEndingsStrList Строки с информацией о завершении игр, новые сверху
+     */
+    void appendPage(qint64 cursor, qint64 nextCursor, QStringList& gameEndingsStrList);
+
+    /**
+     * @brief Добавить только что завершившуюся игру в начало таблицы (HISTORY:APPEND)
+     * @param gameEndingStr Строка с информацией о завершении игры
+     */
+    void prependGameEnding(QString& gameEndingStr);
+
+signals:
+    /**
+     * @brief Нужна следующая страница истории
+     * @param cursor Курсор страницы (0 - первая)
+     * @param limit Количество строк
+     */
+    void pageRequested(qint64 cursor, int limit);
+
+private:
+    /**
+     * @brief Запросить следующую страницу, если она есть и ещё не запрошена
+     */
+    void requestNextPage();
+
+    /**
+     * @brief Догрузить историю, когда прокрутка подходит к концу таблицы
+     * @param value Положение полосы прокрутки
+     */
+    void on_scrolled(int value);
+
 private:
     Ui::FightsHistoryWindow *ui;  ///< Указатель на интерфейс
+    qint64 nextCursor_;           ///< Курсор следующей страницы (0 - загружено всё)
+    qint64 pendingCursor_;        ///< Запрошенный и ещё не полученный курсор (-1 - нет)
 };
 
 #endif // FIGHTSHISTORYWINDOW_H
@@ -14,9 +14,11 @@
 #include <QMediaPlayer>
 #include <QtMultimedia>
 #include <QDialog>
+#include <QInputDialog>
 #include <QSqlTableModel>
 #include <QTableView>
 #include <QTableWidget>
+#include <QSet>
 
 #define CLICK_SOUND controller_->playSound("click");
 
@@ -26,6 +28,8 @@ MainWindow::MainWindow(QString ip, quint16 port, QWidget *parent)
     , port_(port)
     , ui(new Ui::MainWindow)
     , fightsHistoryWindow_(FightsHistoryWindow(this))
+    , presenceSeq_(0)
+    , presenceSynced_(false)
 {
     ui->setupUi(this);
 
@@ -66,6 +70,11 @@ MainWindow::MainWindow(QString ip, quint16 port, QWidget *parent)
 
     connect(ui->messageRecieversOptionList, SIGNAL(itemSelectionChanged()), this, SLOT(on_messageRecieversOptionList_itemSelectionChanged()));
 
+    connect(&fightsHistoryWindow_, &FightsHistoryWindow::pageRequested, this, [this](qint64 cursor, int limit)
+    {
+        sendRequest("HISTORY:PAGE:" + QString::number(cursor) + ":" + QString::number(limit));
+    });
+
     socket_ = new QTcpSocket(this);
 
     userLogins_ = QStringList(); // list of user logins
@@ -181,7 +190,7 @@ void MainWindow::authenticateUser()
             return;
         }
 
-        socket_->write(("AUTH:" + login_entered + "@").toUtf8()); // request for authorization
+        socket_->write(("AUTH:" + login_entered + ":" PROTOCOL_V2_TOKEN "@").toUtf8()); // request for authorization, offering protocol v2
 //        socket_->flush();
 
         if (!socket_->waitForReadyRead(2500)) // if server don't answer > 2.5 sec
@@ -237,12 +246,13 @@ void MainWindow::authenticateUser()
 
             ui->messageRecieversOptionList->addItem("all");
 
-            // TODO: get list of users from server
-//            makeUsersRequest();
-
             updateReadiness(ST_NREADY);
             ui->isReadyCheckBox->setVisible(true);
             ui->isReadyCheckBox->setEnabled(true);
+
+            // версия 2: снимок списка, дальше сервер сам присылает изменения USER:*
+            if (model_->getProtocolVersion() >= PROTOCOL_VERSION_BINARY)
+                makeUsersRequest();
         }
 
          else // didn't authorized
@@ -260,7 +270,12 @@ void MainWindow::on_sockConnect()
 
 void MainWindow::on_sockDisconnect()
 {
-    socket_->deleteLater();     // delete socket
+    // сокет не удаляется: он принадлежит окну, им же пользуется controller_, и через него идёт переподключение
+    decoder_.reset();
+    model_->setProtocolVersion(PROTOCOL_VERSION_TEXT);
+    connectionStateUpdate(ST_DISCONNECTED);
+
+    timerId_ = startTimer(2000);    // переподключение, как при запуске
 }
 
 void MainWindow::on_sockError(QAbstractSocket::SocketError error)
@@ -271,9 +286,8 @@ void MainWindow::on_sockError(QAbstractSocket::SocketError error)
 void MainWindow::on_openFightHistoryAction_triggered()
 {
     qDebug() << "show fight history window";
-    socket_->write(((QString)"HISTORY:UPDATE:@").toUtf8());
-    qDebug() << "to server: HISTORY:UPDATE:";
-//    socket_->waitForReadyRead(2000);
+    sendRequest("HISTORY:SUBSCRIBE:");   // пока окно открыто, новые игры приходят по одной (HISTORY:APPEND)
+    fightsHistoryWindow_.resetPages();   // первая страница, остальные - по мере прокрутки
 
     fightsHistoryWindow_.update();
 
@@ -282,6 +296,8 @@ void MainWindow::on_openFightHistoryAction_triggered()
     fightsHistoryWindow_.activateWindow();
     fightsHistoryWindow_.raise();
     fightsHistoryWindow_.exec();
+
+    sendRequest("HISTORY:UNSUBSCRIBE:");
 }
 
 void MainWindow::on_userToChose_triggered()
@@ -291,21 +307,121 @@ void MainWindow::on_userToChose_triggered()
 
 void MainWindow::on_receiveData()
 {
-//    socket->waitForReadyRead(500);
-    data_ = socket_->readAll();
-    qDebug() << "server: " << data_;
+    decoder_.readFrom(socket_);
 
-    QList<QByteArray> dataArr = data_.split('@');
-    for (int i = 0; i < dataArr.size()-1; i++)
+    QByteArrayView frame;
+    while (decoder_.nextFrame(frame))
     {
-        data_ = dataArr[i];
-//        PRINT("client" + QString::number(socket_->socketDescriptor()) + ": " + data_)
+        if (decoder_.getMode() == FrameDecoder::MODE_BINARY)
+        {
+            handleBinaryData(frame);
+            continue;
+        }
+
+        data_ = frame.toByteArray();
+        qDebug() << "server: " << data_;
+
+        // всё, что идёт после этого ответа, приходит двоичными кадрами
+        if (data_ == "AUTH:SUCCESS:" PROTOCOL_V2_TOKEN)
+        {
+            model_->setProtocolVersion(PROTOCOL_VERSION_BINARY);
+            decoder_.setMode(FrameDecoder::MODE_BINARY);
+        }
+
         handleData();
     }
 
+    decoder_.compact();
+
+    if (decoder_.isBroken())    // границы двоичных кадров потеряны, дальше поток не разобрать
+    {
+        qDebug() << "Malformed frame from server, disconnecting";
+        socket_->abort();
+    }
+
     this->update();
 }
 
+void MainWindow::handleBinaryData(QByteArrayView frame)
+{
+    Opcode opcode = (Opcode)(quint8)frame[0];
+    QByteArrayView payload = frame.sliced(1);
+
+    switch (opcode)
+    {
+        case OP_TEXT:
+        {
+            data_ = payload.toByteArray();
+            qDebug() << "server: " << data_;
+            handleData();
+            break;
+        }
+
+        case OP_SHOT_RESULT:
+        {
+            ShotResult result = SHOT_DOT;
+            int x = 0, y = 0;
+
+            if (!Protocol::decodeShotResult(payload, result, x, y))
+            {
+                qDebug() << "Wrong SHOT_RESULT frame";
+                break;
+            }
+
+            static const CellDraw statuses[] = { CELL_DOT, CELL_DAMAGED, CELL_KILLED };
+            applyShot(statuses[result], x, y);
+            break;
+        }
+
+        case OP_FIELD_UPDATE:
+        {
+            FieldOwner owner = OWNER_MY;
+            QVector<CellDraw> fieldDraw;
+
+            if (!Protocol::decodeFieldUpdate(payload, owner, fieldDraw))
+            {
+                qDebug() << "Wrong FIELD_UPDATE frame";
+                break;
+            }
+
+            if (owner == OWNER_MY)
+                model_->updateMyFieldDraw(fieldDraw);
+            else
+                model_->updateEnemyFieldDraw(fieldDraw);
+            break;
+        }
+
+        case OP_FIELD_DIFF:
+        {
+            FieldOwner owner = OWNER_MY;
+            QVector<CellRange> ranges;
+
+            if (!Protocol::decodeFieldDiff(payload, owner, ranges, model_->getMyField().getArea()))
+            {
+                qDebug() << "Wrong FIELD_DIFF frame";
+                break;
+            }
+
+            if (owner == OWNER_MY)
+                model_->applyMyFieldDiff(ranges);
+            else
+                model_->applyEnemyFieldDiff(ranges);
+            break;
+        }
+
+        default:
+        {
+            qDebug() << "Unknown opcode " << (int)opcode;
+            break;
+        }
+    }
+}
+
+void MainWindow::sendRequest(const QString& request)
+{
+    socket_->write(Protocol::encodeText(request, model_->getProtocolVersion()));
+}
+
 void MainWindow::handleData()
 {
     if (data_.startsWith("CONNECTION:"))
@@ -321,11 +437,21 @@ void MainWindow::handleData()
         handleMessageRequest();
     }
 
+    else if(data_.startsWith("USERS:SNAPSHOT:"))
+    {
+        handleUsersSnapshot();
+    }
+
     else if(data_.startsWith("USERS:"))
     {
         handleUsersRequest();
     }
 
+    else if(data_.startsWith("USER:"))
+    {
+        handlePresenceRequest();
+    }
+
     else if (data_.startsWith("FIELD:"))
     {
         handleFieldRequest();
@@ -351,6 +477,11 @@ void MainWindow::handleData()
         handleGenerateRequest();
     }
 
+    else if (data_.startsWith("ERROR:"))
+    {
+        handleErrorRequest();
+    }
+
     else if(data_.startsWith("EXIT:"))
     {
         handleExitRequest();
@@ -366,6 +497,23 @@ void MainWindow::handleData()
     {
         handleHistoryUpdateRequest();
     }
+
+    else if (data_.startsWith("HISTORY:PAGE:"))
+    {
+        handleHistoryPageRequest();
+    }
+
+    else if (data_.startsWith("HISTORY:APPEND:"))
+    {
+        QString gameEndingStr = QString::fromUtf8(data_.mid(15));
+        fightsHistoryWindow_.prependGameEnding(gameEndingStr);
+    }
+
+    else if (data_.startsWith("HISTORY:RESET:"))
+    {
+        if (fightsHistoryWindow_.isVisible())
+            fightsHistoryWindow_.resetPages();
+    }
     else
     {
 
@@ -377,7 +525,7 @@ void MainWindow::handleData()
 
 void MainWindow::handlePingRequest()
 {
-    socket_->write(((QString)"PONG:" + "@").toUtf8());
+    sendRequest("PONG:");
 //    socket_->flush();
 }
 
@@ -477,70 +625,75 @@ void MainWindow::handleShotRequest()
 
         }
 
-        if (model_->getState() == ST_MAKING_STEP)
-        {
-            model_->setEnemyCell(x, y, status);
-            qDebug() << "Enemy field: (" + QString::number(x) + "," + QString::number(y) + ") = " + QString::number(status) + "(" + shotResult + ")";
+        applyShot(status, x, y);
+    }
+    else
+    {
+        qDebug() << "Wrong request";
+        return;
+    }
+}
 
-            if (status == CELL_DOT)
-            {
-                controller_->playSound("enemy_miss");
-                qDebug() << "Вы промазали, смена хода!";
-                model_->switchStep();
-                ui->whooseStepLabel->setText("Ход соперника");
-            }
-            else if (status == CELL_DAMAGED)
-            {
-                controller_->playSound("enemy_hit");
-                qDebug() << "Вы попали! Продолжайте ход";
-            }
-            else if (status == CELL_KILLED)
-            {
-                controller_->playSound("enemy_kill");
-                qDebug() << "Вы подорвали корабль противника! Продолжайте ход";
-            }
-            else
-            {
+void MainWindow::applyShot(CellDraw status, int x, int y)
+{
+    if (model_->getState() == ST_MAKING_STEP)
+    {
+        model_->setEnemyCell(x, y, status);
+        qDebug() << "Enemy field: (" + QString::number(x) + "," + QString::number(y) + ") = " + QString::number(status);
 
-            }
+        if (status == CELL_DOT)
+        {
+            controller_->playSound("enemy_miss");
+            qDebug() << "Вы промазали, смена хода!";
+            model_->switchStep();
+            ui->whooseStepLabel->setText("Ход соперника");
         }
-        else if (model_->getState() == ST_WAITING_STEP)
+        else if (status == CELL_DAMAGED)
         {
-            model_->setMyDrawCell(x, y, status);
-            qDebug() << "My field: (" + QString::number(x) + "," + QString::number(y) + ") = " + QString::number(status) + "(" + shotResult + ")";
-
-            if (status == CELL_DOT)
-            {
-                controller_->playSound("you_miss");
-                qDebug() << "Противник промазал, смена хода!";
-                model_->switchStep();
-                ui->whooseStepLabel->setText("Ваш ход");
-//                return;
-            }
-            else if (status == CELL_DAMAGED)
-            {
-                controller_->playSound("you_hit");
-                qDebug() << "Противник попал и продолжает ход";
-            }
-            else if (status == CELL_KILLED)
-            {
-                controller_->playSound("you_kill");
-                qDebug() << "Противник попал и уничтожил ваш корабль! Его ход";
-            }
+            controller_->playSound("enemy_hit");
+            qDebug() << "Вы попали! Продолжайте ход";
+        }
+        else if (status == CELL_KILLED)
+        {
+            controller_->playSound("enemy_kill");
+            qDebug() << "Вы подорвали корабль противника! Продолжайте ход";
         }
+        else
+        {
 
-        update();
+        }
     }
-    else
+    else if (model_->getState() == ST_WAITING_STEP)
     {
-        qDebug() << "Wrong request";
-        return;
+        model_->setMyDrawCell(x, y, status);
+        qDebug() << "My field: (" + QString::number(x) + "," + QString::number(y) + ") = " + QString::number(status);
+
+        if (status == CELL_DOT)
+        {
+            controller_->playSound("you_miss");
+            qDebug() << "Противник промазал, смена хода!";
+            model_->switchStep();
+            ui->whooseStepLabel->setText("Ваш ход");
+//                return;
+        }
+        else if (status == CELL_DAMAGED)
+        {
+            controller_->playSound("you_hit");
+            qDebug() << "Противник попал и продолжает ход";
+        }
+        else if (status == CELL_KILLED)
+        {
+            controller_->playSound("you_kill");
+            qDebug() << "Противник попал и уничтожил ваш корабль! Его ход";
+        }
     }
+
+    update();
 }
 
 void MainWindow::makeUsersRequest() // requests list of users and add connected/remove disconnected them in usersList and in messageRecieversOptionList
 {
-    socket_->write(((QString)"USERS:" + "@").toUtf8());
+    sendRequest("USERS:");
 //    socket_->flush();
 //    socket_->waitForReadyRead(500);
 
@@ -677,6 +830,7 @@ void MainWindow::handleUsersRequest()
     updateUsers(users_list);
     updateChats();
     ui->usersList->clear();
+    userActions_.clear();   // действия меню удалены вместе с clear()
 
     int cur_row_index = -1; // when we have "all" it will be = 0
     int new_cur_row_index = cur_row_index;
@@ -736,10 +890,171 @@ void MainWindow::handleUsersRequest()
 //    ui->messageRecieversOptionList->setCurrentRow(new_cur_row_index);   // set message to all at default
 }
 
+void MainWindow::handleUsersSnapshot()   // USERS:SNAPSHOT:<seq>:<login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
+{
+    QString body = QString::fromUtf8(data_.trimmed().mid(15));
+    int seqEnd = body.indexOf(':');
+
+    if (seqEnd < 0)
+    {
+        qDebug() << "Wrong request";
+        return;
+    }
+
+    quint64 seq = body.left(seqEnd).toULongLong();
+    QStringList users_list = body.mid(seqEnd + 1).split(" ", Qt::SkipEmptyParts);
+
+    QSet<QString> logins;
+    foreach (const QString& user, users_list)
+    {
+        QStringList user_info = user.split(":");
+        if (user_info.size() < 3)
+            continue;
+
+        logins.insert(user_info[0]);
+        upsertUser(user_info[0], user_info[1].toInt(), user_info[2].toInt());
+    }
+
+    // ушедшие, пока изменения не доходили
+    foreach (const QString& login, userActions_.keys())
+    {
+        if (!logins.contains(login))
+            removeUser(login);
+    }
+
+    presenceSeq_ = seq;
+    presenceSynced_ = true;
+
+    ui->menubar->update();
+}
+
+void MainWindow::handlePresenceRequest()   // USER:<ADD|UPDATE|REMOVE>:<seq>:<login>[:<status>:<readiness>]
+{
+    QStringList message_request = QString::fromUtf8(data_.trimmed()).split(":");
+
+    if (message_request.size() < 4)
+    {
+        qDebug() << "Wrong request";
+        return;
+    }
+
+    if (!presenceSynced_)   // ждём снимок, изменения до него в нём уже учтены
+        return;
+
+    quint64 seq = message_request[2].toULongLong();
+
+    if (seq <= presenceSeq_)
+        return;
+
+    if (seq != presenceSeq_ + 1)
+    {
+        qDebug() << "presence gap: have " << presenceSeq_ << " got " << seq << ", resync";
+        presenceSynced_ = false;
+        makeUsersRequest();
+        return;
+    }
+
+    presenceSeq_ = seq;
+
+    QString op = message_request[1];
+    QString login = message_request[3];
+
+    if (op == "REMOVE")
+    {
+        removeUser(login);
+    }
+    else if ((op == "ADD" || op == "UPDATE") && message_request.size() >= 6)
+    {
+        upsertUser(login, message_request[4].toInt(), message_request[5].toInt());
+    }
+    else
+    {
+        qDebug() << "Wrong request";
+        return;
+    }
+
+    ui->menubar->update();
+}
+
+void MainWindow::upsertUser(const QString& login, int status, int readiness)
+{
+    QAction* userAction = userActions_.value(login);
+
+    if (!userAction)
+    {
+        userAction = ui->usersList->addAction(login);
+        userActions_.insert(login, userAction);
+
+        if (login != login_)
+        {
+            QObject::connect(userAction, &QAction::triggered, this, [this, userAction]()
+            {
+                if (userAction->data().toInt() != ST_READY)
+                    return;
+
+                CLICK_SOUND
+                qDebug() << "try to connect to the user " << userAction->text();
+                connectToGame(userAction->text());
+            });
+        }
+
+        if (ui->messageRecieversOptionList->findItems(login, Qt::MatchExactly).isEmpty())
+        {
+            ui->messageRecieversOptionList->addItem(login);
+            users_.append(login);
+            updateChats();
+        }
+    }
+
+    userAction->setData(readiness);
+    userAction->setEnabled(login != login_ && status == 2 && readiness == ST_READY);   // == ST_AUTHORIZED && == ST_READY
+    setIconStatus(userAction, readiness);
+}
+
+void MainWindow::removeUser(const QString& login)
+{
+    QAction* userAction = userActions_.take(login);
+    if (userAction)
+    {
+        ui->usersList->removeAction(userAction);
+        delete userAction;
+    }
+
+    foreach (QListWidgetItem* userItem, ui->messageRecieversOptionList->findItems(login, Qt::MatchExactly))
+    {
+        QTextBrowser* chat = browserMap.take(userItem);
+        if (chat)
+        {
+            receiverBrowserStackedWidget->removeWidget(chat);
+            delete chat;
+        }
+
+        delete ui->messageRecieversOptionList->takeItem(ui->messageRecieversOptionList->row(userItem));
+    }
+
+    users_.removeAll(login);
+}
+
 void MainWindow::handleFieldRequest()
 {
     QStringList message_request = QString::fromUtf8(data_).split(":");
 
+    if (message_request.size() == 4 && message_request[1] == "DIFF")   // FIELD:DIFF:<MY|ENEMY>:<start>,<count>,<state>;...
+    {
+        QVector<CellRange> ranges;
+
+        if (!Protocol::decodeFieldDiffText(message_request[3], ranges, model_->getMyField().getArea()))
+            qDebug() << "Wrong field diff: " << message_request[3];
+        else if (message_request[2] == "MY")
+            model_->applyMyFieldDiff(ranges);
+        else if (message_request[2] == "ENEMY")
+            model_->applyEnemyFieldDiff(ranges);
+        else
+            qDebug() << "Wrong request";
+
+        return;
+    }
+
     if (message_request.size() < 4 || message_request[1] != "UPDATE")
     {
         qDebug() << "wrong request";
@@ -786,6 +1101,19 @@ void MainWindow::handleHistoryUpdateRequest()
     fightsHistoryWindow_.fillTable(gameEndingsStrList);
 }
 
+void MainWindow::handleHistoryPageRequest()   // HISTORY:PAGE:<cursor>:<next_cursor>:<row1>$$<row2>...
+{
+    QString page = QString::fromUtf8(data_.mid(13));
+
+    qint64 cursor = page.section(':', 0, 0).toLongLong();
+    qint64 nextCursor = page.section(':', 1, 1).toLongLong();
+    QString rows = page.section(':', 2);
+
+    QStringList gameEndingsStrList = rows.split("$$", Qt::SkipEmptyParts);
+
+    fightsHistoryWindow_.appendPage(cursor, nextCursor, gameEndingsStrList);
+}
+
 void MainWindow::handleExitRequest()
 {
     QStringList message_request = QString::fromUtf8(data_).split(":");
@@ -830,10 +1158,13 @@ void MainWindow::handleConnectionRequest()
     QStringList message_request = QString::fromUtf8(data_).split(":");
     QString enemy_login = message_request[1];
 
-    if (message_request.size() == 2)    // CONNECTION:<login1>
+    if (message_request.size() == 2 || (message_request.size() == 4 && message_request[2] == "RULES"))    // CONNECTION:<login1>[:RULES:<rules>]
     {
+        // с этими правилами начнётся игра, если приглашение принято
+        QString rulesText = message_request.size() == 4 ? message_request[3] : QString::fromStdString(RuleSet::classic().toString());
+
         QMessageBox::StandardButton reply = QMessageBox::question(this, "Запрос на подключение",
-                                                                  "Пользователь " + enemy_login + " приглашает вас сыграть! Принять приглашение?",
+                                                                  "Пользователь " + enemy_login + " приглашает вас сыграть! Поле и флот: " + rulesText + ". Принять приглашение?",
                                                                   QMessageBox::Yes | QMessageBox::No);
         QString answer = "CONNECTION:" + enemy_login + ":";
 
@@ -853,7 +1184,7 @@ void MainWindow::handleConnectionRequest()
         }
 
         qDebug() << answer;
-        socket_->write(((QString)answer + "@").toUtf8());
+        sendRequest(answer);
 //        socket_->flush();
 
         model_->setStartedFlag(false);
@@ -867,9 +1198,9 @@ void MainWindow::handleConnectionRequest()
         {
             QMessageBox::information(this, "Connection info!", "Пользователь " + enemy_login + " принял запрос на игру!");
 
-            QString message = "GAME:START:" + login_ + ":" + enemy_login;
+            QString message = "GAME:START:" + login_ + ":" + enemy_login;    // правила сервер берёт из принятого приглашения
 
-            socket_->write((message+"@").toUtf8());
+            sendRequest(message);
 //            socket_->flush();
             qDebug() << message;
 
@@ -946,14 +1277,21 @@ void MainWindow::handleGameRequest()
             qDebug() <<"Wrong request";
     }
 
-    else if (message_request.size() == 4)   // GAME:START:<enemy_login>:<gameId>
+    else if (message_request.size() == 4 || message_request.size() == 5)   // GAME:START:<enemy_login>:<gameId>[:<rules>]
     {
         if (message_request[1] == "START")
         {
             QString enemy_login = message_request[2];
             int gameId = message_request[3].toInt();
 
-            startGame(enemy_login, gameId);
+            RuleSet rules;
+            if (message_request.size() == 5 && !RuleSet::parse(message_request[4].toStdString(), rules))
+            {
+                qDebug() << "Wrong game rules: " << message_request[4];
+                return;
+            }
+
+            startGame(enemy_login, gameId, rules);
         }
         else
             qDebug() << "Wrong request";
@@ -982,7 +1320,42 @@ static QString convertBinFieldToState(const QString& fieldStr)
     return fieldStateStr;
 }
 
-void MainWindow::handleGenerateRequest()    // GENERATE:<fieldBin>
+void MainWindow::handleErrorRequest()   // ERROR:<errortype>
+{
+    QStringList message_request = QString::fromUtf8(data_).split(":");
+
+    if (message_request.size() == 2 && message_request[1] == "FIELD" && model_->getState() == ST_WAITING_PLACING)
+    {
+        // сервер не принял расстановку - снова даём её менять
+        model_->updateState(ST_PLACING_SHIPS);
+
+        ui->checkButton->setEnabled(true);
+        ui->generateFieldButton->setEnabled(true);
+        ui->applyFieldButton->setEnabled(true);
+        ui->clearButton->setEnabled(true);
+
+        ui->applyFieldButton->setStyleSheet("");
+        ui->applyIsOkLabel->setVisible(false);
+        ui->applyIsNotOkLabel->setVisible(true);
+
+        QMessageBox::warning(this, "Ship placing warning", "Сервер отклонил расстановку кораблей! Поменяйте её");
+        return;
+    }
+
+    if (message_request.size() == 2 && message_request[1] == "GENERATE")
+    {
+        // сервер не нашёл случайную расстановку для правил игры - корабли расставляются вручную
+        ui->applyIsOkLabel->setVisible(false);
+        ui->applyIsNotOkLabel->setVisible(true);
+
+        QMessageBox::warning(this, "Ship placing warning", "Сервер не смог расставить корабли! Расставьте их вручную");
+        return;
+    }
+
+    qDebug() << "Error from server: " << message_request;
+}
+
+void MainWindow::handleGenerateRequest()    // GENERATE:<packedField> или GENERATE:SHIPS:<packedShips>
 {
     ModelState state = model_->getState() ;
 
@@ -1003,7 +1376,26 @@ void MainWindow::handleGenerateRequest()    // GENERATE:<fieldBin>
     ui->applyIsOkLabel->setVisible(true);
     ui->applyIsNotOkLabel->setVisible(false);
 
-    QString fieldBinStr = message_request[1];
+    if (message_request.size() == 3 && message_request[1] == "SHIPS")    // GENERATE:SHIPS:<packedShips>
+    {
+        std::vector<Ship> ships;
+        if (!Protocol::decodeShipsText(message_request[2], ships))
+        {
+            qDebug() << "Wrong generated ships: " << message_request[2];
+            return;
+        }
+
+        model_->myField_->setShips(ships);
+        model_->myField_->initMyDrawField();
+        return;
+    }
+
+    QString fieldBinStr;
+    if (!Protocol::decodeFieldText(message_request[1], fieldBinStr))
+    {
+        qDebug() << "Wrong generated field: " << message_request[1];
+        return;
+    }
     qDebug() << "Server generated a field: " << fieldBinStr;
 
     QString fieldStr = convertBinFieldToState(fieldBinStr);
@@ -1077,7 +1469,7 @@ void MainWindow::sendMessage()
         chat->textCursor().insertText(login_ + "> ", sender_format);
         chat->textCursor().insertText(message + "\n", message_format);
 
-        socket_->write((request+"@").toUtf8());   // send message through the server
+        sendRequest(request);   // send message through the server
 //        socket_->flush();
         ui->messageEdit->clear();
     }
@@ -1096,9 +1488,35 @@ void MainWindow::on_sendMessageButton_clicked()
 
 void MainWindow::connectToGame(const QString& enemy_login)
 {
-    socket_->write(((QString)"CONNECTION:" + enemy_login + "@").toUtf8());
+    QString message = "CONNECTION:" + enemy_login;
+
+    // правила предлагаются в приглашении, приглашённый видит их перед ответом; клиент версии 1 играет только классику
+    if (model_->getProtocolVersion() >= PROTOCOL_VERSION_BINARY)
+    {
+        QStringList presets;
+        for (const char* preset : GAME_RULES_PRESETS)
+            presets << preset;
+
+        bool isChosen = false;
+        QString rulesText = QInputDialog::getItem(this, "Game rules", "Поле и флот (<ширина>x<высота>/<n1>,<n2>,...):", presets, 0, true, &isChosen);
+
+        if (!isChosen)
+            return;
+
+        RuleSet rules;
+        if (!RuleSet::parse(rulesText.toStdString(), rules))
+        {
+            QMessageBox::warning(this, "Game rules warning", "Неверные правила");
+            return;
+        }
+
+        if (!rules.isClassic())
+            message += ":RULES:" + QString::fromStdString(rules.toString());
+    }
+
+    sendRequest(message);
 //    socket_->flush();
-    qDebug() << "CONNECTION:" << enemy_login;
+    qDebug() << message;
 }
 
 void MainWindow::on_messageRecieversOptionList_itemSelectionChanged()
@@ -1201,7 +1619,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
 
 void MainWindow::exitFromServer()
 {
-    socket_->write(((QString)"EXIT:@").toUtf8());    // send server message about user disconnect
+    sendRequest("EXIT:");    // send server message about user disconnect
 //    socket_->flush();
     qDebug() << "EXIT:";
 
@@ -1214,9 +1632,9 @@ void MainWindow::stopClient(QString msg)
     this->close();
 }
 
-void MainWindow::startGame(QString enemy_login, int gameId)
+void MainWindow::startGame(QString enemy_login, int gameId, const RuleSet& rules)
 {
-    model_->startGame(enemy_login, gameId);
+    model_->startGame(enemy_login, gameId, rules);
 //    controller_->startGame(enemy_login, gameId);
 
     ui->myGameLoginLabel->setText(login_);
@@ -1315,7 +1733,7 @@ void MainWindow::on_gameExitButton_clicked()
     int gameId = model_->getGameId(); // TODO: get gameId;
     QString message = "GAME:" + QString::number(gameId) + ":FINISH";
 
-    socket_->write((message+"@").toUtf8());  // GAME:<gameId:FINISH
+    sendRequest(message);  // GAME:<gameId:FINISH
 //    socket_->flush();
     qDebug() << message;
 }
@@ -1347,7 +1765,7 @@ void MainWindow::on_generateFieldButton_clicked()
         return;
 
     QString message = "GENERATE:";
-    socket_->write((message+"@").toUtf8());
+    sendRequest(message);
 //    socket_->flush();
 
 //    model_->generateMyField();
@@ -1368,8 +1786,27 @@ void MainWindow::on_applyFieldButton_clicked()
 
     qDebug() << "Ship placement is correct! Sending to a server)";
 
-    QString message = "GAME:" + QString::number(model_->getGameId()) + ":" + login_ + ":FIELD:" + model_->getMyFieldStr();
-    socket_->write((message+"@").toUtf8());
+    QString message = "GAME:" + QString::number(model_->getGameId()) + ":" + login_;
+
+    if (!model_->myField_->getRules().isClassic())
+    {
+        // поле правил из GAME:START - списком кораблей
+        std::vector<Ship> ships;
+        model_->myField_->getShips(ships);
+
+        message += ":SHIPS:" + Protocol::encodeShipsText(ships);
+        sendRequest(message);
+    }
+    else
+    {
+        // расстановка - состояния клеток поля по строкам, ненулевое состояние - палуба
+        QString fieldStateStr = model_->myField_->getStateFieldStr();
+        message += ":FIELD:" + Protocol::encodeFieldText(fieldStateStr);
+        if (model_->getProtocolVersion() >= PROTOCOL_VERSION_BINARY)
+            socket_->write(Protocol::encodeField(model_->getGameId(), fieldStateStr));
+        else
+            sendRequest(message);
+    }
 //    socket_->flush();
     qDebug() << message;
 
@@ -1460,7 +1897,7 @@ void MainWindow::updateReadiness(MainWindow::Readiness readiness)
     readiness_ = readiness;
 
     QString message = "READINESS:" + QString::number(readiness_);
-    socket_->write((message+"@").toUtf8());
+    sendRequest(message);
 //    socket_->flush();
     qDebug() << message;
 }
@@ -17,6 +17,7 @@
 #include <QPushButton>
 #include <QString>
 #include <QImage>
+#include <QHash>
 #include <QStringList>
 #include <QListWidget>
 #include <QTextBrowser>
@@ -29,6 +30,8 @@
 #include "model.hpp"
 #include "controller.hpp"
 #include "fightshistorywindow.h"
+#include "framedecoder.hpp"
+#include "protocol.hpp"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -80,6 +83,7 @@ private:
     int port_;
     QTcpSocket* socket_; // socket for interacting with server
     QByteArray data_;    // data from socket and for socket
+    FrameDecoder decoder_;  // splits socket stream into frames
     QString login_;
     Model* model_;
     int timerId_;
@@ -100,20 +104,62 @@ public:
     void connectUser();
     void authenticateUser();
     void handleData();
+
+    /**
+     * @brief Обработать двоичный кадр протокола версии 2
+     * @param frame Код операции и полезная нагрузка
+     */
+    void handleBinaryData(QByteArrayView frame);
+
+    /**
+     * @brief Отправить текстовый запрос серверу в согласованной версии протокола
+     * @param request Запрос без разделителя
+     */
+    void sendRequest(const QString& request);
     void makeUsersRequest();
     void updateUsers(QStringList users_list);
     void sendMessage();
     void connectToGame(const QString& enemy_login);
     void handleMessageRequest();
     void handleShotRequest();
+
+    /**
+     * @brief Применить результат выстрела к полю
+     * @param status Результат выстрела
+     * @param x Координата X
+     * @param y Координата Y
+     */
+    void applyShot(CellDraw status, int x, int y);
     void handleUsersRequest();
+
+    /**
+     * @brief Применить снимок списка пользователей (USERS:SNAPSHOT:<seq>:...)
+     */
+    void handleUsersSnapshot();
+
+    /**
+     * @brief Применить изменение присутствия USER:ADD/UPDATE/REMOVE; при пропуске номера запросить снимок
+     */
+    void handlePresenceRequest();
+
+    /**
+     * @brief Добавить пользователя в меню и список чатов или обновить его состояние
+     */
+    void upsertUser(const QString& login, int status, int readiness);
+
+    /**
+     * @brief Убрать пользователя из меню, списка чатов и удалить его чат
+     */
+    void removeUser(const QString& login);
     void handlePingRequest();
     void handleFieldRequest();
     void handleHistoryUpdateRequest();
+    void handleHistoryPageRequest();
     void handleExitRequest();
     void handleConnectionRequest();
     void handleGameRequest();
     void handleGenerateRequest();
+    void handleErrorRequest();
     void updateChats();
     void stopClient(QString msg);
 
@@ -123,7 +169,7 @@ public:
     void setIconStatus(QAction* userToChoose, int readiness);
 
     void startFight();
-    void startGame(QString enemy_login, int gameId);
+    void startGame(QString enemy_login, int gameId, const RuleSet& rules = RuleSet::classic());
     void finishGame();
 
     QPixmap* getFieldImage(const Field& field);
@@ -177,6 +223,10 @@ public:
 private:
     Readiness readiness_;
 
+    quint64 presenceSeq_;                       // number of the last applied presence change
+    bool presenceSynced_;                       // snapshot received, deltas can be applied
+    QHash<QString, QAction*> userActions_;      // usersList menu action for each login
+
 private:
     Ui::MainWindow* ui;
 };
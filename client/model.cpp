@@ -20,7 +20,8 @@ Model::Model() :
     myField_(new Field(Field::MY_FIELD)),
     enemyField_(new Field(Field::ENEMY_FIELD)),
     gameId_(-1),
-    login_("")
+    login_(""),
+    protocolVersion_(PROTOCOL_VERSION_TEXT)
 {
 }
 
@@ -198,18 +199,18 @@ QString Model::getEnemyFieldStr() const
 
 /**
  * @brief Получение объекта поля игрока.
- * @return Объект поля игрока
+ * @return Поле игрока (без копии: изображение поля кешируется в нём)
  */
-Field Model::getMyField() const
+Field& Model::getMyField() const
 {
     return *myField_;
 }
 
 /**
  * @brief Получение объекта поля противника.
- * @return Объект поля противника
+ * @return Поле противника (без копии: изображение поля кешируется в нём)
  */
-Field Model::getEnemyField() const
+Field& Model::getEnemyField() const
 {
     return *enemyField_;
 }
@@ -303,6 +304,26 @@ void Model::updateEnemyFieldDraw(QVector<CellDraw>& field)
     enemyField_->setDrawField(updatedField);
 }
 
+/**
+ * @brief Применение изменённых клеток поля игрока.
+ * @param ranges Отрезки клеток с новым состоянием
+ */
+void Model::applyMyFieldDiff(const QVector<CellRange>& ranges)
+{
+    myField_->applyDrawRanges(ranges);
+}
+
+/**
+ * @brief Применение изменённых клеток поля противника.
+ * @param ranges Отрезки клеток с новым состоянием
+ *
+ * Сервер присылает только подбитые клетки и ореол, поэтому живые корабли противника не раскрываются.
+ */
+void Model::applyEnemyFieldDiff(const QVector<CellRange>& ranges)
+{
+    enemyField_->applyDrawRanges(ranges);
+}
+
 /**
  * @brief Обновление состояния игры.
  * @param state Новое состояние игры
@@ -381,11 +402,20 @@ bool Model::isMyFieldCorrect() const
  * @brief Начало новой игры.
  * @param enemy_login Логин противника
  * @param gameId ID игры
+ * @param rules Правила игры
  * 
  * Инициализирует новую игру с указанным противником и ID.
+ * Поля меняются, только если правила отличаются от текущих:
+ * расставленные до начала игры корабли классического поля сохраняются.
  */
-void Model::startGame(QString enemy_login, int gameId)
+void Model::startGame(QString enemy_login, int gameId, const RuleSet& rules)
 {
+    if (myField_->getRules() != rules)
+    {
+        myField_->setRules(rules);
+        enemyField_->setRules(rules);
+    }
+
     gameId_ = gameId;
     enemyLogin_ = enemy_login;
     updateState(ST_PLACING_SHIPS);
@@ -394,12 +424,12 @@ void Model::startGame(QString enemy_login, int gameId)
 /**
  * @brief Завершение текущей игры.
  * 
- * Очищает поля игроков и сбрасывает состояние игры.
+ * Очищает поля игроков, возвращает классические правила и сбрасывает состояние игры.
  */
 void Model::finishGame()
 {
-    myField_->clear();
-    enemyField_->clear();
+    myField_->setRules(RuleSet::classic());
+    enemyField_->setRules(RuleSet::classic());
     updateState(ST_GAME_FINISHED);
     updateState(ST_GAME_NSTARTED);
 }
@@ -470,3 +500,13 @@ QString Model::getEnemyLogin()
 {
     return enemyLogin_;
 }
+
+void Model::setProtocolVersion(int version)
+{
+    protocolVersion_ = version;
+}
+
+int Model::getProtocolVersion() const
+{
+    return protocolVersion_;
+}
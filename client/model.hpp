@@ -7,6 +7,7 @@
 #include "config.hpp"
 #include "constants.hpp"
 #include "field.hpp"
+#include "protocol.hpp"
 
 /**
  * @brief Состояния модели игры
@@ -77,8 +78,8 @@ public:
     void setMyField(QString field);
     void initMyDrawField();
     QString getMyFieldStr() const;
-    Field getMyField() const;
-    Field getEnemyField() const;
+    Field& getMyField() const;
+    Field& getEnemyField() const;
     bool isMyFieldCorrect() const;
     void clearMyField();
 
@@ -94,6 +95,18 @@ public:
      */
     void updateEnemyFieldDraw(QVector<CellDraw>& field);
 
+    /**
+     * @brief Применить изменённые клетки поля игрока
+     * @param ranges Отрезки клеток с новым состоянием
+     */
+    void applyMyFieldDiff(const QVector<CellRange>& ranges);
+
+    /**
+     * @brief Применить изменённые клетки поля противника
+     * @param ranges Отрезки клеток с новым состоянием
+     */
+    void applyEnemyFieldDiff(const QVector<CellRange>& ranges);
+
     /**
      * @brief Передать ход
      */
@@ -104,6 +117,17 @@ public:
     void setEnemyLogin(QString login);
     QString getEnemyLogin();
 
+    /**
+     * @brief Установить версию протокола, согласованную при авторизации
+     * @param version PROTOCOL_VERSION_TEXT или PROTOCOL_VERSION_BINARY
+     */
+    void setProtocolVersion(int version);
+
+    /**
+     * @brief Получить версию протокола
+     */
+    int getProtocolVersion() const;
+
     /**
      * @brief Сгенерировать случайную расстановку кораблей
      */
@@ -118,8 +142,9 @@ public:
      * @brief Начать игру
      * @param enemy_login Логин противника
      * @param gameId ID игры
+     * @param rules Правила игры (размер поля и флот)
      */
-    void startGame(QString enemy_login, int gameId);
+    void startGame(QString enemy_login, int gameId, const RuleSet& rules = RuleSet::classic());
 
     /**
      * @brief Завершить игру
@@ -136,6 +161,7 @@ private:
     QString login_;       ///< Логин игрока
     QString enemyLogin_;  ///< Логин противника
     int gameId_;         ///< ID текущей игры
+    int protocolVersion_; ///< Версия протокола обмена с сервером
 };
 
 
@@ -0,0 +1,174 @@
+#include "framedecoder.hpp"
+#include "protocol.hpp"
+
+FrameDecoder::FrameDecoder(qsizetype maxFrameSize) :
+    mode_(MODE_TEXT)            ,
+    buffer_()                   ,
+    begin_(0)                   ,
+    scanned_(0)                 ,
+    maxFrameSize_(maxFrameSize) ,
+    overflowed_(false)          ,
+    discarding_(false)          ,
+    broken_(false)
+{
+
+}
+
+qint64 FrameDecoder::readFrom(QIODevice* device)
+{
+    qint64 available = device->bytesAvailable();
+
+    if (available <= 0)
+        return 0;
+
+    // resize() не уменьшает ёмкость, поэтому после первых чтений буфер больше не перевыделяется
+    qsizetype oldSize = buffer_.size();
+    buffer_.resize(oldSize + available);
+
+    qint64 nRead = device->read(buffer_.data() + oldSize, available);
+    if (nRead < 0)
+        nRead = 0;
+
+    buffer_.resize(oldSize + nRead);
+
+    return nRead;
+}
+
+bool FrameDecoder::nextFrame(QByteArrayView& frame)
+{
+    if (broken_)
+        return false;
+
+    if (mode_ == MODE_BINARY)
+        return nextBinaryFrame(frame);
+
+    return nextTextFrame(frame);
+}
+
+bool FrameDecoder::nextTextFrame(QByteArrayView& frame)
+{
+    qsizetype end = buffer_.indexOf(FRAME_DELIMITER, scanned_);
+
+    while (discarding_)     // остаток слишком длинного кадра - до разделителя включительно
+    {
+        if (end < 0)
+        {
+            begin_ = scanned_ = buffer_.size();
+            return false;
+        }
+
+        discarding_ = false;
+        begin_ = scanned_ = end + 1;
+        end = buffer_.indexOf(FRAME_DELIMITER, scanned_);
+    }
+
+    if (end < 0)
+    {
+        scanned_ = buffer_.size();
+
+        if (scanned_ - begin_ > maxFrameSize_)  // разделителя нет слишком долго - отбрасываем кадр целиком
+        {
+            begin_ = scanned_;
+            overflowed_ = true;
+            discarding_ = true;
+        }
+
+        return false;
+    }
+
+    frame = QByteArrayView(buffer_.constData() + begin_, end - begin_);
+    begin_ = end + 1;
+    scanned_ = begin_;
+
+    return true;
+}
+
+bool FrameDecoder::nextBinaryFrame(QByteArrayView& frame)
+{
+    qsizetype pos = begin_;
+    quint32 length = 0;
+
+    switch (Protocol::readVarint(QByteArrayView(buffer_), pos, length))
+    {
+        case Protocol::VARINT_NEED_MORE:
+            return false;
+
+        case Protocol::VARINT_MALFORMED:
+        {
+            // границы кадров потеряны, восстановиться в потоке уже нельзя
+            begin_ = buffer_.size();
+            broken_ = true;
+            return false;
+        }
+
+        case Protocol::VARINT_OK:
+            break;
+    }
+
+    if (length == 0 || (qsizetype)length > maxFrameSize_)
+    {
+        // тело кадра не пропустить: следующие байты читались бы как длины и коды
+        begin_ = buffer_.size();
+        broken_ = true;
+        return false;
+    }
+
+    if (buffer_.size() - pos < (qsizetype)length)
+        return false;
+
+    frame = QByteArrayView(buffer_.constData() + pos, length);
+    begin_ = pos + length;
+    scanned_ = begin_;
+
+    return true;
+}
+
+void FrameDecoder::setMode(Mode mode)
+{
+    mode_ = mode;
+    scanned_ = begin_;
+}
+
+FrameDecoder::Mode FrameDecoder::getMode() const
+{
+    return mode_;
+}
+
+void FrameDecoder::compact()
+{
+    if (begin_ == 0)
+        return;
+
+    buffer_.remove(0, begin_);  // сдвиг внутри той же памяти, ёмкость сохраняется
+    scanned_ -= begin_;
+    begin_ = 0;
+}
+
+void FrameDecoder::reset()
+{
+    mode_ = MODE_TEXT;
+    buffer_.resize(0);
+    begin_ = 0;
+    scanned_ = 0;
+    overflowed_ = false;
+    discarding_ = false;
+    broken_ = false;
+}
+
+qsizetype FrameDecoder::pendingSize() const
+{
+    return buffer_.size() - begin_;
+}
+
+bool FrameDecoder::takeOverflow()
+{
+    bool overflowed = overflowed_;
+    overflowed_ = false;
+
+    return overflowed;
+}
+
+bool FrameDecoder::isBroken() const
+{
+    return broken_;
+}
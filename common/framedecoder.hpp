@@ -0,0 +1,119 @@
+/**
+ * @file framedecoder.hpp
+ * @brief Потоковый декодер кадров сетевого протокола
+ *
+ * Накапливает байты, пришедшие из сокета, между сигналами readyRead
+ * и выделяет из них полные кадры: завершённые разделителем '@' в текстовом
+ * режиме или с префиксом длины в двоичном (см. protocol.hpp).
+ * Неполный хвост кадра сохраняется до следующего чтения.
+ */
+
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QIODevice>
+
+#define FRAME_DELIMITER         '@'         ///< Разделитель кадров текстового протокола
+#define FRAME_MAX_SIZE_DEFAULT  (64*1024)   ///< Максимальный размер одного кадра в байтах
+
+/**
+ * @brief Класс инкрементального декодера кадров
+ *
+ * Хранит переиспользуемый буфер приёма. Кадры выдаются в виде
+ * QByteArrayView, указывающих прямо в буфер, без копирования.
+ * Представления действительны до следующего вызова readFrom(), compact() или reset().
+ */
+class FrameDecoder
+{
+public:
+    /**
+     * @brief Режим выделения кадров
+     */
+    enum Mode
+    {
+        MODE_TEXT = 0,  ///< Кадры завершаются разделителем '@'
+        MODE_BINARY  ,  ///< Кадры предваряются длиной в формате varint
+    };
+
+    /**
+     * @brief Конструктор
+     * @param maxFrameSize Максимальный размер кадра, при превышении которого кадр отбрасывается
+     */
+    explicit FrameDecoder(qsizetype maxFrameSize = FRAME_MAX_SIZE_DEFAULT);
+
+    /**
+     * @brief Дочитать все доступные байты из устройства в буфер
+     * @param device Устройство (сокет) для чтения
+     * @return Количество прочитанных байт
+     */
+    qint64 readFrom(QIODevice* device);
+
+    /**
+     * @brief Получить следующий полный кадр
+     * @param frame Представление кадра внутри буфера (без разделителя или без префикса длины)
+     * @return true если полный кадр найден
+     */
+    bool nextFrame(QByteArrayView& frame);
+
+    /**
+     * @brief Переключить режим; уже выданные кадры не затрагиваются
+     * @param mode Новый режим
+     */
+    void setMode(Mode mode);
+
+    /**
+     * @brief Получить текущий режим
+     * @return Режим выделения кадров
+     */
+    Mode getMode() const;
+
+    /**
+     * @brief Удалить из буфера уже выданные кадры, сохранив выделенную память
+     */
+    void compact();
+
+    /**
+     * @brief Сбросить буфер и все позиции
+     */
+    void reset();
+
+    /**
+     * @brief Получить размер накопленного неполного кадра
+     * @return Количество байт без разделителя
+     */
+    qsizetype pendingSize() const;
+
+    /**
+     * @brief Проверить и сбросить флаг переполнения
+     * @return true если с прошлого вызова был отброшен слишком длинный кадр
+     */
+    bool takeOverflow();
+
+    /**
+     * @brief Проверить, потеряны ли границы кадров
+     *
+     * В двоичном режиме неверный varint или недопустимая длина означают, что
+     * следующие байты - середина неизвестного кадра. Восстановиться в потоке
+     * нельзя: декодер больше не выдаёт кадров, соединение нужно разорвать.
+     * @return true если поток испорчен
+     */
+    bool isBroken() const;
+
+private:
+    bool nextTextFrame(QByteArrayView& frame);
+    bool nextBinaryFrame(QByteArrayView& frame);
+
+private:
+    Mode       mode_;           ///< Режим выделения кадров
+    QByteArray buffer_;         ///< Буфер приёма, переиспользуемый между чтениями
+    qsizetype  begin_;          ///< Начало ещё не выданных данных
+    qsizetype  scanned_;        ///< Позиция, до которой буфер уже просмотрен в поиске разделителя
+    qsizetype  maxFrameSize_;   ///< Максимальный размер кадра
+    bool       overflowed_;     ///< Был ли отброшен слишком длинный кадр
+    bool       discarding_;     ///< Отбрасывается хвост слишком длинного текстового кадра до разделителя
+    bool       broken_;         ///< Границы двоичных кадров потеряны
+};
+
+#endif // FRAMEDECODER_H
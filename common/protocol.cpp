@@ -0,0 +1,298 @@
+#include "protocol.hpp"
+#include <QStringList>
+#include <QtEndian>
+
+void Protocol::appendVarint(QByteArray& out, quint32 value)
+{
+    while (value >= 0x80)
+    {
+        out.append((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    out.append((char)value);
+}
+
+Protocol::VarintStatus Protocol::readVarint(QByteArrayView data, qsizetype& pos, quint32& value)
+{
+    quint32 result = 0;
+    qsizetype cur = pos;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (cur >= data.size())
+            return VARINT_NEED_MORE;
+
+        quint8 byte = (quint8)data[cur++];
+        result |= (quint32)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+        {
+            value = result;
+            pos = cur;
+            return VARINT_OK;
+        }
+    }
+
+    return VARINT_MALFORMED;
+}
+
+QByteArray Protocol::encodeFrame(Opcode opcode, QByteArrayView payload)
+{
+    QByteArray frame;
+    frame.reserve(5 + 1 + payload.size());
+
+    appendVarint(frame, 1 + payload.size());
+    frame.append((char)opcode);
+    frame.append(payload.data(), payload.size());
+
+    return frame;
+}
+
+QByteArray Protocol::encodeText(const QString& message, int version)
+{
+    if (version < PROTOCOL_VERSION_BINARY)
+        return (message + "@").toUtf8();
+
+    return encodeFrame(OP_TEXT, message.toUtf8());
+}
+
+QByteArray Protocol::encodeShot(quint32 gameId, int x, int y)
+{
+    char payload[6];
+    qToLittleEndian<quint32>(gameId, payload);
+    payload[4] = (char)x;
+    payload[5] = (char)y;
+
+    return encodeFrame(OP_SHOT, QByteArrayView(payload, sizeof(payload)));
+}
+
+bool Protocol::decodeShot(QByteArrayView payload, quint32& gameId, int& x, int& y)
+{
+    if (payload.size() != 6)
+        return false;
+
+    gameId = qFromLittleEndian<quint32>(payload.data());
+    x = (quint8)payload[4];
+    y = (quint8)payload[5];
+
+    return true;
+}
+
+QByteArray Protocol::encodeShotResult(ShotResult result, int x, int y)
+{
+    char payload[3] = { (char)result, (char)x, (char)y };
+
+    return encodeFrame(OP_SHOT_RESULT, QByteArrayView(payload, sizeof(payload)));
+}
+
+bool Protocol::decodeShotResult(QByteArrayView payload, ShotResult& result, int& x, int& y)
+{
+    if (payload.size() != 3 || (quint8)payload[0] > SHOT_KILLED)
+        return false;
+
+    result = (ShotResult)payload[0];
+    x = (quint8)payload[1];
+    y = (quint8)payload[2];
+
+    return true;
+}
+
+QByteArray Protocol::encodeField(quint32 gameId, QStringView field)
+{
+    char payload[4 + PROTOCOL_FIELD_BITS_SIZE] = {};
+    qToLittleEndian<quint32>(gameId, payload);
+    packFieldBits(field, payload + 4);
+
+    return encodeFrame(OP_FIELD, QByteArrayView(payload, sizeof(payload)));
+}
+
+bool Protocol::decodeField(QByteArrayView payload, quint32& gameId, QString& fieldBin)
+{
+    if (payload.size() != 4 + PROTOCOL_FIELD_BITS_SIZE)
+        return false;
+
+    gameId = qFromLittleEndian<quint32>(payload.data());
+    unpackFieldBits(payload.data() + 4, fieldBin);
+
+    return true;
+}
+
+void Protocol::packFieldBits(QStringView field, char* out)
+{
+    for (int i = 0; i < field.size() && i < PROTOCOL_FIELD_AREA; i++)
+    {
+        if (field[i] != QLatin1Char('0'))
+            out[i/8] |= (char)(1 << (i % 8));
+    }
+}
+
+void Protocol::unpackFieldBits(const char* in, QString& fieldBin)
+{
+    fieldBin.resize(PROTOCOL_FIELD_AREA);
+
+    for (int i = 0; i < PROTOCOL_FIELD_AREA; i++)
+        fieldBin[i] = ((quint8)in[i/8] >> (i % 8)) & 1 ? QLatin1Char('1') : QLatin1Char('0');
+}
+
+QString Protocol::encodeFieldText(QStringView field)
+{
+    char packed[PROTOCOL_FIELD_BITS_SIZE] = {};
+    packFieldBits(field, packed);
+
+    return encodePackedText(QByteArrayView(packed, sizeof(packed)));
+}
+
+bool Protocol::decodeFieldText(QStringView text, QString& fieldBin)
+{
+    if (text.size() == PROTOCOL_FIELD_AREA)     // прежняя запись цифрами
+    {
+        fieldBin.resize(PROTOCOL_FIELD_AREA);
+
+        for (int i = 0; i < PROTOCOL_FIELD_AREA; i++)
+        {
+            if (!text[i].isDigit())
+                return false;
+
+            fieldBin[i] = text[i] == QLatin1Char('0') ? QLatin1Char('0') : QLatin1Char('1');
+        }
+
+        return true;
+    }
+
+    QByteArray packed;
+    if (!decodePackedText(text, PROTOCOL_FIELD_BITS_SIZE, packed))
+        return false;
+
+    unpackFieldBits(packed.constData(), fieldBin);
+    return true;
+}
+
+// отрезок целиком внутри поля, состояние помещается в 3 бита
+static bool isRangeValid(const CellRange& range, int area = PROTOCOL_FIELD_AREA)
+{
+    return range.start_ >= 0 && range.count_ > 0 && range.start_ + range.count_ <= area &&
+           range.state_ >= 0 && range.state_ < (1 << PROTOCOL_FIELD_DRAW_BITS);
+}
+
+QByteArray Protocol::encodeFieldDiff(FieldOwner owner, const QVector<CellRange>& ranges)
+{
+    int nRanges = qMin<int>(ranges.size(), 255);
+
+    QByteArray payload;
+    payload.reserve(PROTOCOL_FIELD_DIFF_SIZE(nRanges));
+    payload.append((char)owner);
+    payload.append((char)nRanges);
+
+    for (int i = 0; i < nRanges; i++)
+    {
+        payload.append((char)ranges[i].start_);
+        payload.append((char)ranges[i].count_);
+        payload.append((char)ranges[i].state_);
+    }
+
+    return encodeFrame(OP_FIELD_DIFF, payload);
+}
+
+bool Protocol::decodeFieldDiff(QByteArrayView payload, FieldOwner& owner, QVector<CellRange>& ranges, int area)
+{
+    if (payload.size() < 2 || payload.size() != PROTOCOL_FIELD_DIFF_SIZE((quint8)payload[1]))
+        return false;
+
+    owner = (FieldOwner)payload[0];
+    int nRanges = (quint8)payload[1];
+
+    ranges.resize(nRanges);
+    for (int i = 0; i < nRanges; i++)
+    {
+        ranges[i].start_ = (quint8)payload[2 + 3*i];
+        ranges[i].count_ = (quint8)payload[3 + 3*i];
+        ranges[i].state_ = (quint8)payload[4 + 3*i];
+
+        if (!isRangeValid(ranges[i], area))
+            return false;
+    }
+
+    return true;
+}
+
+QString Protocol::encodeFieldDiffText(const QVector<CellRange>& ranges)
+{
+    QStringList parts;
+
+    for (const CellRange& range : ranges)
+        parts.append(QString::number(range.start_) + ',' + QString::number(range.count_) + ',' + QString::number(range.state_));
+
+    return parts.join(';');
+}
+
+bool Protocol::decodeFieldDiffText(QStringView text, QVector<CellRange>& ranges, int area)
+{
+    ranges.clear();
+
+    for (QStringView part : text.split(u';', Qt::SkipEmptyParts))
+    {
+        QList<QStringView> values = part.split(u',');
+        if (values.size() != 3)
+            return false;
+
+        bool okStart = false, okCount = false, okState = false;
+        CellRange range = { values[0].toInt(&okStart), values[1].toInt(&okCount), values[2].toInt(&okState) };
+
+        if (!okStart || !okCount || !okState || !isRangeValid(range, area))
+            return false;
+
+        ranges.append(range);
+    }
+
+    return !ranges.isEmpty();
+}
+
+QString Protocol::encodeShipsText(const std::vector<Ship>& ships)
+{
+    QByteArray packed;
+    packed.reserve(PROTOCOL_SHIP_SIZE * (qsizetype)ships.size());
+
+    for (const Ship& ship : ships)
+    {
+        packed.append((char)ship.x_);
+        packed.append((char)ship.y_);
+        packed.append((char)(ship.length_ | (ship.vertical_ ? 0x80 : 0)));
+    }
+
+    return encodePackedText(packed);
+}
+
+bool Protocol::decodeShipsText(QStringView text, std::vector<Ship>& ships)
+{
+    QByteArray::FromBase64Result result = QByteArray::fromBase64Encoding(text.toLatin1(), PROTOCOL_BASE64_OPTIONS | QByteArray::AbortOnBase64DecodingErrors);
+
+    if (!result || result.decoded.isEmpty() || result.decoded.size() % PROTOCOL_SHIP_SIZE != 0)
+        return false;
+
+    const QByteArray& packed = result.decoded;
+    ships.clear();
+    ships.reserve(packed.size() / PROTOCOL_SHIP_SIZE);
+
+    // координаты и длину проверяет SparseBoard::isCorrect по правилам игры
+    for (qsizetype i = 0; i < packed.size(); i += PROTOCOL_SHIP_SIZE)
+        ships.push_back(Ship{ (quint8)packed[i], (quint8)packed[i + 1], (quint8)packed[i + 2] & 0x7F, ((quint8)packed[i + 2] & 0x80) != 0 });
+
+    return true;
+}
+
+QString Protocol::encodePackedText(QByteArrayView packed)
+{
+    return QString::fromLatin1(packed.toByteArray().toBase64(PROTOCOL_BASE64_OPTIONS));
+}
+
+bool Protocol::decodePackedText(QStringView text, int size, QByteArray& packed)
+{
+    QByteArray::FromBase64Result result = QByteArray::fromBase64Encoding(text.toLatin1(), PROTOCOL_BASE64_OPTIONS | QByteArray::AbortOnBase64DecodingErrors);
+
+    if (!result || result.decoded.size() != size)
+        return false;
+
+    packed = result.decoded;
+    return true;
+}
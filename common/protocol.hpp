@@ -0,0 +1,366 @@
+/**
+ * @file protocol.hpp
+ * @brief Кодирование кадров сетевого протокола, общее для клиента и сервера
+ *
+ * Версия 1 - текстовые сообщения вида "GAME:<id>:<login>:SHOT:<x>:<y>@".
+ * Версия 2 - двоичные кадры: длина (varint), байт кода операции и поля
+ * фиксированной ширины. Версия 2 согласуется при авторизации
+ * (AUTH:<login>:V2 -> AUTH:SUCCESS:V2), всё после этого ответа идёт в двоичном виде.
+ *
+ * Поля в обеих версиях упакованы: расстановка - 1 бит на клетку (13 байт),
+ * отрисовка - 3 бита на клетку (38 байт). В текстовых сообщениях и в БД
+ * упакованные байты записываются base64url без '=' (18 и 51 символ).
+ *
+ * Поля других размеров (правила из GAME:START) передаются списком кораблей
+ * по 3 байта и изменениями FIELD:DIFF: размер сообщений зависит от флота и
+ * длины корабля, а не от площади поля.
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QString>
+#include <QVector>
+#include <vector>
+#include "sparseboard.hpp"  // Ship - расстановка полей с правилами, выбранными при GAME:START
+
+#define PROTOCOL_VERSION_TEXT       1       ///< Текстовый протокол с разделителем '@'
+#define PROTOCOL_VERSION_BINARY     2       ///< Двоичный протокол с префиксом длины
+#define PROTOCOL_V2_TOKEN           "V2"    ///< Маркер версии 2 в запросе и ответе AUTH
+
+#define PROTOCOL_FIELD_WIDTH        10                                              ///< Ширина поля в кадрах
+#define PROTOCOL_FIELD_HEIGHT       10                                              ///< Высота поля в кадрах
+#define PROTOCOL_FIELD_AREA         (PROTOCOL_FIELD_WIDTH*PROTOCOL_FIELD_HEIGHT)    ///< Количество клеток поля
+#define PROTOCOL_FIELD_BITS_SIZE    ((PROTOCOL_FIELD_AREA+7)/8)                     ///< Размер битовой расстановки (13 байт)
+#define PROTOCOL_FIELD_DRAW_BITS    3                                               ///< Бит на клетку поля отрисовки (состояния 0..7)
+#define PROTOCOL_FIELD_DRAW_SIZE    ((PROTOCOL_FIELD_AREA*PROTOCOL_FIELD_DRAW_BITS+7)/8)   ///< Размер поля отрисовки (38 байт)
+#define PROTOCOL_FIELD_DIFF_SIZE(n) (2 + 3*(n))                                     ///< Размер FIELD_DIFF из n отрезков
+#define PROTOCOL_SHIP_SIZE          3                                               ///< Корабль в списке расстановки: x(u8) y(u8) length | vertical << 7 (u8)
+#define PROTOCOL_BASE64_OPTIONS     (QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals)   ///< base64 без ':' и '@
+
+/**
+ * @brief Коды операций двоичного протокола
+ */
+enum Opcode
+{
+    OP_TEXT         = 0x00, ///< Текстовое сообщение версии 1 целиком (редкие команды)
+    OP_SHOT         = 0x01, ///< К->С: gameId(u32) x(u8) y(u8)
+    OP_SHOT_RESULT  = 0x02, ///< С->К: result(u8) x(u8) y(u8)
+    OP_FIELD        = 0x03, ///< К->С: gameId(u32) расстановка по 1 биту на клетку
+    OP_FIELD_UPDATE = 0x04, ///< С->К: owner(u8) состояния отрисовки по 3 бита на клетку
+    OP_FIELD_DIFF   = 0x05, ///< С->К: owner(u8) n(u8) n отрезков start(u8) count(u8) state(u8)
+};
+
+/**
+ * @brief Результат выстрела в двоичном протоколе
+ */
+enum ShotResult
+{
+    SHOT_DOT     = 0,   ///< Промах
+    SHOT_DAMAGED    ,   ///< Попадание
+    SHOT_KILLED     ,   ///< Корабль уничтожен
+};
+
+/**
+ * @brief Владелец поля в FIELD_UPDATE
+ */
+enum FieldOwner
+{
+    OWNER_MY    = 0,    ///< Поле получателя
+    OWNER_ENEMY    ,    ///< Поле противника получателя
+};
+
+/**
+ * @brief Клетки подряд с одним новым состоянием отрисовки (FIELD_DIFF)
+ */
+struct CellRange
+{
+    int start_;     ///< Первая клетка (y*width + x)
+    int count_;     ///< Количество клеток
+    int state_;     ///< Новое состояние отрисовки
+};
+
+namespace Protocol
+{
+    /**
+     * @brief Результат чтения varint
+     */
+    enum VarintStatus
+    {
+        VARINT_OK = 0   ,   ///< Значение прочитано
+        VARINT_NEED_MORE,   ///< Данных пока недостаточно
+        VARINT_MALFORMED,   ///< Слишком длинная запись
+    };
+
+    /**
+     * @brief Дописать беззнаковое число в формате varint (7 бит на байт)
+     * @param out Выходной буфер
+     * @param value Значение
+     */
+    void appendVarint(QByteArray& out, quint32 value);
+
+    /**
+     * @brief Прочитать varint
+     * @param data Входные данные
+     * @param pos Позиция чтения, сдвигается за прочитанное значение
+     * @param value Прочитанное значение
+     * @return Статус чтения
+     */
+    VarintStatus readVarint(QByteArrayView data, qsizetype& pos, quint32& value);
+
+    /**
+     * @brief Собрать двоичный кадр
+     * @param opcode Код операции
+     * @param payload Полезная нагрузка
+     * @return Кадр с префиксом длины
+     */
+    QByteArray encodeFrame(Opcode opcode, QByteArrayView payload);
+
+    /**
+     * @brief Закодировать текстовое сообщение для получателя нужной версии
+     * @param message Сообщение без разделителя
+     * @param version Версия протокола получателя
+     * @return "message@" для версии 1 или кадр OP_TEXT для версии 2
+     */
+    QByteArray encodeText(const QString& message, int version);
+
+    /**
+     * @brief Закодировать выстрел
+     */
+    QByteArray encodeShot(quint32 gameId, int x, int y);
+
+    /**
+     * @brief Декодировать выстрел
+     * @return false если нагрузка некорректна
+     */
+    bool decodeShot(QByteArrayView payload, quint32& gameId, int& x, int& y);
+
+    /**
+     * @brief Закодировать результат выстрела
+     */
+    QByteArray encodeShotResult(ShotResult result, int x, int y);
+
+    /**
+     * @brief Декодировать результат выстрела
+     * @return false если нагрузка некорректна
+     */
+    bool decodeShotResult(QByteArrayView payload, ShotResult& result, int& x, int& y);
+
+    /**
+     * @brief Закодировать расстановку кораблей
+     * @param gameId ID игры
+     * @param field Строка из PROTOCOL_FIELD_AREA цифр, ненулевая цифра - палуба
+     */
+    QByteArray encodeField(quint32 gameId, QStringView field);
+
+    /**
+     * @brief Декодировать расстановку кораблей
+     * @param payload Полезная нагрузка
+     * @param gameId ID игры
+     * @param fieldBin Строка из '0' и '1'
+     * @return false если нагрузка некорректна
+     */
+    bool decodeField(QByteArrayView payload, quint32& gameId, QString& fieldBin);
+
+    /**
+     * @brief Упаковать расстановку по биту на клетку
+     * @param field Строка из PROTOCOL_FIELD_AREA цифр, ненулевая цифра - палуба
+     * @param out PROTOCOL_FIELD_BITS_SIZE обнулённых байт
+     */
+    void packFieldBits(QStringView field, char* out);
+
+    /**
+     * @brief Распаковать расстановку
+     * @param in PROTOCOL_FIELD_BITS_SIZE байт
+     * @param fieldBin Строка из '0' и '1'
+     */
+    void unpackFieldBits(const char* in, QString& fieldBin);
+
+    /**
+     * @brief Записать расстановку для текстового протокола и БД
+     * @param field Строка из PROTOCOL_FIELD_AREA цифр, ненулевая цифра - палуба
+     * @return 18 символов base64url
+     */
+    QString encodeFieldText(QStringView field);
+
+    /**
+     * @brief Прочитать расстановку из текстового протокола или БД
+     *
+     * Понимает и прежнюю запись из PROTOCOL_FIELD_AREA цифр (старые строки БД и клиенты).
+     * @param text Упакованная расстановка
+     * @param fieldBin Строка из '0' и '1'
+     * @return false если запись некорректна
+     */
+    bool decodeFieldText(QStringView text, QString& fieldBin);
+
+    /**
+     * @brief Записать упакованное поле base64url без '='
+     * @param packed Упакованные байты
+     */
+    QString encodePackedText(QByteArrayView packed);
+
+    /**
+     * @brief Раскодировать base64url упакованного поля
+     * @param text Запись base64url
+     * @param size Ожидаемый размер в байтах
+     * @param packed Упакованные байты
+     * @return false если запись некорректна или другого размера
+     */
+    bool decodePackedText(QStringView text, int size, QByteArray& packed);
+
+    /**
+     * @brief Упаковать поле отрисовки по PROTOCOL_FIELD_DRAW_BITS бита на клетку
+     * @param cells Состояния клеток (0..7): QVector или представление с size() и operator[]
+     * @param out PROTOCOL_FIELD_DRAW_SIZE обнулённых байт
+     */
+    template<typename Cells>
+    void packFieldDraw(const Cells& cells, char* out)
+    {
+        for (int i = 0; i < cells.size() && i < PROTOCOL_FIELD_AREA; i++)
+        {
+            int bit = PROTOCOL_FIELD_DRAW_BITS * i;
+            unsigned value = (unsigned)cells[i] & 0x07;
+
+            out[bit / 8] |= (char)(value << (bit % 8));
+            if (bit % 8 > 8 - PROTOCOL_FIELD_DRAW_BITS)     // клетка на стыке байтов
+                out[bit / 8 + 1] |= (char)(value >> (8 - bit % 8));
+        }
+    }
+
+    /**
+     * @brief Распаковать поле отрисовки
+     * @param in PROTOCOL_FIELD_DRAW_SIZE байт
+     * @param cells Состояния клеток
+     */
+    template<typename Cell>
+    void unpackFieldDraw(const char* in, QVector<Cell>& cells)
+    {
+        cells.resize(PROTOCOL_FIELD_AREA);
+
+        for (int i = 0; i < PROTOCOL_FIELD_AREA; i++)
+        {
+            int bit = PROTOCOL_FIELD_DRAW_BITS * i;
+            unsigned word = (quint8)in[bit / 8];
+            if (bit / 8 + 1 < PROTOCOL_FIELD_DRAW_SIZE)
+                word |= (unsigned)(quint8)in[bit / 8 + 1] << 8;
+
+            cells[i] = (Cell)((word >> (bit % 8)) & 0x07);
+        }
+    }
+
+    /**
+     * @brief Записать поле отрисовки для текстового протокола
+     * @param cells Состояния клеток: QVector или представление с size() и operator[]
+     * @return 51 символ base64url
+     */
+    template<typename Cells>
+    QString encodeFieldDrawText(const Cells& cells)
+    {
+        char packed[PROTOCOL_FIELD_DRAW_SIZE] = {};
+        packFieldDraw(cells, packed);
+
+        return encodePackedText(QByteArrayView(packed, sizeof(packed)));
+    }
+
+    /**
+     * @brief Прочитать поле отрисовки из текстового протокола
+     * @param text Упакованное поле
+     * @param cells Состояния клеток
+     * @return false если запись некорректна
+     */
+    template<typename Cell>
+    bool decodeFieldDrawText(QStringView text, QVector<Cell>& cells)
+    {
+        QByteArray packed;
+        if (!decodePackedText(text, PROTOCOL_FIELD_DRAW_SIZE, packed))
+            return false;
+
+        unpackFieldDraw(packed.constData(), cells);
+        return true;
+    }
+
+    /**
+     * @brief Закодировать поле отрисовки
+     * @param owner Чьё это поле для получателя
+     * @param cells Состояния клеток (значения от 0 до 7): QVector или представление с size() и operator[]
+     */
+    template<typename Cells>
+    QByteArray encodeFieldUpdate(FieldOwner owner, const Cells& cells)
+    {
+        char payload[1 + PROTOCOL_FIELD_DRAW_SIZE] = {};
+        payload[0] = (char)owner;
+        packFieldDraw(cells, payload + 1);
+
+        return encodeFrame(OP_FIELD_UPDATE, QByteArrayView(payload, sizeof(payload)));
+    }
+
+    /**
+     * @brief Закодировать изменённые клетки поля отрисовки
+     * @param owner Чьё это поле для получателя
+     * @param ranges Отрезки изменённых клеток (не больше 255)
+     */
+    QByteArray encodeFieldDiff(FieldOwner owner, const QVector<CellRange>& ranges);
+
+    /**
+     * @brief Декодировать изменённые клетки поля отрисовки
+     * @param payload Полезная нагрузка
+     * @param owner Чьё это поле для получателя
+     * @param ranges Отрезки изменённых клеток
+     * @param area Количество клеток поля (номер клетки - байт, не больше 256)
+     * @return false если нагрузка некорректна
+     */
+    bool decodeFieldDiff(QByteArrayView payload, FieldOwner& owner, QVector<CellRange>& ranges, int area = PROTOCOL_FIELD_AREA);
+
+    /**
+     * @brief Записать расстановку списком кораблей (поля с правилами из GAME:START)
+     * @param ships Корабли
+     * @return PROTOCOL_SHIP_SIZE байт на корабль в base64url
+     */
+    QString encodeShipsText(const std::vector<Ship>& ships);
+
+    /**
+     * @brief Прочитать расстановку списком кораблей
+     * @param text Запись encodeShipsText
+     * @param ships Корабли
+     * @return false если запись некорректна
+     */
+    bool decodeShipsText(QStringView text, std::vector<Ship>& ships);
+
+    /**
+     * @brief Записать изменённые клетки для текстового протокола
+     * @return "<start>,<count>,<state>;..."
+     */
+    QString encodeFieldDiffText(const QVector<CellRange>& ranges);
+
+    /**
+     * @brief Прочитать изменённые клетки из текстового протокола
+     * @param text "<start>,<count>,<state>;..."
+     * @param ranges Отрезки изменённых клеток
+     * @param area Количество клеток поля
+     * @return false если запись некорректна
+     */
+    bool decodeFieldDiffText(QStringView text, QVector<CellRange>& ranges, int area = PROTOCOL_FIELD_AREA);
+
+    /**
+     * @brief Декодировать поле отрисовки
+     * @param payload Полезная нагрузка
+     * @param owner Чьё это поле для получателя
+     * @param cells Состояния клеток
+     * @return false если нагрузка некорректна
+     */
+    template<typename Cell>
+    bool decodeFieldUpdate(QByteArrayView payload, FieldOwner& owner, QVector<Cell>& cells)
+    {
+        if (payload.size() != 1 + PROTOCOL_FIELD_DRAW_SIZE)
+            return false;
+
+        owner = (FieldOwner)payload[0];
+        unpackFieldDraw(payload.data() + 1, cells);
+
+        return true;
+    }
+}
+
+#endif // PROTOCOL_H
@@ -0,0 +1,274 @@
+/**
+ * @file shotbench.cpp
+ * @brief Замер разрешения выстрела на поле ядра
+ *
+ * Повторяет шаги Server::handleShot над Board (проверка клетки, попадание,
+ * уничтожение, ореол, конец игры) и считает выделения памяти через
+ * подменённый operator new. Путь выстрела должен работать на месте,
+ * без копий поля: ожидается 0 выделений на выстрел.
+ *
+ * Замер идёт на классическом поле и на поле 16x16 с большим флотом:
+ * оба варианта - отдельные специализации Board.
+ *
+ * Правила, выбранные во время игры, играются на SparseBoard для полей от
+ * 10x10 до 100x100. Время выстрела не должно расти с площадью поля, а
+ * размер FIELD:DIFF после уничтожения - зависеть только от длины корабля.
+ * Для сравнения выводится и размер расстановки: списком кораблей и битами.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <array>
+#include <algorithm>
+#include <vector>
+#include "board.hpp"
+#include "sparseboard.hpp"
+
+static unsigned long long nAllocations = 0;    ///< Сколько раз вызван operator new
+
+void* operator new(std::size_t size)
+{
+    nAllocations++;
+
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/**
+ * @brief Разрешить выстрел так же, как Server::handleShot
+ * @return true, если флот уничтожен
+ */
+template<class B>
+static bool resolveShot(B& board, int index)
+{
+    if (!board.getShips().test(index))
+    {
+        board.setCellDraw(index, CELL_DOT);
+        return false;
+    }
+
+    if (!board.isKilled(index))
+    {
+        board.setCellDraw(index, CELL_DAMAGED);
+        return false;
+    }
+
+    board.markKilled(index);
+    return board.isFleetDestroyed();
+}
+
+/**
+ * @brief Расставить флот по строкам через одну, корабли через клетку
+ */
+template<class B>
+static typename B::Mask placeFleet()
+{
+    typename B::Mask ships;
+
+    int x = 0;
+    int y = 0;
+    for (int length : B::Fleet::LENGTHS)
+    {
+        if (x + length > B::GEOMETRY.width_)
+        {
+            x = 0;
+            y += 2;
+        }
+
+        for (int i = 0; i < length; i++)
+            ships.set(B::GEOMETRY.index(x + i, y));
+        x += length + 1;
+    }
+
+    return ships;
+}
+
+/**
+ * @brief Сыграть nGames партий на поле B и вывести время и выделения на выстрел
+ * @return true, если выделений не было
+ */
+template<class B>
+static bool run(const char* name, int nGames)
+{
+    B board;
+    board.setShips(placeFleet<B>());
+
+    if (!board.isCorrect())
+    {
+        std::printf("%s: wrong placement\n", name);
+        return false;
+    }
+
+    // порядок выстрелов готовим заранее, чтобы в замер попало только разрешение выстрела
+    std::array<int, B::AREA> order;
+    for (int i = 0; i < (int)order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    unsigned long long nShots = 0;
+    unsigned long long nFinished = 0;
+    unsigned long long allocationsBefore = nAllocations;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int game = 0; game < nGames; game++)
+    {
+        board.clearShots();
+
+        for (int index : order)
+        {
+            nShots++;
+            if (board.isShot(index))
+                continue;
+
+            if (resolveShot(board, index))
+            {
+                nFinished++;
+                break;
+            }
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    unsigned long long allocations = nAllocations - allocationsBefore;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+    std::printf("%s\n", name);
+    std::printf("  games: %d, finished: %llu, shots: %llu\n", nGames, nFinished, nShots);
+    std::printf("  time per shot: %.1f ns\n", ns / nShots);
+    std::printf("  allocations per shot: %.3f (%llu total)\n", (double)allocations / nShots, allocations);
+
+    return allocations == 0;
+}
+
+/**
+ * @brief Количество десятичных цифр числа
+ */
+static int digits(int value)
+{
+    int result = 1;
+    for (; value >= 10; value /= 10)
+        result++;
+
+    return result;
+}
+
+/**
+ * @brief Сыграть nGames партий на SparseBoard и вывести время, выделения и размер сообщений
+ * @return true, если выделений не было
+ */
+static bool runSparse(const char* rulesText, int nGames)
+{
+    RuleSet rules;
+    if (!RuleSet::parse(rulesText, rules))
+    {
+        std::printf("%s: wrong rules\n", rulesText);
+        return false;
+    }
+
+    std::mt19937_64 random(42);
+    std::vector<Ship> ships;
+    if (!SparseBoard::generate(rules, random, ships))
+    {
+        std::printf("%s: no placement\n", rulesText);
+        return false;
+    }
+
+    SparseBoard board(rules);
+    board.setShips(ships);
+
+    if (!board.isCorrect())
+    {
+        std::printf("%s: wrong placement\n", rulesText);
+        return false;
+    }
+
+    std::vector<int> order(rules.getArea());
+    for (int i = 0; i < (int)order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    std::vector<CellRun> runs;
+    runs.reserve(3 * RuleSet::LENGTH_MAX + 2);     // больше отрезков у вертикального корабля не бывает
+
+    unsigned long long nShots = 0;
+    unsigned long long nKills = 0;
+    unsigned long long nRuns = 0;
+    unsigned long long nDiffBytes = 0;
+    unsigned long long allocationsBefore = nAllocations;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int game = 0; game < nGames; game++)
+    {
+        board.clearShots();
+
+        for (int index : order)
+        {
+            int x = index % rules.getWidth();
+            int y = index / rules.getWidth();
+
+            nShots++;
+            if (board.isShot(x, y) || board.shoot(x, y) != CELL_KILLED)
+                continue;
+
+            // то, что сервер отправит в FIELD:DIFF
+            runs.clear();
+            board.getKilledRuns(board.shipAt(x, y), runs);
+            nKills++;
+            nRuns += runs.size();
+
+            for (const CellRun& run : runs)
+                nDiffBytes += digits(run.start_) + digits(run.count_) + 4;     // "<start>,<count>,<state>;"
+
+            if (board.isFleetDestroyed())
+                break;
+        }
+    }
+
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    unsigned long long allocations = nAllocations - allocationsBefore;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+    // расстановка - 3 байта на корабль (Protocol::packShips), битами - байт на 8 клеток
+    double runsPerKill = (double)nRuns / nKills;
+    double bytesPerKill = (double)nDiffBytes / nKills;
+
+    std::printf("sparse %s\n", rulesText);
+    std::printf("  games: %d, shots: %llu, kills: %llu\n", nGames, nShots, nKills);
+    std::printf("  time per shot: %.1f ns\n", ns / nShots);
+    std::printf("  allocations per shot: %.3f (%llu total)\n", (double)allocations / nShots, allocations);
+    std::printf("  FIELD:DIFF per kill: %.1f runs, %.0f bytes of text\n", runsPerKill, bytesPerKill);
+    std::printf("  placement: %d bytes as ship list, %d bytes as bits\n", 3 * (int)ships.size(), (rules.getArea() + 7) / 8);
+
+    return allocations == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const int nGames = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+    bool ok = run<ClassicBoard>("classic 10x10, Fleet<4, 3, 2, 1>", nGames);
+    ok = run<Board<16, 16, Fleet<5, 4, 3, 2, 1>>>("16x16, Fleet<5, 4, 3, 2, 1>", nGames / 4) && ok;
+
+    // партия на поле 100x100 - до 10000 выстрелов, число партий уменьшаем вместе с площадью
+    ok = runSparse("10x10/4,3,2,1", nGames) && ok;
+    ok = runSparse("30x30/12,9,6,3,2", nGames / 10) && ok;
+    ok = runSparse("100x100/40,30,20,10,5,3,2,1", nGames / 100) && ok;
+
+    return ok ? 0 : 1;
+}
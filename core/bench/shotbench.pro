@@ -0,0 +1,12 @@
+# Замер пути выстрела в ядре: время и количество выделений памяти на выстрел.
+# Собирается отдельно (сначала core/core.pro): qmake shotbench.pro && make && ./shotbench
+
+CONFIG += c++17 console
+CONFIG -= qt app_bundle
+
+TARGET = shotbench
+
+include($$PWD/../seabattle-core.pri)
+
+SOURCES += \
+    shotbench.cpp
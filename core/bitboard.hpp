@@ -0,0 +1,235 @@
+/**
+ * @file bitboard.hpp
+ * @brief Битовая маска клеток поля
+ *
+ * Клетка (x, y) - бит y*width + x. Маска - несколько 64-битных слов, их число
+ * задаётся при компиляции по площади поля: поле 10x10 занимает 100 бит из
+ * двух слов (Bitboard), 16x16 - четыре слова. Любое множество клеток
+ * (корабли, попадания, промахи, ореол) хранится в маске, а операции над
+ * множествами - несколько побитовых инструкций на слово без циклов по клеткам.
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Множество клеток поля до 64 * WORDS клеток
+ */
+template<int WORDS>
+struct BasicBitboard
+{
+    static_assert(WORDS > 0, "empty bitboard");
+
+    std::uint64_t words_[WORDS];    ///< Клетки 64*i .. 64*i + 63 в слове i
+
+    static constexpr int BITS = 64 * WORDS;    ///< Наибольшее число клеток
+
+    constexpr BasicBitboard() : words_() {}
+
+    /**
+     * @brief Маска из одной клетки
+     */
+    static constexpr BasicBitboard cell(int index)
+    {
+        BasicBitboard result;
+        result.words_[index / 64] = std::uint64_t(1) << (index % 64);
+        return result;
+    }
+
+    /**
+     * @brief Маска из байтов: клетка i - бит i % 8 байта i / 8
+     */
+    static constexpr BasicBitboard fromBytes(const std::uint8_t* bytes, int size)
+    {
+        BasicBitboard result;
+        for (int i = 0; i < size && i < 8 * WORDS; i++)
+            result.words_[i / 8] |= std::uint64_t(bytes[i]) << (8 * (i % 8));
+        return result;
+    }
+
+    /**
+     * @brief Байт маски: клетки 8*index .. 8*index + 7
+     */
+    constexpr std::uint8_t byte(int index) const
+    {
+        return std::uint8_t(words_[index / 8] >> (8 * (index % 8)));
+    }
+
+    constexpr bool test(int index) const
+    {
+        return (words_[index / 64] >> (index % 64)) & 1;
+    }
+
+    constexpr void set(int index)   { words_[index / 64] |=  (std::uint64_t(1) << (index % 64)); }
+    constexpr void reset(int index) { words_[index / 64] &= ~(std::uint64_t(1) << (index % 64)); }
+
+    constexpr bool any() const
+    {
+        std::uint64_t result = 0;
+        for (int i = 0; i < WORDS; i++)
+            result |= words_[i];
+        return result != 0;
+    }
+
+    constexpr bool none() const { return !any(); }
+
+    /**
+     * @brief Количество клеток в маске
+     */
+    int count() const
+    {
+        int result = 0;
+        for (int i = 0; i < WORDS; i++)
+        {
+#if defined(_MSC_VER)
+            result += (int)__popcnt64(words_[i]);
+#else
+            result += __builtin_popcountll(words_[i]);
+#endif
+        }
+        return result;
+    }
+
+    /**
+     * @brief Номер младшей клетки маски (маска не пуста)
+     */
+    int first() const
+    {
+        int i = 0;
+        while (i < WORDS - 1 && !words_[i])
+            i++;
+
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, words_[i]);
+        return 64 * i + (int)index;
+#else
+        return 64 * i + __builtin_ctzll(words_[i]);
+#endif
+    }
+
+    constexpr BasicBitboard operator&(const BasicBitboard& other) const { BasicBitboard result(*this); return result &= other; }
+    constexpr BasicBitboard operator|(const BasicBitboard& other) const { BasicBitboard result(*this); return result |= other; }
+    constexpr BasicBitboard operator^(const BasicBitboard& other) const { BasicBitboard result(*this); return result ^= other; }
+
+    constexpr BasicBitboard operator~() const
+    {
+        BasicBitboard result;
+        for (int i = 0; i < WORDS; i++)
+            result.words_[i] = ~words_[i];
+        return result;
+    }
+
+    constexpr BasicBitboard& operator&=(const BasicBitboard& other) { for (int i = 0; i < WORDS; i++) words_[i] &= other.words_[i]; return *this; }
+    constexpr BasicBitboard& operator|=(const BasicBitboard& other) { for (int i = 0; i < WORDS; i++) words_[i] |= other.words_[i]; return *this; }
+    constexpr BasicBitboard& operator^=(const BasicBitboard& other) { for (int i = 0; i < WORDS; i++) words_[i] ^= other.words_[i]; return *this; }
+
+    constexpr bool operator==(const BasicBitboard& other) const
+    {
+        for (int i = 0; i < WORDS; i++)
+        {
+            if (words_[i] != other.words_[i])
+                return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const BasicBitboard& other) const { return !(*this == other); }
+
+    /**
+     * @brief Сдвиг к старшим клеткам (0 < n < 64)
+     */
+    constexpr BasicBitboard operator<<(int n) const
+    {
+        BasicBitboard result;
+        for (int i = WORDS - 1; i > 0; i--)
+            result.words_[i] = (words_[i] << n) | (words_[i - 1] >> (64 - n));
+        result.words_[0] = words_[0] << n;
+        return result;
+    }
+
+    /**
+     * @brief Сдвиг к младшим клеткам (0 < n < 64)
+     */
+    constexpr BasicBitboard operator>>(int n) const
+    {
+        BasicBitboard result;
+        for (int i = 0; i < WORDS - 1; i++)
+            result.words_[i] = (words_[i] >> n) | (words_[i + 1] << (64 - n));
+        result.words_[WORDS - 1] = words_[WORDS - 1] >> n;
+        return result;
+    }
+};
+
+typedef BasicBitboard<2> Bitboard;  ///< Маска классического поля 10x10 (128 клеток)
+
+/**
+ * @brief Маски и сдвиги для поля заданного размера
+ *
+ * Сдвиг на 1 переносит клетки через край строки, поэтому после него
+ * отсекается крайний столбец; сдвиг на width - соседняя строка.
+ * Маски считаются один раз при компиляции (constexpr объект на размер поля).
+ */
+template<class Mask>
+struct BasicBoardGeometry
+{
+    int width_;                 ///< Ширина поля
+    int height_;                ///< Высота поля
+    Mask board_;                ///< Все клетки поля
+    Mask notFirstColumn_;       ///< Поле без столбца x = 0
+    Mask notLastColumn_;        ///< Поле без столбца x = width - 1
+
+    constexpr BasicBoardGeometry(int width, int height) :
+        width_(width),
+        height_(height),
+        board_(),
+        notFirstColumn_(),
+        notLastColumn_()
+    {
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                board_.set(y * width + x);
+                if (x != 0)
+                    notFirstColumn_.set(y * width + x);
+                if (x != width - 1)
+                    notLastColumn_.set(y * width + x);
+            }
+        }
+    }
+
+    constexpr int index(int x, int y) const { return y * width_ + x; }
+
+    constexpr Mask east (const Mask& cells) const { return (cells << 1) & notFirstColumn_; }   ///< x + 1
+    constexpr Mask west (const Mask& cells) const { return (cells >> 1) & notLastColumn_; }    ///< x - 1
+    constexpr Mask south(const Mask& cells) const { return (cells << width_) & board_; }       ///< y + 1
+    constexpr Mask north(const Mask& cells) const { return cells >> width_; }                  ///< y - 1
+
+    /**
+     * @brief Клетки и их соседи по стороне
+     */
+    constexpr Mask dilate4(const Mask& cells) const
+    {
+        return cells | east(cells) | west(cells) | south(cells) | north(cells);
+    }
+
+    /**
+     * @brief Клетки и все восемь соседей каждой (корабль вместе с ореолом)
+     */
+    constexpr Mask dilate8(const Mask& cells) const
+    {
+        Mask row = cells | east(cells) | west(cells);
+        return row | south(row) | north(row);
+    }
+};
+
+typedef BasicBoardGeometry<Bitboard> BoardGeometry;    ///< Геометрия поля в маске Bitboard
+
+#endif // BITBOARD_H
@@ -0,0 +1,4 @@
+#include "board.hpp"
+
+// классическое поле собирается один раз в библиотеке, программы только линкуются с ним
+template class Board<Rules::WIDTH, Rules::HEIGHT, Rules::ClassicFleet>;
@@ -0,0 +1,454 @@
+/**
+ * @file board.hpp
+ * @brief Игровое поле без Qt: расстановка, выстрелы, проверка правил
+ *
+ * Ядро игры, общее для клиента, сервера, ботов и замеров (libseabattle-core).
+ * Поле хранится битовыми масками (bitboard.hpp): корабли, попадания, промахи
+ * и уничтоженные клетки. Проверка попадания, уничтожения, ореол вокруг
+ * убитого корабля и конец игры - несколько побитовых операций.
+ *
+ * При смене расстановки строится индекс кораблей: номер корабля каждой
+ * клетки и описание корабля (клетки, ореол, оставшиеся палубы). Выстрел
+ * уменьшает счётчик палуб, уничтожение отмечает заранее посчитанные маски.
+ *
+ * Размер поля и флот - параметры шаблона Board<W, H, Fleet<...>>: размер
+ * масок, геометрия и счётчики флота известны при компиляции, ветвлений по
+ * размеру поля во время игры нет. Классические правила - ClassicBoard,
+ * собраны в libseabattle-core; другие варианты инстанцируются на месте.
+ *
+ * Клетки адресуются номером y*width + x. Обёртки с координатами и строками
+ * Qt живут в Field клиента и сервера.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include "bitboard.hpp"
+#include "rules.hpp"
+
+/**
+ * @brief Состояния клетки для отрисовки
+ */
+enum CellDraw
+{
+    CELL_EMPTY = 0  ,   ///< Пустое поле
+    CELL_LIVE       ,   ///< Часть живого корабля (ещё не попали)
+    CELL_DOT        ,   ///< Выстрел - промах
+    CELL_DAMAGED    ,   ///< Подбитое поле частично подбитого корабля
+    CELL_KILLED     ,   ///< Поле полностью подбитого корабля
+    CELL_MARK       ,   ///< Помеченное пользователем поле (как флажок в сапёре)
+};
+
+/**
+ * @brief Состояния клетки расстановки
+ */
+enum CellState
+{
+    CL_ST_EMPTY     = 0,    ///< Пустая клетка
+    CL_ST_CENTER    = 1,    ///< Центральная клетка (единичный корабль)
+    CL_ST_TOP       = 2,    ///< Верхняя клетка корабля (вертикального)
+    CL_ST_BOTTOM    = 3,    ///< Нижняя клетка корабля (вертикального)
+    CL_ST_VMIDDLE   = 4,    ///< Серединная клетка вертикально ориентированного корабля
+    CL_ST_HMIDDLE   = 5,    ///< Серединная клетка горизонтально ориентированного корабля
+    CL_ST_LEFT      = 6,    ///< Левая клетка корабля (горизонтального)
+    CL_ST_RIGHT     = 7,    ///< Правая клетка корабля (горизонтального)
+    CL_ST_UNDEFINED = 8,    ///< Неопределённое непустое состояние клетки
+};
+
+/**
+ * @brief Класс игрового поля ядра
+ * @tparam W Ширина поля
+ * @tparam H Высота поля
+ * @tparam F Флот (Fleet<...>)
+ */
+template<int W, int H, class F>
+class Board
+{
+public:
+    static_assert(W > 1 && W < 64 && H > 1, "row shift must fit into one word");
+    static_assert(F::LENGTH_MAX <= W || F::LENGTH_MAX <= H, "ship does not fit into the field");
+
+    typedef F Fleet;                                    ///< Флот
+    typedef BasicBitboard<(W * H + 63) / 64> Mask;      ///< Маска клеток поля
+    typedef BasicBoardGeometry<Mask> Geometry;          ///< Маски и сдвиги поля
+
+    static constexpr int AREA = W * H;                      ///< Количество клеток поля
+    static constexpr Geometry GEOMETRY{W, H};               ///< Маски поля, посчитанные при компиляции
+    static constexpr int SHIPS_MAX = (AREA + 1) / 2;        ///< Больше несвязных кораблей на поле не поместится
+    static constexpr int DECKS = Fleet::DECKS;              ///< Палуб всего флота
+
+    typedef typename std::conditional<SHIPS_MAX <= 127, std::int8_t, std::int16_t>::type ShipId;   ///< Номер корабля в индексе
+    static constexpr ShipId NO_SHIP = -1;                   ///< Номер корабля пустой клетки
+
+    /**
+     * @brief Конструктор: пустое поле
+     */
+    Board();
+
+    int getWidth() const  { return W; }     ///< Ширина поля
+    int getHeight() const { return H; }     ///< Высота поля
+    int getArea() const   { return AREA; }  ///< Площадь поля
+
+    /**
+     * @brief Проверить, что координаты внутри поля
+     */
+    bool isInside(int x, int y) const;
+
+    /**
+     * @brief Получить клетки кораблей
+     */
+    const Mask& getShips() const;
+
+    /**
+     * @brief Заменить расстановку и построить индекс кораблей
+     * @param ships Клетки кораблей (клетки вне поля отбрасываются)
+     */
+    void setShips(const Mask& ships);
+
+    /**
+     * @brief Убрать корабли и выстрелы
+     */
+    void clear();
+
+    /**
+     * @brief Убрать выстрелы, расстановка остаётся
+     */
+    void clearShots();
+
+    /**
+     * @brief Получить состояние клетки расстановки
+     *
+     * Ориентация клетки определяется соседями по кораблю, отдельно она не хранится.
+     * @param index Номер клетки
+     */
+    CellState getCellState(int index) const;
+
+    /**
+     * @brief Получить отображение клетки по маскам
+     * @param index Номер клетки
+     */
+    CellDraw getCellDraw(int index) const;
+
+    /**
+     * @brief Установить отображение клетки
+     * @param index Номер клетки
+     * @param state EMPTY, LIVE и MARK снимают выстрел с клетки
+     */
+    void setCellDraw(int index, CellDraw state);
+
+    /**
+     * @brief Проверить корректность расстановки
+     *
+     * Корабли в пределах поля, прямые, не касаются даже углами, состав флота -
+     * Fleet. Всё считается сдвигами масок, без обхода клеток.
+     *
+     * @return true, если расстановка корректна
+     */
+    bool isCorrect() const;
+
+    /**
+     * @brief Проверить, стреляли ли уже в клетку
+     */
+    bool isShot(int index) const;
+
+    /**
+     * @brief Отметить попадание и проверить, убит ли корабль
+     * @param index Номер клетки
+     * @return true, если корабль в клетке убит (пустая клетка - false)
+     */
+    bool isKilled(int index);
+
+    /**
+     * @brief Получить клетки корабля, которому принадлежит клетка
+     * @return Маска клеток корабля (пустая, если в клетке нет корабля)
+     */
+    Mask getShip(int index) const;
+
+    /**
+     * @brief Отметить корабль уничтоженным, а его ореол - промахами
+     * @param index Номер клетки корабля
+     * @return Клетки, отображение которых изменилось
+     */
+    Mask markKilled(int index);
+
+    /**
+     * @brief Проверить, уничтожены ли все корабли
+     * @return true, если непоражённых клеток кораблей не осталось
+     */
+    bool isFleetDestroyed() const;
+
+protected:
+    /**
+     * @brief Построить индекс кораблей по ships_
+     */
+    void indexShips();
+
+private:
+    /**
+     * @brief Корабль в индексе кораблей
+     */
+    struct Ship
+    {
+        Mask cells_;        ///< Клетки корабля
+        Mask halo_;         ///< Клетки вокруг корабля
+        int hp_;            ///< Непоражённых палуб
+    };
+
+    /**
+     * @brief Отметить или снять попадание, поддерживая счётчик палуб корабля
+     * @param index Номер клетки
+     * @param hit true - попадание
+     */
+    void setHit(int index, bool hit);
+
+private:
+    Mask ships_;                   ///< Клетки кораблей
+    Mask hits_;                    ///< Подбитые клетки кораблей (в том числе уничтоженных)
+    Mask misses_;                  ///< Промахи и ореол уничтоженных кораблей
+    Mask killed_;                  ///< Клетки уничтоженных кораблей
+
+    std::array<ShipId, AREA> shipId_;       ///< Номер корабля каждой клетки (NO_SHIP - пусто)
+    std::array<Ship, SHIPS_MAX> shipList_;  ///< Корабли по номеру
+    int nShips_;                            ///< Кораблей в shipList_
+};
+
+/**
+ * @brief Поле классических правил: 10x10, флот 4-3-2-1
+ */
+typedef Board<Rules::WIDTH, Rules::HEIGHT, Rules::ClassicFleet> ClassicBoard;
+
+template<int W, int H, class F>
+Board<W, H, F>::Board()
+{
+    clear();
+}
+
+template<int W, int H, class F>
+bool Board<W, H, F>::isInside(int x, int y) const
+{
+    return x >= 0 && y >= 0 && x < W && y < H;
+}
+
+template<int W, int H, class F>
+const typename Board<W, H, F>::Mask& Board<W, H, F>::getShips() const
+{
+    return ships_;
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::setShips(const Mask& ships)
+{
+    ships_ = ships & GEOMETRY.board_;
+    indexShips();
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::clear()
+{
+    ships_ = Mask();
+    indexShips();
+    clearShots();
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::clearShots()
+{
+    hits_ = Mask();
+    misses_ = Mask();
+    killed_ = Mask();
+
+    for (int id = 0; id < nShips_; id++)
+        shipList_[id].hp_ = shipList_[id].cells_.count();
+}
+
+template<int W, int H, class F>
+CellState Board<W, H, F>::getCellState(int index) const
+{
+    if (!ships_.test(index))
+        return CL_ST_EMPTY;
+
+    int x = index % W;
+    int y = index / W;
+
+    bool left   = x > 0     && ships_.test(index - 1);
+    bool right  = x < W - 1 && ships_.test(index + 1);
+    bool top    = y > 0     && ships_.test(index - W);
+    bool bottom = y < H - 1 && ships_.test(index + W);
+
+    if (left || right)
+        return left && right ? CL_ST_HMIDDLE : (left ? CL_ST_RIGHT : CL_ST_LEFT);
+    if (top || bottom)
+        return top && bottom ? CL_ST_VMIDDLE : (top ? CL_ST_BOTTOM : CL_ST_TOP);
+
+    return CL_ST_CENTER;
+}
+
+template<int W, int H, class F>
+CellDraw Board<W, H, F>::getCellDraw(int index) const
+{
+    if (killed_.test(index))
+        return CELL_KILLED;
+    if (hits_.test(index))
+        return CELL_DAMAGED;
+    if (misses_.test(index))
+        return CELL_DOT;
+    if (ships_.test(index))
+        return CELL_LIVE;
+
+    return CELL_EMPTY;
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::setCellDraw(int index, CellDraw state)
+{
+    misses_.reset(index);
+    killed_.reset(index);
+    setHit(index, state == CELL_KILLED || state == CELL_DAMAGED);
+
+    switch (state)
+    {
+        case CELL_KILLED : killed_.set(index);  break;
+        case CELL_DOT    : misses_.set(index);  break;
+        default          :                      break;  // EMPTY, LIVE, MARK - только корабли
+    }
+}
+
+template<int W, int H, class F>
+bool Board<W, H, F>::isCorrect() const
+{
+    // клетки за пределами поля
+    if ((ships_ & ~GEOMETRY.board_).any())
+        return false;
+
+    // касание углами: клетки разных кораблей или изгиб одного, прямой корабль диагональных пар не даёт
+    Mask row = GEOMETRY.east(ships_) | GEOMETRY.west(ships_);
+    if ((ships_ & (GEOMETRY.north(row) | GEOMETRY.south(row))).any())
+        return false;
+
+    // теперь все корабли - прямые отрезки, касание сторонами склеивает их в более длинный
+    // корабль длины не меньше k - начало отрезка (нет соседа слева/сверху), за которым ещё k - 1 палуба
+    Mask heads = ships_ & ~GEOMETRY.east(ships_) & ~GEOMETRY.south(ships_);
+    Mask right = ships_;    // клетки, правее которых length - 1 палуба
+    Mask down  = ships_;    // клетки, ниже которых length - 1 палуба
+
+    int atLeast = heads.count();    // кораблей длины не меньше 1
+    for (int length = 1; length <= Fleet::LENGTH_MAX; length++)
+    {
+        right &= GEOMETRY.west (right);
+        down  &= GEOMETRY.north(down );
+
+        // корабль длиннее 1 клетки попадает ровно в один из двух счётчиков
+        int longer = (right & ~GEOMETRY.east(ships_)).count() + (down & ~GEOMETRY.south(ships_)).count();
+
+        if (atLeast - longer != Fleet::count(length))
+            return false;
+
+        atLeast = longer;
+    }
+
+    return atLeast == 0;    // длиннее Fleet::LENGTH_MAX
+}
+
+template<int W, int H, class F>
+bool Board<W, H, F>::isShot(int index) const
+{
+    return (hits_ | misses_).test(index);
+}
+
+template<int W, int H, class F>
+bool Board<W, H, F>::isKilled(int index)  // считаем, что в ships_ правильная расстановка
+{
+    int id = shipId_[index];
+    if (id == NO_SHIP)
+        return false;
+
+    setHit(index, true);
+
+    return shipList_[id].hp_ == 0;
+}
+
+template<int W, int H, class F>
+typename Board<W, H, F>::Mask Board<W, H, F>::getShip(int index) const
+{
+    int id = shipId_[index];
+    return id == NO_SHIP ? Mask() : shipList_[id].cells_;
+}
+
+template<int W, int H, class F>
+typename Board<W, H, F>::Mask Board<W, H, F>::markKilled(int index)
+{
+    int id = shipId_[index];
+    if (id == NO_SHIP)
+        return Mask();
+
+    Ship& ship = shipList_[id];
+    Mask changed = (ship.cells_ & ~killed_) | (ship.halo_ & ~misses_);
+
+    hits_   |= ship.cells_;
+    killed_ |= ship.cells_;
+    misses_ |= ship.halo_;
+    ship.hp_ = 0;
+
+    return changed;
+}
+
+template<int W, int H, class F>
+bool Board<W, H, F>::isFleetDestroyed() const
+{
+    return (ships_ & ~hits_).none();
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::setHit(int index, bool hit)
+{
+    if (hits_.test(index) == hit)
+        return;
+
+    if (hit)
+        hits_.set(index);
+    else
+        hits_.reset(index);
+
+    int id = shipId_[index];
+    if (id != NO_SHIP)
+        shipList_[id].hp_ += hit ? -1 : 1;
+}
+
+template<int W, int H, class F>
+void Board<W, H, F>::indexShips()
+{
+    shipId_.fill(NO_SHIP);
+    nShips_ = 0;
+
+    Mask rest = ships_;
+
+    while (rest.any() && nShips_ < SHIPS_MAX)
+    {
+        // корабль - связная по сторонам группа клеток, заливка занимает не больше длины корабля шагов
+        Mask cells = Mask::cell(rest.first());
+        for (Mask grown = GEOMETRY.dilate4(cells) & ships_; grown != cells; grown = GEOMETRY.dilate4(cells) & ships_)
+            cells = grown;
+
+        Ship& ship = shipList_[nShips_];
+        ship.cells_ = cells;
+        ship.halo_ = GEOMETRY.dilate8(cells) & ~cells;
+        ship.hp_ = (cells & ~hits_).count();
+
+        for (Mask left = cells; left.any(); )
+        {
+            int index = left.first();
+            shipId_[index] = nShips_;
+            left.reset(index);
+        }
+
+        rest &= ~cells;
+        nShips_++;
+    }
+}
+
+extern template class Board<Rules::WIDTH, Rules::HEIGHT, Rules::ClassicFleet>;     // собран в libseabattle-core (board.cpp)
+
+#endif // BOARD_H
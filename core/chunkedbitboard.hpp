@@ -0,0 +1,154 @@
+/**
+ * @file chunkedbitboard.hpp
+ * @brief Маска клеток поля произвольного размера, разбитая на блоки 8x8
+ *
+ * Для полей, размер которых выбирается во время игры (до 100x100). Поле
+ * делится на блоки 8x8 клеток, блок - одно 64-битное слово. Корабль с
+ * ореолом задевает не больше двух-трёх блоков в ширину, поэтому проверка и
+ * отметка прямоугольника - несколько операций над словами, а не проход по
+ * клеткам или по всему полю. Память выделяется один раз при смене размера.
+ */
+
+#ifndef CHUNKEDBITBOARD_H
+#define CHUNKEDBITBOARD_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Множество клеток поля из блоков 8x8
+ */
+class ChunkedBitboard
+{
+public:
+    static constexpr int CHUNK_SIZE = 8;    ///< Сторона блока в клетках
+
+    ChunkedBitboard() : width_(0), height_(0), chunksX_(0) {}
+
+    ChunkedBitboard(int width, int height) { resize(width, height); }
+
+    /**
+     * @brief Задать размер поля, маска становится пустой
+     */
+    void resize(int width, int height)
+    {
+        width_ = width;
+        height_ = height;
+        chunksX_ = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        chunks_.assign(chunksX_ * ((height + CHUNK_SIZE - 1) / CHUNK_SIZE), 0);
+    }
+
+    /**
+     * @brief Убрать все клетки, размер остаётся
+     */
+    void clear()
+    {
+        std::fill(chunks_.begin(), chunks_.end(), 0);
+    }
+
+    int getWidth() const  { return width_; }
+    int getHeight() const { return height_; }
+
+    bool test(int x, int y) const
+    {
+        return (chunks_[chunk(x, y)] >> bit(x, y)) & 1;
+    }
+
+    void set(int x, int y)   { chunks_[chunk(x, y)] |=  (std::uint64_t(1) << bit(x, y)); }
+    void reset(int x, int y) { chunks_[chunk(x, y)] &= ~(std::uint64_t(1) << bit(x, y)); }
+
+    /**
+     * @brief Есть ли клетки в прямоугольнике (края обрезаются по полю)
+     */
+    bool any(int x0, int y0, int x1, int y1) const
+    {
+        bool result = false;
+        forEachChunk(x0, y0, x1, y1, [&result](const std::uint64_t& chunk, std::uint64_t mask) { result = result || (chunk & mask); });
+        return result;
+    }
+
+    /**
+     * @brief Добавить все клетки прямоугольника (края обрезаются по полю)
+     */
+    void set(int x0, int y0, int x1, int y1)
+    {
+        forEachChunk(x0, y0, x1, y1, [](std::uint64_t& chunk, std::uint64_t mask) { chunk |= mask; });
+    }
+
+    /**
+     * @brief Количество клеток в маске
+     */
+    int count() const
+    {
+        int result = 0;
+        for (std::uint64_t chunk : chunks_)
+        {
+#if defined(_MSC_VER)
+            result += (int)__popcnt64(chunk);
+#else
+            result += __builtin_popcountll(chunk);
+#endif
+        }
+        return result;
+    }
+
+private:
+    int chunk(int x, int y) const { return (y / CHUNK_SIZE) * chunksX_ + x / CHUNK_SIZE; }
+    static int bit(int x, int y)  { return (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE; }
+
+    /**
+     * @brief Пройти блоки прямоугольника x0..x1, y0..y1 с маской его клеток в каждом блоке
+     */
+    template<class Chunks, class Op>
+    static void forEachChunkOf(Chunks& chunks, int width, int height, int chunksX, int x0, int y0, int x1, int y1, Op op)
+    {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, width - 1);
+        y1 = std::min(y1, height - 1);
+
+        for (int cy = y0 / CHUNK_SIZE; cy <= y1 / CHUNK_SIZE && x0 <= x1; cy++)
+        {
+            int rowFirst = std::max(y0 - cy * CHUNK_SIZE, 0);
+            int rowLast  = std::min(y1 - cy * CHUNK_SIZE, CHUNK_SIZE - 1);
+
+            for (int cx = x0 / CHUNK_SIZE; cx <= x1 / CHUNK_SIZE; cx++)
+            {
+                int columnFirst = std::max(x0 - cx * CHUNK_SIZE, 0);
+                int columnLast  = std::min(x1 - cx * CHUNK_SIZE, CHUNK_SIZE - 1);
+
+                // столбцы columnFirst..columnLast в одной строке блока, затем размножаем на строки
+                std::uint64_t row = ((std::uint64_t(1) << (columnLast - columnFirst + 1)) - 1) << columnFirst;
+                std::uint64_t mask = 0;
+                for (int r = rowFirst; r <= rowLast; r++)
+                    mask |= row << (r * CHUNK_SIZE);
+
+                op(chunks[cy * chunksX + cx], mask);
+            }
+        }
+    }
+
+    template<class Op>
+    void forEachChunk(int x0, int y0, int x1, int y1, Op op)
+    {
+        forEachChunkOf(chunks_, width_, height_, chunksX_, x0, y0, x1, y1, op);
+    }
+
+    template<class Op>
+    void forEachChunk(int x0, int y0, int x1, int y1, Op op) const
+    {
+        forEachChunkOf(chunks_, width_, height_, chunksX_, x0, y0, x1, y1, op);
+    }
+
+    int width_;                         ///< Ширина поля
+    int height_;                        ///< Высота поля
+    int chunksX_;                       ///< Блоков в строке
+    std::vector<std::uint64_t> chunks_; ///< Блоки по строкам, клетка (x, y) блока - бит y*8 + x
+};
+
+#endif // CHUNKEDBITBOARD_H
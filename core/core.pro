@@ -0,0 +1,22 @@
+# libseabattle-core: правила и поле игры без Qt (std-контейнеры, constexpr-правила из rules.hpp,
+# правила больших полей во время игры - ruleset.hpp и sparseboard.hpp).
+# Статическая библиотека для клиента, сервера, ботов и замеров; подключается через seabattle-core.pri.
+
+TEMPLATE = lib
+CONFIG += staticlib c++17
+CONFIG -= qt
+
+TARGET = seabattle-core
+
+SOURCES += \
+    board.cpp \
+    ruleset.cpp \
+    sparseboard.cpp
+
+HEADERS += \
+    bitboard.hpp \
+    board.hpp \
+    chunkedbitboard.hpp \
+    rules.hpp \
+    ruleset.hpp \
+    sparseboard.hpp
@@ -0,0 +1,93 @@
+/**
+ * @file rules.hpp
+ * @brief Правила игры: размер поля и состав флота
+ *
+ * Единственное место, где заданы правила. Клиент (constants.hpp), сервер
+ * (config.hpp) и ядро берут их отсюда, поэтому проверка расстановки и
+ * счётчики палуб не расходятся между программами.
+ *
+ * Флот - тип Fleet<...>: количество кораблей длины 1, 2, 3... Всё, что из
+ * него следует (длины кораблей, число палуб, самый длинный корабль), считается
+ * при компиляции. Поле под правила - Board<W, H, Fleet<...>> (board.hpp).
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <array>
+
+/**
+ * @brief Состав флота
+ * @tparam COUNTS Количество кораблей длины 1, 2, 3... (Fleet<4, 3, 2, 1> - классический флот)
+ */
+template<int... COUNTS>
+struct Fleet
+{
+    static_assert(sizeof...(COUNTS) > 0, "empty fleet");
+
+    static constexpr int LENGTH_MAX = sizeof...(COUNTS);   ///< Длина самого длинного корабля
+    static constexpr int SHIPS = (0 + ... + COUNTS);       ///< Кораблей во флоте
+
+    /**
+     * @brief Количество кораблей заданной длины
+     */
+    static constexpr int count(int length)
+    {
+        constexpr int counts[] = { COUNTS... };
+        return length >= 1 && length <= LENGTH_MAX ? counts[length - 1] : 0;
+    }
+
+    /**
+     * @brief Количество палуб всего флота
+     */
+    static constexpr int decks()
+    {
+        int result = 0;
+        for (int length = 1; length <= LENGTH_MAX; length++)
+            result += length * count(length);
+
+        return result;
+    }
+
+    /**
+     * @brief Длины кораблей, от длинных к коротким (так неудачная расстановка отбрасывается раньше)
+     */
+    static constexpr std::array<int, SHIPS> lengths()
+    {
+        std::array<int, SHIPS> result{};
+
+        int i = 0;
+        for (int length = LENGTH_MAX; length >= 1; length--)
+        {
+            for (int n = 0; n < count(length); n++)
+                result[i++] = length;
+        }
+
+        return result;
+    }
+
+    static constexpr int DECKS = decks();                           ///< Палуб всего флота
+    static constexpr std::array<int, SHIPS> LENGTHS = lengths();    ///< Длины кораблей, от длинных к коротким
+};
+
+namespace Rules
+{
+    typedef Fleet<4, 3, 2, 1> ClassicFleet;     ///< Классический флот: 4 однопалубных ... 1 четырёхпалубный
+
+    constexpr int WIDTH  = 10;  ///< Ширина поля
+    constexpr int HEIGHT = 10;  ///< Высота поля
+
+    constexpr int SHIPS = ClassicFleet::SHIPS;                  ///< Кораблей во флоте
+    constexpr int SHIP_LENGTH_MAX = ClassicFleet::LENGTH_MAX;   ///< Длина самого длинного корабля
+    constexpr int DECKS = ClassicFleet::DECKS;                  ///< Палуб всего флота
+
+    /**
+     * @brief Количество кораблей заданной длины
+     */
+    constexpr int shipCount(int length)
+    {
+        return ClassicFleet::count(length);
+    }
+}
+
+#endif // RULES_H
@@ -0,0 +1,165 @@
+#include "ruleset.hpp"
+#include "rules.hpp"
+
+RuleSet::RuleSet() :
+    RuleSet(classic())
+{
+
+}
+
+RuleSet::RuleSet(int width, int height, const std::vector<int>& counts) :
+    width_(width),
+    height_(height),
+    counts_(counts)
+{
+    // нули в конце записи не меняют флот, а длину самого длинного корабля сбивают
+    while (!counts_.empty() && counts_.back() == 0)
+        counts_.pop_back();
+}
+
+RuleSet RuleSet::classic()
+{
+    std::vector<int> counts;
+    for (int length = 1; length <= Rules::SHIP_LENGTH_MAX; length++)
+        counts.push_back(Rules::shipCount(length));
+
+    return RuleSet(Rules::WIDTH, Rules::HEIGHT, counts);
+}
+
+/**
+ * @brief Прочитать неотрицательное число не длиннее 4 цифр
+ * @param text Запись
+ * @param pos Позиция чтения, сдвигается за число
+ * @param value Прочитанное число
+ * @return false, если в позиции нет числа
+ */
+static bool readNumber(const std::string& text, std::size_t& pos, int& value)
+{
+    std::size_t start = pos;
+    value = 0;
+
+    while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' && pos - start < 4)
+        value = value * 10 + (text[pos++] - '0');
+
+    return pos > start;
+}
+
+bool RuleSet::parse(const std::string& text, RuleSet& rules)    // "<width>x<height>/<n1>,<n2>,..."
+{
+    std::size_t pos = 0;
+    int width = 0;
+    int height = 0;
+
+    if (!readNumber(text, pos, width) || pos >= text.size() || text[pos++] != 'x' ||
+        !readNumber(text, pos, height) || pos >= text.size() || text[pos++] != '/')
+        return false;
+
+    std::vector<int> counts;
+    for (;;)
+    {
+        int count = 0;
+        if (!readNumber(text, pos, count) || (int)counts.size() >= LENGTH_MAX)
+            return false;
+
+        counts.push_back(count);
+
+        if (pos == text.size())
+            break;
+        if (text[pos++] != ',')
+            return false;
+    }
+
+    RuleSet result(width, height, counts);
+    if (!result.isValid())
+        return false;
+
+    rules = result;
+    return true;
+}
+
+std::string RuleSet::toString() const
+{
+    std::string result = std::to_string(width_) + 'x' + std::to_string(height_) + '/';
+
+    for (std::size_t i = 0; i < counts_.size(); i++)
+    {
+        if (i)
+            result += ',';
+        result += std::to_string(counts_[i]);
+    }
+
+    return result;
+}
+
+bool RuleSet::isValid() const
+{
+    if (width_ < 1 || height_ < 1 || width_ > WIDTH_MAX || height_ > HEIGHT_MAX)
+        return false;
+
+    int lengthMax = getLengthMax();
+    if (lengthMax < 1 || lengthMax > LENGTH_MAX || (lengthMax > width_ && lengthMax > height_))
+        return false;
+
+    // корабль с ореолом справа и снизу занимает (length + 1) * 2 клетки поля, расширенного на строку
+    // и столбец; такие прямоугольники не пересекаются, значит, флот должен уместиться по площади
+    int area = 0;
+    for (int length = 1; length <= lengthMax; length++)
+    {
+        if (count(length) < 0)
+            return false;
+
+        area += count(length) * (length + 1) * 2;
+    }
+
+    return area <= (width_ + 1) * (height_ + 1);
+}
+
+bool RuleSet::isClassic() const
+{
+    static const RuleSet CLASSIC = classic();   // проверяется на каждом выстреле, без выделений памяти
+    return *this == CLASSIC;
+}
+
+int RuleSet::getLengthMax() const
+{
+    return (int)counts_.size();
+}
+
+int RuleSet::count(int length) const
+{
+    return length >= 1 && length <= getLengthMax() ? counts_[length - 1] : 0;
+}
+
+int RuleSet::getShips() const
+{
+    int result = 0;
+    for (int count : counts_)
+        result += count;
+
+    return result;
+}
+
+int RuleSet::getDecks() const
+{
+    int result = 0;
+    for (int length = 1; length <= getLengthMax(); length++)
+        result += length * count(length);
+
+    return result;
+}
+
+std::vector<int> RuleSet::getLengths() const
+{
+    std::vector<int> result;
+    result.reserve(getShips());
+
+    for (int length = getLengthMax(); length >= 1; length--)
+        result.insert(result.end(), count(length), length);
+
+    return result;
+}
+
+bool RuleSet::operator==(const RuleSet& other) const
+{
+    return width_ == other.width_ && height_ == other.height_ && counts_ == other.counts_;
+}
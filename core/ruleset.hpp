@@ -0,0 +1,112 @@
+/**
+ * @file ruleset.hpp
+ * @brief Правила, выбираемые во время игры: размер поля и состав флота
+ *
+ * Классические правила заданы при компиляции (rules.hpp, ClassicBoard).
+ * Режимы с большими полями выбираются игроками при GAME:START, поэтому их
+ * правила - обычное значение: ширина, высота и количество кораблей каждой
+ * длины. Поле под такие правила - SparseBoard (sparseboard.hpp).
+ *
+ * Текстовая запись для протокола: "<ширина>x<высота>/<n1>,<n2>,...",
+ * где ni - количество кораблей длины i. Классические правила - "10x10/4,3,2,1".
+ */
+
+#ifndef RULESET_H
+#define RULESET_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Набор правил: размер поля и флот
+ */
+class RuleSet
+{
+public:
+    static constexpr int WIDTH_MAX  = 100;  ///< Наибольшая ширина поля
+    static constexpr int HEIGHT_MAX = 100;  ///< Наибольшая высота поля
+    static constexpr int LENGTH_MAX = 10;   ///< Наибольшая длина корабля
+
+    /**
+     * @brief Конструктор: классические правила
+     */
+    RuleSet();
+
+    /**
+     * @brief Конструктор
+     * @param width Ширина поля
+     * @param height Высота поля
+     * @param counts Количество кораблей длины 1, 2, 3...
+     */
+    RuleSet(int width, int height, const std::vector<int>& counts);
+
+    /**
+     * @brief Классические правила (Rules::WIDTH x Rules::HEIGHT, Rules::ClassicFleet)
+     */
+    static RuleSet classic();
+
+    /**
+     * @brief Разобрать текстовую запись "<ширина>x<высота>/<n1>,<n2>,..."
+     * @param text Запись правил
+     * @param rules Разобранные правила (только при успехе)
+     * @return true, если запись разобрана и правила допустимы (isValid)
+     */
+    static bool parse(const std::string& text, RuleSet& rules);
+
+    /**
+     * @brief Текстовая запись правил
+     */
+    std::string toString() const;
+
+    /**
+     * @brief Проверить, что по правилам можно играть
+     *
+     * Размер поля не больше WIDTH_MAX x HEIGHT_MAX, корабли не длиннее LENGTH_MAX
+     * и стороны поля, флот не пуст и помещается на поле вместе с ореолами.
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Правила совпадают с классическими (для них есть ClassicBoard)
+     */
+    bool isClassic() const;
+
+    int getWidth() const  { return width_; }            ///< Ширина поля
+    int getHeight() const { return height_; }           ///< Высота поля
+    int getArea() const   { return width_ * height_; }  ///< Площадь поля
+
+    /**
+     * @brief Длина самого длинного корабля
+     */
+    int getLengthMax() const;
+
+    /**
+     * @brief Количество кораблей заданной длины
+     */
+    int count(int length) const;
+
+    /**
+     * @brief Кораблей во флоте
+     */
+    int getShips() const;
+
+    /**
+     * @brief Палуб всего флота
+     */
+    int getDecks() const;
+
+    /**
+     * @brief Длины кораблей, от длинных к коротким
+     */
+    std::vector<int> getLengths() const;
+
+    bool operator==(const RuleSet& other) const;
+    bool operator!=(const RuleSet& other) const { return !(*this == other); }
+
+private:
+    int width_;                 ///< Ширина поля
+    int height_;                ///< Высота поля
+    std::vector<int> counts_;   ///< Количество кораблей длины 1, 2, 3...
+};
+
+#endif // RULESET_H
@@ -0,0 +1,14 @@
+# Подключение libseabattle-core к программе: include($$PWD/../core/seabattle-core.pri)
+# Библиотека собирается из core/core.pro (в network-battleship.pro - раньше программ).
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+SEABATTLE_CORE_OUT = $$top_builddir/core
+win32:CONFIG(debug, debug|release): SEABATTLE_CORE_OUT = $$SEABATTLE_CORE_OUT/debug
+else:win32: SEABATTLE_CORE_OUT = $$SEABATTLE_CORE_OUT/release
+
+LIBS += -L$$SEABATTLE_CORE_OUT -lseabattle-core
+
+win32-msvc*: PRE_TARGETDEPS += $$SEABATTLE_CORE_OUT/seabattle-core.lib
+else: PRE_TARGETDEPS += $$SEABATTLE_CORE_OUT/libseabattle-core.a
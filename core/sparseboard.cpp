@@ -0,0 +1,245 @@
+#include "sparseboard.hpp"
+#include <algorithm>
+
+SparseBoard::SparseBoard() :
+    SparseBoard(RuleSet::classic())
+{
+
+}
+
+SparseBoard::SparseBoard(const RuleSet& rules) :
+    aliveShips_(0)
+{
+    setRules(rules);
+}
+
+void SparseBoard::setRules(const RuleSet& rules)
+{
+    rules_ = rules;
+
+    occupied_.resize(rules_.getWidth(), rules_.getHeight());
+    hits_.resize(rules_.getWidth(), rules_.getHeight());
+    misses_.resize(rules_.getWidth(), rules_.getHeight());
+
+    ships_.clear();
+    decks_.clear();
+    alive_.clear();
+    aliveShips_ = 0;
+}
+
+bool SparseBoard::isInside(int x, int y) const
+{
+    return x >= 0 && y >= 0 && x < getWidth() && y < getHeight();
+}
+
+void SparseBoard::setShips(const std::vector<Ship>& ships)
+{
+    ships_ = ships;
+    decks_.clear();
+    occupied_.clear();
+
+    for (int id = 0; id < (int)ships_.size(); id++)
+    {
+        const Ship& ship = ships_[id];
+
+        // клетки за пределами поля в индекс не попадают, такую расстановку отклонит isCorrect()
+        for (int i = 0; i < ship.length_ && i < RuleSet::LENGTH_MAX; i++)
+        {
+            int x = ship.x_ + (ship.vertical_ ? 0 : i);
+            int y = ship.y_ + (ship.vertical_ ? i : 0);
+
+            if (!isInside(x, y))
+                continue;
+
+            decks_.push_back(Deck{ y * getWidth() + x, id });
+            occupied_.set(x, y);
+        }
+    }
+
+    std::sort(decks_.begin(), decks_.end());
+    clearShots();
+}
+
+void SparseBoard::clear()
+{
+    setShips(std::vector<Ship>());
+}
+
+void SparseBoard::clearShots()
+{
+    hits_.clear();
+    misses_.clear();
+
+    alive_.assign(ships_.size(), 0);
+    for (const Deck& deck : decks_)
+        alive_[deck.ship_]++;
+
+    aliveShips_ = (int)ships_.size();
+}
+
+bool SparseBoard::isCorrect() const
+{
+    std::vector<int> counts(rules_.getLengthMax() + 1, 0);
+    ChunkedBitboard placed(getWidth(), getHeight());
+
+    for (const Ship& ship : ships_)
+    {
+        if (ship.length_ < 1 || ship.length_ > rules_.getLengthMax() ||
+            !isInside(ship.x_, ship.y_) || !isInside(lastX(ship), lastY(ship)))
+            return false;
+
+        // корабли с ореолом не пересекаются: ореол нового корабля не задевает уже поставленные
+        if (placed.any(ship.x_ - 1, ship.y_ - 1, lastX(ship) + 1, lastY(ship) + 1))
+            return false;
+
+        placed.set(ship.x_, ship.y_, lastX(ship), lastY(ship));
+        counts[ship.length_]++;
+    }
+
+    for (int length = 1; length <= rules_.getLengthMax(); length++)
+    {
+        if (counts[length] != rules_.count(length))
+            return false;
+    }
+
+    return true;
+}
+
+int SparseBoard::shipAt(int x, int y) const
+{
+    if (!isInside(x, y) || !occupied_.test(x, y))
+        return NO_SHIP;
+
+    Deck key = { y * getWidth() + x, NO_SHIP };
+    auto it = std::lower_bound(decks_.begin(), decks_.end(), key);
+
+    return it != decks_.end() && it->cell_ == key.cell_ ? it->ship_ : NO_SHIP;
+}
+
+bool SparseBoard::isShot(int x, int y) const
+{
+    return isInside(x, y) && (hits_.test(x, y) || misses_.test(x, y));
+}
+
+CellDraw SparseBoard::getCellDraw(int x, int y) const
+{
+    if (!isInside(x, y))
+        return CELL_EMPTY;
+
+    if (hits_.test(x, y))
+        return alive_[shipAt(x, y)] == 0 ? CELL_KILLED : CELL_DAMAGED;
+    if (misses_.test(x, y))
+        return CELL_DOT;
+    if (occupied_.test(x, y))
+        return CELL_LIVE;
+
+    return CELL_EMPTY;
+}
+
+CellDraw SparseBoard::shoot(int x, int y)
+{
+    if (!isInside(x, y))
+        return CELL_DOT;
+
+    if (isShot(x, y))
+        return getCellDraw(x, y);
+
+    int id = shipAt(x, y);
+    if (id == NO_SHIP)
+    {
+        misses_.set(x, y);
+        return CELL_DOT;
+    }
+
+    hits_.set(x, y);
+    if (--alive_[id] > 0)
+        return CELL_DAMAGED;
+
+    const Ship& ship = ships_[id];
+    misses_.set(ship.x_ - 1, ship.y_ - 1, lastX(ship) + 1, lastY(ship) + 1);   // палубы - попадания, им промах не мешает
+    aliveShips_--;
+
+    return CELL_KILLED;
+}
+
+void SparseBoard::getKilledRuns(int ship, std::vector<CellRun>& runs) const
+{
+    if (ship < 0 || ship >= (int)ships_.size())
+        return;
+
+    const Ship& s = ships_[ship];
+    int x0 = std::max(s.x_ - 1, 0);
+    int x1 = std::min(lastX(s) + 1, getWidth() - 1);
+
+    for (int y = std::max(s.y_ - 1, 0); y <= std::min(lastY(s) + 1, getHeight() - 1); y++)
+    {
+        int row = y * getWidth();
+
+        if (y < s.y_ || y > lastY(s))   // строка ореола над или под кораблём
+        {
+            runs.push_back(CellRun{ row + x0, x1 - x0 + 1, CELL_DOT });
+            continue;
+        }
+
+        if (x0 < s.x_)
+            runs.push_back(CellRun{ row + x0, 1, CELL_DOT });
+
+        runs.push_back(CellRun{ row + s.x_, lastX(s) - s.x_ + 1, CELL_KILLED });
+
+        if (x1 > lastX(s))
+            runs.push_back(CellRun{ row + x1, 1, CELL_DOT });
+    }
+}
+
+bool SparseBoard::isFleetDestroyed() const
+{
+    return aliveShips_ == 0;
+}
+
+bool SparseBoard::generate(const RuleSet& rules, std::mt19937_64& random, std::vector<Ship>& ships)
+{
+    const int width = rules.getWidth();
+    const int height = rules.getHeight();
+    const std::vector<int> lengths = rules.getLengths();
+
+    ChunkedBitboard blocked(width, height);     // корабли с ореолом: сюда следующий корабль ставить нельзя
+
+    for (int attempt = 0; attempt < 100; attempt++)
+    {
+        blocked.clear();
+        ships.clear();
+
+        for (int length : lengths)
+        {
+            bool placed = false;
+
+            for (int tries = 0; tries < 500 && !placed; tries++)
+            {
+                bool vertical = length > 1 && (random() & 1);
+                int maxX = width  - (vertical ? 1 : length);
+                int maxY = height - (vertical ? length : 1);
+
+                if (maxX < 0 || maxY < 0)
+                    continue;
+
+                Ship ship = { (int)(random() % (maxX + 1)), (int)(random() % (maxY + 1)), length, vertical };
+
+                if (blocked.any(ship.x_, ship.y_, lastX(ship), lastY(ship)))
+                    continue;
+
+                blocked.set(ship.x_ - 1, ship.y_ - 1, lastX(ship) + 1, lastY(ship) + 1);
+                ships.push_back(ship);
+                placed = true;
+            }
+
+            if (!placed)
+                break;
+        }
+
+        if (ships.size() == lengths.size())
+            return true;
+    }
+
+    ships.clear();
+    return false;
+}
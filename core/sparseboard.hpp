@@ -0,0 +1,196 @@
+/**
+ * @file sparseboard.hpp
+ * @brief Поле правил, выбранных во время игры (до 100x100)
+ *
+ * Board<W, H, Fleet> держит маску и номер корабля на каждую клетку - для поля
+ * 100x100 это десятки килобайт и проходы по всей площади. SparseBoard хранит
+ * то, что от площади не зависит: список кораблей (начало, длина, направление,
+ * целые палубы) и индекс палуб, отсортированный по номеру клетки. Выстрелы -
+ * маски ChunkedBitboard из блоков 8x8.
+ *
+ * Выстрел - проверка бита, поиск палубы в индексе и уменьшение счётчика
+ * корабля. Уничтожение отмечает ореол только вокруг корабля. Конец игры -
+ * счётчик целых кораблей. Ни один шаг не проходит по всему полю, время
+ * выстрела не растёт с размером поля.
+ *
+ * Клетки адресуются координатами, номер клетки - y*width + x, как в Board.
+ */
+
+#ifndef SPARSEBOARD_H
+#define SPARSEBOARD_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "board.hpp"
+#include "chunkedbitboard.hpp"
+#include "ruleset.hpp"
+
+/**
+ * @brief Корабль расстановки
+ */
+struct Ship
+{
+    int x_;             ///< X первой клетки (левой или верхней)
+    int y_;             ///< Y первой клетки
+    int length_;        ///< Длина
+    bool vertical_;     ///< Корабль идёт вниз, иначе вправо
+};
+
+/**
+ * @brief Клетки подряд в одной строке с одним состоянием отрисовки
+ */
+struct CellRun
+{
+    int start_;         ///< Первая клетка (y*width + x)
+    int count_;         ///< Количество клеток
+    CellDraw state_;    ///< Состояние отрисовки
+};
+
+/**
+ * @brief Поле с разреженным индексом кораблей
+ */
+class SparseBoard
+{
+public:
+    static constexpr int NO_SHIP = -1;  ///< Номер корабля пустой клетки
+
+    /**
+     * @brief Конструктор: пустое поле классических правил
+     */
+    SparseBoard();
+
+    /**
+     * @brief Конструктор: пустое поле заданных правил
+     */
+    explicit SparseBoard(const RuleSet& rules);
+
+    /**
+     * @brief Сменить правила, поле становится пустым
+     */
+    void setRules(const RuleSet& rules);
+
+    const RuleSet& getRules() const { return rules_; }
+
+    int getWidth() const  { return rules_.getWidth(); }
+    int getHeight() const { return rules_.getHeight(); }
+
+    /**
+     * @brief Проверить, что координаты внутри поля
+     */
+    bool isInside(int x, int y) const;
+
+    /**
+     * @brief Заменить расстановку и построить индекс палуб
+     *
+     * Выстрелы убираются. Корабли не проверяются, для этого isCorrect().
+     */
+    void setShips(const std::vector<Ship>& ships);
+
+    const std::vector<Ship>& getShips() const { return ships_; }
+
+    /**
+     * @brief Убрать корабли и выстрелы
+     */
+    void clear();
+
+    /**
+     * @brief Убрать выстрелы, расстановка остаётся
+     */
+    void clearShots();
+
+    /**
+     * @brief Проверить корректность расстановки
+     *
+     * Корабли в пределах поля, не касаются даже углами, состав флота - по
+     * правилам. Касание проверяется прямоугольниками ореолов над блоками
+     * маски, время - по числу кораблей, а не по площади.
+     *
+     * @return true, если расстановка корректна
+     */
+    bool isCorrect() const;
+
+    /**
+     * @brief Номер корабля в клетке или NO_SHIP
+     */
+    int shipAt(int x, int y) const;
+
+    /**
+     * @brief Проверить, стреляли ли уже в клетку
+     */
+    bool isShot(int x, int y) const;
+
+    /**
+     * @brief Получить отображение клетки
+     */
+    CellDraw getCellDraw(int x, int y) const;
+
+    /**
+     * @brief Выстрел по клетке
+     *
+     * Промах отмечает клетку, попадание уменьшает счётчик палуб корабля,
+     * последнее попадание отмечает ореол корабля промахами. Повторный
+     * выстрел ничего не меняет и возвращает текущее состояние клетки.
+     *
+     * @return CELL_DOT, CELL_DAMAGED или CELL_KILLED
+     */
+    CellDraw shoot(int x, int y);
+
+    /**
+     * @brief Клетки уничтоженного корабля и его ореола по строкам
+     * @param ship Номер корабля
+     * @param runs Отрезки: палубы - CELL_KILLED, ореол - CELL_DOT (дописываются в конец)
+     */
+    void getKilledRuns(int ship, std::vector<CellRun>& runs) const;
+
+    /**
+     * @brief Проверить, уничтожены ли все корабли
+     */
+    bool isFleetDestroyed() const;
+
+    /**
+     * @brief Случайная корректная расстановка флота
+     *
+     * Корабли ставятся от длинных к коротким в случайные свободные позиции;
+     * если корабль не встал за несколько сотен попыток, расстановка
+     * начинается заново.
+     *
+     * @param rules Правила
+     * @param random Генератор случайных чисел
+     * @param ships Расстановка
+     * @return false, если флот не удалось расставить (слишком плотные правила)
+     */
+    static bool generate(const RuleSet& rules, std::mt19937_64& random, std::vector<Ship>& ships);
+
+private:
+    /**
+     * @brief Палуба в индексе
+     */
+    struct Deck
+    {
+        int cell_;      ///< Номер клетки
+        int ship_;      ///< Номер корабля
+
+        bool operator<(const Deck& other) const { return cell_ < other.cell_; }
+    };
+
+    /**
+     * @brief Последняя клетка корабля
+     */
+    static int lastX(const Ship& ship) { return ship.x_ + (ship.vertical_ ? 0 : ship.length_ - 1); }
+    static int lastY(const Ship& ship) { return ship.y_ + (ship.vertical_ ? ship.length_ - 1 : 0); }
+
+private:
+    RuleSet rules_;                 ///< Правила
+
+    std::vector<Ship> ships_;       ///< Корабли по номеру
+    std::vector<Deck> decks_;       ///< Палубы всех кораблей по возрастанию номера клетки
+    std::vector<int> alive_;        ///< Непоражённых палуб каждого корабля
+    int aliveShips_;                ///< Неуничтоженных кораблей
+
+    ChunkedBitboard occupied_;      ///< Клетки кораблей
+    ChunkedBitboard hits_;          ///< Подбитые клетки кораблей
+    ChunkedBitboard misses_;        ///< Промахи и ореол уничтоженных кораблей
+};
+
+#endif // SPARSEBOARD_H
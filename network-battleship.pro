@@ -0,0 +1,26 @@
+# Общий проект: ядро, клиент и сервер одной сборкой.
+# qmake network-battleship.pro && make
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    core \
+    client \
+    server \
+    server-headless \
+    shotbench
+
+core.subdir = core
+
+client.subdir = client
+client.depends = core
+
+server.file = server/server.pro
+server.depends = core
+
+server-headless.file = server/server-headless.pro
+server-headless.makefile = Makefile.headless
+server-headless.depends = core
+
+shotbench.file = core/bench/shotbench.pro
+shotbench.depends = core
@@ -0,0 +1,41 @@
+# Packs text placements (100 digits '0'/'1' per line, spaces ignored) into the binary corpus
+# the server memory-maps at startup (PlacementCorpus, server/placementcorpus.hpp).
+#
+# Only base boards are stored: the server derives the 8 rotations/reflections itself,
+# so initial_placements.txt is packed as is, not output_placement.txt.
+#
+# Layout (little-endian):
+#   header 16 bytes: magic "SBPC", version u16 = 1, width u8, height u8,
+#                    board size u16 = ceil(width*height/8), reserved u16 = 0, count u32
+#   count boards:    cell y*width + x is bit (i % 8) of byte i / 8
+
+import struct
+import sys
+
+WIDTH = 10
+HEIGHT = 10
+BOARD_SIZE = (WIDTH * HEIGHT + 7) // 8
+
+
+def pack_board(line):
+    cells = line.replace(" ", "").strip()
+    if len(cells) != WIDTH * HEIGHT or set(cells) - set("01"):
+        raise ValueError("wrong placement: " + line)
+
+    board = bytearray(BOARD_SIZE)
+    for i, cell in enumerate(cells):
+        if cell == "1":
+            board[i // 8] |= 1 << (i % 8)
+    return bytes(board)
+
+
+input_name = sys.argv[1] if len(sys.argv) > 1 else "initial_placements.txt"
+output_name = sys.argv[2] if len(sys.argv) > 2 else "../server/placements.bin"
+
+with open(input_name, "r") as input_file:
+    boards = [pack_board(line) for line in input_file if line.strip()]
+
+with open(output_name, "wb") as output_file:
+    output_file.write(struct.pack("<4sHBBHHI", b"SBPC", 1, WIDTH, HEIGHT, BOARD_SIZE, 0, len(boards)))
+    for board in boards:
+        output_file.write(board)
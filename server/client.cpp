@@ -1,6 +1,14 @@
 #include "client.hpp"
+#include "logger.hpp"
 
 Client::Client() :
+    worker_(nullptr),
+    id_(-1),
+    protocolVersion_(PROTOCOL_VERSION_TEXT),
+    lastSeen_(0),
+    pingSentAt_(0),
+    rttMs_(-1),
+    historySubscribed_(false),
     field_()
 {
 
@@ -12,11 +20,26 @@ Client::~Client()
         delete field_;
 }
 
-Field Client::getField()
+Field& Client::getField()
 {
     return *field_;
 }
 
+const Field& Client::getField() const
+{
+    return *field_;
+}
+
+SparseBoard& Client::getBoard()
+{
+    return board_;
+}
+
+const SparseBoard& Client::getBoard() const
+{
+    return board_;
+}
+
 void Client::setFieldDraw(QVector<Field::CellDraw> field)
 {
     field_->setFieldDraw(field);
@@ -32,6 +55,11 @@ bool Client::isAuthorized() const
     return status_ == ST_AUTHORIZED;
 }
 
+bool Client::hasField() const
+{
+    return field_ != nullptr;
+}
+
 void Client::updateState(ClientStatus state)
 {
     status_ = state;
@@ -44,18 +72,21 @@ void Client::setLogin(const QString& login)
 
 void Client::initField()
 {
+    delete field_;
     field_ = new Field();
     field_->initFieldDraw();
 }
 
 void Client::initField(QString field)
 {
+    delete field_;
     field_ = new Field(field);
     field_->initFieldDraw();
 }
 
 void Client::initField(QString field, QString fieldState)
 {
+    delete field_;
     field_ = new Field(field, fieldState);
     field_->initFieldDraw();
 }
@@ -70,7 +101,6 @@ QString Client::getFieldStr()
 
 bool Client::isCellEmpty(int x, int y)
 {
-    qDebug() << "Client::isCellEmpty";
     return field_->isCellEmpty(x, y);
 }
 
@@ -88,3 +118,18 @@ void Client::setCellDraw(int x, int y, Field::CellDraw state)
 {
     return field_->setCellDraw(x, y, state);
 }
+
+bool Client::isShot(int x, int y)
+{
+    return field_->isShot(x, y);
+}
+
+Bitboard Client::markKilled(int x, int y)
+{
+    return field_->markKilled(x, y);
+}
+
+bool Client::isFleetDestroyed()
+{
+    return field_->isFleetDestroyed();
+}
@@ -3,15 +3,17 @@
  * @brief Класс клиента для серверной части игры "Морской бой"
  * 
  * Этот класс представляет клиента на стороне сервера и хранит всю информацию,
- * связанную с подключенным игроком, включая его состояние, поле и сокет.
+ * связанную с подключенным игроком, включая его состояние, поле и поток ввода-вывода.
  */
 
 #ifndef CLIENT_H
 #define CLIENT_H
 
 #include <QMap>
-#include <QTcpSocket>
 #include "field.hpp"
+#include "sparseboard.hpp"
+#include "ioworker.hpp"
+#include "protocol.hpp"
 
 /**
  * @brief Класс клиента
@@ -75,10 +77,33 @@ public:
     
     /**
      * @brief Получить игровое поле
-     * @return Объект игрового поля
+     * @return Ссылка на поле клиента (поле уже инициализировано)
      */
-    Field getField();
+    Field& getField();
+
+    /**
+     * @brief Получить игровое поле только для чтения
+     * @return Ссылка на поле клиента (поле уже инициализировано)
+     */
+    const Field& getField() const;
     
+    /**
+     * @brief Проверить, что классическое поле уже инициализировано
+     * @return true если initField() вызывался
+     */
+    bool hasField() const;
+
+    /**
+     * @brief Получить поле игры с правилами из GAME:START
+     * @return Поле клиента для неклассических правил (классические - getField())
+     */
+    SparseBoard& getBoard();
+
+    /**
+     * @brief Получить поле игры с правилами из GAME:START только для чтения
+     */
+    const SparseBoard& getBoard() const;
+
     /**
      * @brief Проверить авторизацию клиента
      * @return true если клиент авторизован
@@ -147,15 +172,46 @@ public:
      */
     void setCellDraw(int x, int y, Field::CellDraw state);
 
+    /**
+     * @brief Проверить, стреляли ли уже в клетку
+     * @param x Координата X
+     * @param y Координата Y
+     * @return true если в клетке попадание или промах
+     */
+    bool isShot(int x, int y);
+
+    /**
+     * @brief Отметить уничтоженный корабль и его ореол
+     * @param x Координата X клетки корабля
+     * @param y Координата Y клетки корабля
+     * @return Клетки, отображение которых изменилось
+     */
+    Bitboard markKilled(int x, int y);
+
+    /**
+     * @brief Проверить, уничтожены ли все корабли клиента
+     * @return true если целых клеток кораблей не осталось
+     */
+    bool isFleetDestroyed();
+
 public:
-    QTcpSocket*  socket_;     ///< Сокет для коммуникации с клиентом
+    IOWorker*    worker_;     ///< Поток ввода-вывода, владеющий сокетом клиента
+    int          id_;         ///< ID клиента (ключ в списке клиентов)
     ClientStatus status_;     ///< Текущее состояние клиента
     Readiness readiness_;     ///< Готовность к игре
     ClientIterator enemy_;    ///< Итератор на противника
     QString login_;          ///< Логин пользователя
+    int protocolVersion_;    ///< Согласованная версия протокола
+    qint64 lastSeen_;        ///< Когда от клиента пришёл последний кадр (мс по часам сервера)
+    qint64 pingSentAt_;      ///< Когда отправлен PING: без ответа (0 - не отправлен)
+    int rttMs_;              ///< Сглаженное время PING:/PONG: (-1 - ещё не измерено)
+    bool historySubscribed_; ///< Окно истории открыто, клиент получает HISTORY:APPEND
+    QString invitedLogin_;   ///< Кому клиент отправил последнее приглашение (CONNECTION)
+    RuleSet invitedRules_;   ///< Правила, предложенные в этом приглашении и показанные приглашённому
 
 private:
     Field* field_;           ///< Игровое поле клиента
+    SparseBoard board_;      ///< Поле клиента, если правила игры не классические
 };
 
 typedef QMap<int, Client> Clients;           ///< Тип для хранения списка клиентов
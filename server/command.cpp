@@ -0,0 +1,94 @@
+#include "command.hpp"
+#include <cstring>
+
+static const char* const COMMAND_NAMES[CMD_COUNT] =
+{
+    "UNKNOWN",
+    "MESSAGE",
+    "AUTH",
+    "USERS",
+    "UPDATE",
+    "READINESS",
+    "CONNECTION",
+    "GAME",
+    "HISTORY",
+    "GENERATE",
+    "EXIT",
+    "PONG",
+};
+
+const char* commandName(Command command)
+{
+    if (command < 0 || command >= CMD_COUNT)
+        return COMMAND_NAMES[CMD_UNKNOWN];
+
+    return COMMAND_NAMES[command];
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+Command parseCommand(QByteArrayView frame, QByteArrayView& args)
+{
+    // как раньше с QString::trimmed()
+    while (!frame.isEmpty() && isSpace(frame.front()))
+        frame = frame.sliced(1);
+    while (!frame.isEmpty() && isSpace(frame.back()))
+        frame.chop(1);
+
+    QByteArrayView name = nextField(frame);
+    args = frame;
+
+    Command command = CMD_UNKNOWN;
+
+    switch (commandHash(name.data(), name.size()))
+    {
+        case commandHash("MESSAGE")   : command = CMD_MESSAGE;    break;
+        case commandHash("AUTH")      : command = CMD_AUTH;       break;
+        case commandHash("USERS")     : command = CMD_USERS;      break;
+        case commandHash("UPDATE")    : command = CMD_UPDATE;     break;
+        case commandHash("READINESS") : command = CMD_READINESS;  break;
+        case commandHash("CONNECTION"): command = CMD_CONNECTION; break;
+        case commandHash("GAME")      : command = CMD_GAME;       break;
+        case commandHash("HISTORY")   : command = CMD_HISTORY;    break;
+        case commandHash("GENERATE")  : command = CMD_GENERATE;   break;
+        case commandHash("EXIT")      : command = CMD_EXIT;       break;
+        case commandHash("PONG")      : command = CMD_PONG;       break;
+        default                       : return CMD_UNKNOWN;
+    }
+
+    // хеш совпал - проверить, что это действительно имя команды, а не коллизия
+    return fieldEquals(name, COMMAND_NAMES[command]) ? command : CMD_UNKNOWN;
+}
+
+QByteArrayView nextField(QByteArrayView& rest)
+{
+    const char* colon = rest.isEmpty() ? nullptr : (const char*)memchr(rest.data(), ':', rest.size());
+
+    if (!colon)
+    {
+        QByteArrayView field = rest;
+        rest = QByteArrayView();
+        return field;
+    }
+
+    qsizetype size = colon - rest.data();
+    QByteArrayView field = rest.first(size);
+    rest = rest.sliced(size + 1);
+
+    return field;
+}
+
+bool fieldEquals(QByteArrayView field, const char* str)
+{
+    qsizetype size = (qsizetype)strlen(str);
+
+    return field.size() == size && (size == 0 || memcmp(field.data(), str, size) == 0);
+}
+
+int fieldToInt(QByteArrayView field)
+{
+    return QByteArray::fromRawData(field.data(), field.size()).toInt();
+}
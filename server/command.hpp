@@ -0,0 +1,107 @@
+/**
+ * @file command.hpp
+ * @brief Разбор текстовых команд протокола прямо по байтам кадра
+ *
+ * Команда - часть кадра до первого ':'. Имя команды хешируется (FNV-1a)
+ * и разбирается одним switch, хеши имён считаются при компиляции,
+ * поэтому совпадение двух хешей не соберётся (повтор метки case).
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QtGlobal>
+
+/**
+ * @brief Текстовые команды клиента
+ */
+enum Command
+{
+    CMD_UNKNOWN = 0 ,   ///< Нераспознанная команда
+    CMD_MESSAGE     ,   ///< MESSAGE:<receiver>:<message>
+    CMD_AUTH        ,   ///< AUTH:<login>[:V2]
+    CMD_USERS       ,   ///< USERS:
+    CMD_UPDATE      ,   ///< UPDATE:
+    CMD_READINESS   ,   ///< READINESS:<readiness>
+    CMD_CONNECTION  ,   ///< CONNECTION:<login>[:ACCEPT/REJECT]
+    CMD_GAME        ,   ///< GAME:...
+    CMD_HISTORY     ,   ///< HISTORY:UPDATE: / HISTORY:PAGE:<cursor>:<limit> / HISTORY:SUBSCRIBE: / HISTORY:UNSUBSCRIBE:
+    CMD_GENERATE    ,   ///< GENERATE:
+    CMD_EXIT        ,   ///< EXIT:
+    CMD_PONG        ,   ///< PONG:
+
+    CMD_COUNT           ///< Количество команд
+};
+
+/**
+ * @brief Статистика обработки команды
+ */
+struct CommandStats
+{
+    quint64 count = 0;  ///< Сколько раз пришла
+    quint64 bytes = 0;  ///< Суммарный размер кадров
+    qint64  nsecs = 0;  ///< Суммарное время обработки, нс
+};
+
+/**
+ * @brief Хеш FNV-1a имени команды
+ * @param str Имя команды
+ * @param size Длина имени
+ */
+constexpr quint64 commandHash(const char* str, qsizetype size)
+{
+    quint64 hash = 14695981039346656037ULL;
+
+    for (qsizetype i = 0; i < size; i++)
+    {
+        hash ^= (quint8)str[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Хеш FNV-1a строкового литерала (для меток case)
+ */
+template<qsizetype N>
+constexpr quint64 commandHash(const char (&str)[N])
+{
+    return commandHash(str, N - 1);
+}
+
+/**
+ * @brief Получить имя команды
+ * @param command Команда
+ * @return Имя без ':' или "UNKNOWN"
+ */
+const char* commandName(Command command);
+
+/**
+ * @brief Определить команду кадра
+ * @param frame Кадр без разделителя
+ * @param args Остаток кадра после "<command>:"
+ * @return Команда или CMD_UNKNOWN
+ */
+Command parseCommand(QByteArrayView frame, QByteArrayView& args);
+
+/**
+ * @brief Отделить очередное поле до ':'
+ * @param rest Непрочитанная часть, сдвигается за поле и разделитель
+ * @return Поле (если ':' нет - весь остаток)
+ */
+QByteArrayView nextField(QByteArrayView& rest);
+
+/**
+ * @brief Сравнить поле со строкой
+ */
+bool fieldEquals(QByteArrayView field, const char* str);
+
+/**
+ * @brief Прочитать число из поля (0 если поле не число, как QString::toInt)
+ */
+int fieldToInt(QByteArrayView field);
+
+#endif // COMMAND_H
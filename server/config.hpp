@@ -1,8 +1,42 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define FIELD_WIDTH_DEFAULT     10
-#define FIELD_HEIGHT_DEFAULT    10
+#include "rules.hpp"    // размер поля и флот - общие правила ядра (core/rules.hpp)
+
+#define FIELD_WIDTH_DEFAULT     Rules::WIDTH
+#define FIELD_HEIGHT_DEFAULT    Rules::HEIGHT
 #define DEFAULT_SEARCH_INTERVAL 3000
 
+#define SERVER_IO_THREADS_DEFAULT   0           // потоков ввода-вывода, 0 - по числу ядер; игровая логика - в одном потоке Server
+#define SERVER_PORT_DEFAULT         50000
+#define SERVER_DB_PATH_DEFAULT      "data.db"
+#define SERVER_CORPUS_PATH_DEFAULT  ""          // набор расстановок (placements/pack_corpus.py); пусто - генератор
+#define LOG_VIEW_LINES_PER_TICK     200         // сколько строк журнала окно сервера выводит за тик таймера
+
+// ограничения исходящего буфера сокета, переопределяются через DEFINES
+#ifndef SERVER_WRITE_HIGH_WATERMARK
+#define SERVER_WRITE_HIGH_WATERMARK     (256 * 1024)    // выше - клиент перегружен, необязательные сообщения не шлются
+#endif
+#ifndef SERVER_WRITE_LOW_WATERMARK
+#define SERVER_WRITE_LOW_WATERMARK      (64 * 1024)     // ниже - клиент снова получает всё
+#endif
+#ifndef SERVER_SLOW_CONSUMER_TIMEOUT_MS
+#define SERVER_SLOW_CONSUMER_TIMEOUT_MS 10000           // перегруженный дольше клиент отключается
+#endif
+#define SERVER_WRITE_CHECK_INTERVAL_MS  1000            // период проверки перегруженных клиентов
+
+// проверка живости клиентов (PING:/PONG:)
+#ifndef HEARTBEAT_IDLE_MS
+#define HEARTBEAT_IDLE_MS           15000       // молчащему дольше клиенту уходит PING:
+#endif
+#ifndef HEARTBEAT_TIMEOUT_MS
+#define HEARTBEAT_TIMEOUT_MS        10000       // не ответивший за это время на PING: отключается
+#endif
+#define HEARTBEAT_TICK_MS           500         // тик колеса таймеров
+#define HEARTBEAT_WHEEL_SLOTS       64          // ячеек колеса: оборот 32 с, больше любого срока выше
+
+#define HISTORY_PAGE_LIMIT_MAX      100         // больше строк истории за один HISTORY:PAGE не отдаётся
+
+#define PLACEMENT_POOL_SIZE         64          // готовых расстановок для GENERATE:, пул пополняется с половины
+
 #endif // CONFIG_H
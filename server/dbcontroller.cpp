@@ -1,11 +1,13 @@
 #include "dbcontroller.hpp"
+#include "logger.hpp"
+#include "protocol.hpp"
 #include <QSqlError>
 #include <QSqlRecord>
 #include <QDebug>
 #include <cstdlib>
 #include <ctime>
 
-DBController::DBController(QWidget* parent) : QDialog(parent)
+DBController::DBController(QObject* parent) : QObject(parent)
 {
     srand(time(nullptr));
 }
@@ -21,7 +23,7 @@ void DBController::connectDatabase(const QString& dbName)
 
     if(!db_.open())
     {
-        qDebug() << "Error opening database: " << db_.lastError().text();
+        LOG_WARNING(LOG_CAT_DB) << "Error opening database: " << db_.lastError().text();
         return;
     }
 
@@ -40,12 +42,12 @@ void DBController::createTable(QString tableName, QString tableFormat)
         // Если таблица не существует, создаем ее
         if (!query_->exec("CREATE TABLE " + tableName + "(" + tableFormat + ");"))
         {
-            qDebug() << "Ошибка при создании таблицы " + tableName + ":" << query_->lastError().text();
+            LOG_WARNING(LOG_CAT_DB) << "Ошибка при создании таблицы " + tableName + ":" << query_->lastError().text();
             return;
         }
     }
 
-    qDebug() << "Таблица " + tableName + " успешно создана или уже существует.";
+    LOG_DEBUG(LOG_CAT_DB) << "Таблица " + tableName + " успешно создана или уже существует.";
 
     model_ = new QSqlTableModel(this, db_);
     model_->setTable(tableName);
@@ -54,14 +56,20 @@ void DBController::createTable(QString tableName, QString tableFormat)
 //    parent->ui->tableView->setModel(model_);
 }
 
+void DBController::createIndex(const QString& indexName, const QString& tableName, const QString& columns)
+{
+    if (!query_->exec("CREATE INDEX IF NOT EXISTS " + indexName + " ON " + tableName + "(" + columns + ");"))
+        LOG_WARNING(LOG_CAT_DB) << "Ошибка при создании индекса " + indexName + ":" << query_->lastError().text();
+}
+
 QString DBController::getRandomField()
 {
     int nFields = tableLen("Fields");
-    qDebug() << "nFields = " + QString::number(nFields);
+    LOG_DEBUG(LOG_CAT_DB) << "nFields = " + QString::number(nFields);
 
     if (nFields <= 0)
     {
-        qDebug() << "Нет расстановок в БД таблице Fields";
+        LOG_DEBUG(LOG_CAT_DB) << "Нет расстановок в БД таблице Fields";
         return "";
     }
 
@@ -72,12 +80,12 @@ QString DBController::getRandomField()
 
     if (!query_->next())
     {
-        qDebug() << "No random string found.";
+        LOG_DEBUG(LOG_CAT_DB) << "No random string found.";
         return "";
     }
 
     QString randomString = query_->value(0).toString();
-    qDebug() << "Random field: " << randomString;
+    LOG_DEBUG(LOG_CAT_DB) << "Random field: " << randomString;
     return randomString;
 }
 
@@ -89,72 +97,97 @@ QStringList DBController::getGamesEndings()
     if (query.exec())
     {
         while (query.next())
-        {
-            const char* player1 = query.value(0).toString().toUtf8().constData();
-            const char* player2 = query.value(1).toString().toUtf8().constData();
-            const char* field_text1 = query.value(2).toString().toUtf8().constData();
-            const char* field_text2 = query.value(3).toString().toUtf8().constData();
-            const char* start_date = query.value(4).toString().toUtf8().constData();
-            const char* end_date = query.value(5).toString().toUtf8().constData();
-            const char* winner = query.value(6).toString().toUtf8().constData();
-
-            QString formattedString = QString::asprintf("%s:%s:%s:%s:%s:%s:%s", player1, player2, field_text1, field_text2, start_date, end_date, winner);
-            list.push_back(formattedString);
-        }
+            list.push_back(formatGameEnding(query, 0));
     }
 
     return list;
 }
 
-void DBController::addNewPlacement(QString field)
+QString DBController::getGameEnding(qint64 rowId)
 {
-    query_->prepare("INSERT INTO Fields (field_text) VALUES (:text)");
-    query_->bindValue(":text", field);
-    query_->exec();
+    QSqlQuery query(db_);
+    query.prepare("SELECT player1, player2, field_text1, field_text2, start_date, end_date, winner FROM GamesEndings WHERE rowid = :id");
+    query.bindValue(":id", rowId);
+
+    if (!query.exec() || !query.next())
+        return "";
+
+    return formatGameEnding(query, 0);
 }
 
-void DBController::addNewGameEnding(GamesIterator gameIt)
+QStringList DBController::getGamesEndingsPage(qint64 cursor, int limit, qint64& nextCursor)
 {
-    // Подготавливаем запрос для вставки новой записи в таблицу GamesEndings
-    query_->prepare("INSERT INTO GamesEndings (player1, player2, field_text1, field_text2, start_date, end_date, winner)"
-                    "VALUES (:player1, :player2, :field_text1, :field_text2, :start_date, :end_date, :winner)");
-
-    // Конвертация карты из строки в формат заполненных и пустых квадратов поля 10x10
-    QString firstPlayerField  = gameIt->getClientStartedIt()->getFieldStr();
-    QString secondPlayerField = gameIt->getClientAcceptedIt()->getFieldStr();
-    int firstFieldSize  = firstPlayerField.size();
-    int secondFieldSize = secondPlayerField.size();
+    QSqlQuery query(db_);
+    QStringList list;
 
-    QString myString = QString("■").repeated(10);
-    QString formatFirstPlayerField  = QString("0").repeated(firstFieldSize);
-    QString formatSecondPlayerField = QString("0").repeated(secondFieldSize);
+    nextCursor = 0;
 
-    for(int i = 0; i < firstFieldSize; i++)
+    // ключ страницы (end_date, rowid) идёт по индексу GamesEndings_end_date, OFFSET не нужен
+    if (cursor > 0)
     {
-        if(firstPlayerField[i] == '0')
-        {
-            formatFirstPlayerField[i] = QChar(0x25A1);
-        }
+        query.prepare("SELECT rowid, player1, player2, field_text1, field_text2, start_date, end_date, winner FROM GamesEndings "
+                      "WHERE (end_date, rowid) < (SELECT end_date, rowid FROM GamesEndings WHERE rowid = :cursor) "
+                      "ORDER BY end_date DESC, rowid DESC LIMIT :limit");
+        query.bindValue(":cursor", cursor);
+    }
+    else
+    {
+        query.prepare("SELECT rowid, player1, player2, field_text1, field_text2, start_date, end_date, winner FROM GamesEndings "
+                      "ORDER BY end_date DESC, rowid DESC LIMIT :limit");
+    }
 
-        else if(firstPlayerField[i] == '1')
-        {
-            formatFirstPlayerField[i] = QChar(0x25A0);
-        }
+    query.bindValue(":limit", limit + 1);   // лишняя строка - признак следующей страницы
+
+    if (!query.exec())
+    {
+        LOG_WARNING(LOG_CAT_DB) << "Ошибка при выполнении запроса:" << query.lastError().text();
+        return list;
     }
 
-    for(int i = 0; i < secondFieldSize; i++)
+    qint64 lastRowId = 0;
+
+    while (query.next())
     {
-        if(secondPlayerField[i] == '0')
+        if (list.size() == limit)
         {
-            formatSecondPlayerField[i] = QChar(0x25A1);
+            nextCursor = lastRowId;
+            break;
         }
 
-        else if(secondPlayerField[i] == '1')
-        {
-            formatSecondPlayerField[i] = QChar(0x25A0);
-        }
+        lastRowId = query.value(0).toLongLong();
+        list.push_back(formatGameEnding(query, 1));
     }
 
+    return list;
+}
+
+QString DBController::formatGameEnding(const QSqlQuery& query, int firstColumn)
+{
+    QStringList values;
+
+    for (int i = firstColumn; i < firstColumn + 7; i++)
+        values.append(query.value(i).toString());
+
+    return values.join(":");
+}
+
+void DBController::addNewPlacement(QString field)
+{
+    query_->prepare("INSERT INTO Fields (field_text) VALUES (:text)");
+    query_->bindValue(":text", Protocol::encodeFieldText(field));  // 18 символов вместо 100
+    query_->exec();
+}
+
+qint64 DBController::addNewGameEnding(GamesIterator gameIt)
+{
+    // Подготавливаем запрос для вставки новой записи в таблицу GamesEndings
+    query_->prepare("INSERT INTO GamesEndings (player1, player2, field_text1, field_text2, start_date, end_date, winner)"
+                    "VALUES (:player1, :player2, :field_text1, :field_text2, :start_date, :end_date, :winner)");
+
+    // Расстановки хранятся упакованными (Protocol::encodeFieldText), клетки ■/□ рисует окно истории
+    QString formatFirstPlayerField  = Protocol::encodeFieldText(gameIt->getClientStartedIt()->getFieldStr());
+    QString formatSecondPlayerField = Protocol::encodeFieldText(gameIt->getClientAcceptedIt()->getFieldStr());
+
     // Привязка значения к конкретному полю
     query_->bindValue(":player1",     gameIt->getClientStartedIt()->login_);
     query_->bindValue(":player2",     gameIt->getClientAcceptedIt()->login_);
@@ -165,24 +198,30 @@ void DBController::addNewGameEnding(GamesIterator gameIt)
     query_->bindValue(":winner",      gameIt->winnerLogin_);
 
     // Консольный тест
-    qDebug() << gameIt->getClientStartedIt()->login_;
-    qDebug() << gameIt->getClientAcceptedIt()->login_;
-    qDebug() << formatFirstPlayerField;
-    qDebug() << formatSecondPlayerField;
-    qDebug() << gameIt->startDate_.toString("yyyy-MM-dd") << gameIt->startTime_.toString("hh:mm:ss");
-    qDebug() << gameIt->endDate_.toString("yyyy-MM-dd")   << gameIt->endTime_.toString("hh:mm:ss");
-    qDebug() << gameIt->winnerLogin_;
+    LOG_DEBUG(LOG_CAT_DB) << gameIt->getClientStartedIt()->login_;
+    LOG_DEBUG(LOG_CAT_DB) << gameIt->getClientAcceptedIt()->login_;
+    LOG_DEBUG(LOG_CAT_DB) << formatFirstPlayerField;
+    LOG_DEBUG(LOG_CAT_DB) << formatSecondPlayerField;
+    LOG_DEBUG(LOG_CAT_DB) << gameIt->startDate_.toString("yyyy-MM-dd") << gameIt->startTime_.toString("hh:mm:ss");
+    LOG_DEBUG(LOG_CAT_DB) << gameIt->endDate_.toString("yyyy-MM-dd")   << gameIt->endTime_.toString("hh:mm:ss");
+    LOG_DEBUG(LOG_CAT_DB) << gameIt->winnerLogin_;
 
     // Выполнение подготовленного запроса
-    query_->exec();
-    qDebug() << "New game result pushed to database!";
+    if (!query_->exec())
+    {
+        LOG_WARNING(LOG_CAT_DB) << "Ошибка при сохранении игры:" << query_->lastError().text();
+        return 0;
+    }
+
+    LOG_DEBUG(LOG_CAT_DB) << "New game result pushed to database!";
+    return query_->lastInsertId().toLongLong();
 }
 
 void DBController::disconnectDatabase()
 {
     if(!db_.isOpen())
     {
-        qDebug() << "Wasn't opened";
+        LOG_DEBUG(LOG_CAT_DB) << "Wasn't opened";
         return;
     }
 
@@ -201,11 +240,11 @@ void DBController::clearDatabase()
     {
         if (!query_->exec("DELETE FROM " + table))
         {
-            qDebug() << "Ошибка при удалении данных из таблицы" << table << ":" << query_->lastError().text();
+            LOG_WARNING(LOG_CAT_DB) << "Ошибка при удалении данных из таблицы" << table << ":" << query_->lastError().text();
         }
         else
         {
-            qDebug() << "Данные успешно удалены из таблицы" << table;
+            LOG_DEBUG(LOG_CAT_DB) << "Данные успешно удалены из таблицы" << table;
         }
     }
 }
@@ -215,7 +254,7 @@ void DBController::printTable(const QString& tableName)
     *query_ = QSqlQuery("SELECT * FROM " + tableName, db_);
 
     if (!query_->exec()) {
-        qDebug() << "Ошибка при выполнении запроса:" << query_->lastError().text();
+        LOG_WARNING(LOG_CAT_DB) << "Ошибка при выполнении запроса:" << query_->lastError().text();
         return;
     }
 
@@ -227,13 +266,13 @@ void DBController::printTable(const QString& tableName)
     {
         for (int i = 0; i < columns; ++i)
         {
-            qDebug() << rec.fieldName(i) << ":" << query_->value(i).toString();
+            LOG_DEBUG(LOG_CAT_DB) << rec.fieldName(i) << ":" << query_->value(i).toString();
         }
-        qDebug() << "-----------------------";
+        LOG_DEBUG(LOG_CAT_DB) << "-----------------------";
     }
 
-    qDebug() << "  Имя таблицы: " << tableName;
-    qDebug() << "Длина таблицы: " << lines;
+    LOG_DEBUG(LOG_CAT_DB) << "  Имя таблицы: " << tableName;
+    LOG_DEBUG(LOG_CAT_DB) << "Длина таблицы: " << lines;
 }
 
 int DBController::tableLen(const QString& tableName)
@@ -241,7 +280,7 @@ int DBController::tableLen(const QString& tableName)
     *query_ = QSqlQuery("SELECT * FROM " + tableName, db_);
 
     if (!query_->exec()) {
-        qDebug() << "Ошибка при выполнении запроса:" << query_->lastError().text();
+        LOG_WARNING(LOG_CAT_DB) << "Ошибка при выполнении запроса:" << query_->lastError().text();
         return 0;
     }
 
@@ -2,7 +2,7 @@
 #define DBCONTROLLER_HPP
 
 #include <QDebug>
-#include <QDialog>
+#include <QObject>
 #include <qsqldatabase.h>
 #include <QSqlQuery>
 #include <QSqlTableModel>
@@ -10,17 +10,18 @@
 #include <QDateTime>
 #include "gamecontroller.hpp"
 
-class DBController : public QDialog
+class DBController : public QObject
 {
     Q_OBJECT
 public:
-    explicit DBController(QWidget* parent = nullptr);
+    explicit DBController(QObject* parent = nullptr);
     ~DBController();
 
     void connectDatabase(const QString& dbName);
     void disconnectDatabase();
     void runQuery(QString queryStr);
     void createTable(QString tableName, QString tableFormat);
+    void createIndex(const QString& indexName, const QString& tableName, const QString& columns);
 
     void printTable(const QString& tableName);
     int tableLen(const QString& tableName);
@@ -28,8 +29,13 @@ public:
 
     QString getRandomField();
     QStringList getGamesEndings();
+    QString getGameEnding(qint64 rowId);
+    QStringList getGamesEndingsPage(qint64 cursor, int limit, qint64& nextCursor);   // новые сверху; cursor 0 - первая страница, nextCursor 0 - страниц больше нет
     void addNewPlacement(QString field);
-    void addNewGameEnding(GamesIterator gameIt);
+    qint64 addNewGameEnding(GamesIterator gameIt);     // номер новой записи (rowid), 0 при ошибке
+
+private:
+    static QString formatGameEnding(const QSqlQuery& query, int firstColumn);    // <player1>:<player2>:<field1>:<field2>:<start>:<end>:<winner>
 
 private:
     QSqlDatabase db_;
@@ -4,6 +4,10 @@
  * 
  * Этот класс реализует игровое поле, управляет размещением кораблей,
  * их состоянием и отображением.
+ *
+ * Логика поля (маски, индекс кораблей, проверка правил) - ClassicBoard из
+ * libseabattle-core (core/board.hpp). Field добавляет к нему координаты,
+ * строки и векторы Qt прежнего API, они собираются из масок по запросу.
  */
 
 #ifndef FIELD_H
@@ -13,11 +17,12 @@
 #include <QDebug>
 #include <QString>
 #include "./config.hpp"
+#include "board.hpp"
 
 /**
  * @brief Состояния клетки поля
  */
-enum Cell
+enum class Cell
 {
     CELL_EMPTY = 0  ,   ///< Пустая клетка
     CELL_SHIP       ,   ///< Клетка с кораблем
@@ -29,7 +34,7 @@ enum Cell
  * Реализует игровое поле, управляет размещением кораблей,
  * их состоянием и отображением.
  */
-class Field
+class Field : public ClassicBoard
 {
 public:
     /**
@@ -55,34 +60,8 @@ public:
      */
     ~Field();
 
-    /**
-     * @brief Состояния клетки
-     */
-    enum CellState
-    {
-        CL_ST_EMPTY     = 0,    ///< Пустая клетка
-        CL_ST_CENTER    = 1,    ///< Центральная клетка (единичный корабль)
-        CL_ST_TOP       = 2,    ///< Верхняя клетка корабля (вертикального)
-        CL_ST_BOTTOM    = 3,    ///< Нижняя клетка корабля (вертикального)
-        CL_ST_VMIDDLE   = 4,    ///< Серединная клетка вертикально ориентированного корабля
-        CL_ST_HMIDDLE   = 5,    ///< Серединная клетка горизонтально ориентированного корабля
-        CL_ST_LEFT      = 6,    ///< Левая клетка корабля (горизонтального)
-        CL_ST_RIGHT     = 7,    ///< Правая клетка корабля (горизонтального)
-        CL_ST_UNDEFINED = 8,    ///< Неопределённое непустое состояние клетки
-    };
-
-    /**
-     * @brief Состояния клетки для отрисовки
-     */
-    enum CellDraw
-    {
-        CELL_EMPTY = 0  ,   ///< Пустое поле
-        CELL_LIVE       ,   ///< Часть живого корабля (ещё не попали)
-        CELL_DOT        ,   ///< Выстрел - промах
-        CELL_DAMAGED    ,   ///< Подбитое поле частично подбитого корабля
-        CELL_KILLED     ,   ///< Поле полностью подбитого корабля
-        CELL_MARK       ,   ///< Помеченное пользователем поле (как флажок в сапёре)
-    };
+    typedef ::CellState CellState;  ///< Состояния клетки (core/board.hpp)
+    typedef ::CellDraw CellDraw;    ///< Состояния клетки для отрисовки (core/board.hpp)
 
     /**
      * @brief Получить состояние клетки
@@ -98,18 +77,6 @@ public:
      */
     QVector<Cell> getField();
     
-    /**
-     * @brief Получить ширину поля
-     * @return Ширина поля
-     */
-    int getWidth();
-    
-    /**
-     * @brief Получить высоту поля
-     * @return Высота поля
-     */
-    int getHeight();
-    
     /**
      * @brief Получить строковое представление поля
      * @return Строка с состоянием поля
@@ -126,7 +93,7 @@ public:
      * @brief Получить строковое представление отображения поля
      * @return Строка с состоянием отображения
      */
-    QString getFieldDrawStr();
+    QString getFieldDrawStr() const;
     
     /**
      * @brief Получить состояние поля
@@ -140,6 +107,29 @@ public:
      */
     QVector<CellDraw> getFieldDraw();
 
+    /**
+     * @brief Отображение поля без копирования
+     *
+     * Ведёт себя как контейнер (size(), operator[]), но клетки читает прямо
+     * из масок поля. Живёт не дольше поля, на которое ссылается.
+     */
+    class DrawView
+    {
+    public:
+        explicit DrawView(const Field& field) : field_(field) {}
+
+        int size() const { return AREA; }
+        CellDraw operator[](int index) const { return field_.getCellDraw(index); }
+
+    private:
+        const Field& field_;    ///< Поле, которое показываем
+    };
+
+    /**
+     * @brief Получить отображение поля без копирования
+     */
+    DrawView getDrawView() const;
+
     /**
      * @brief Установить состояние клетки
      * @param x X-координата
@@ -182,11 +172,6 @@ public:
      */
     void setFieldDraw(QVector<Field::CellDraw> field);
 
-    /**
-     * @brief Очистить поле
-     */
-    void clear();
-    
     /**
      * @brief Сгенерировать случайное поле
      */
@@ -198,7 +183,9 @@ public:
     void initFieldDraw();
     
     /**
-     * @brief Инициализировать состояние поля
+     * @brief Инициализировать состояние поля: построить индекс кораблей
+     *
+     * Вызывается сеттерами расстановки, вручную звать не обязательно.
      */
     void initFieldState();
 
@@ -210,12 +197,6 @@ public:
      */
     bool isCellEmpty(int x, int y);
     
-    /**
-     * @brief Проверить корректность поля
-     * @return true, если поле корректно
-     */
-    bool isCorrect() const;
-    
     /**
      * @brief Проверить, убит ли корабль
      * @param x X-координата
@@ -224,13 +205,29 @@ public:
      */
     bool isKilled(int x, int y);
 
-private:
-    int width_;                    ///< Ширина поля
-    int height_;                   ///< Высота поля
-    int area_;                     ///< Площадь поля
-    QVector<Cell> field_;          ///< Поле
-    QVector<CellState> fieldState_; ///< Состояние поля
-    QVector<CellDraw> fieldDraw_;   ///< Отображение поля
+    /**
+     * @brief Проверить, стреляли ли уже в клетку
+     * @param x X-координата
+     * @param y Y-координата
+     * @return true, если в клетке попадание или промах
+     */
+    bool isShot(int x, int y) const;
+
+    /**
+     * @brief Получить клетки корабля, которому принадлежит клетка
+     * @param x X-координата
+     * @param y Y-координата
+     * @return Маска клеток корабля (пустая, если в клетке нет корабля)
+     */
+    Bitboard getShip(int x, int y) const;
+
+    /**
+     * @brief Отметить корабль уничтоженным, а его ореол - промахами
+     * @param x X-координата клетки корабля
+     * @param y Y-координата клетки корабля
+     * @return Клетки, отображение которых изменилось
+     */
+    Bitboard markKilled(int x, int y);
 };
 
 #endif // FIELD_H
@@ -1,16 +1,19 @@
 #include "gamecontroller.hpp"
+#include "logger.hpp"
 
-GameController::GameController(int gameId, ClientsIterator clientStarted, ClientsIterator clientAccepted) :
+GameController::GameController(int gameId, ClientsIterator clientStarted, ClientsIterator clientAccepted, const RuleSet& rules) :
     clientStarted_(clientStarted)                       ,
     clientAccepted_(clientAccepted)                     ,
     // clientStartedField_(clientStarted->getField())      ,
     // clientAcceptedField_(clientAccepted_->getField())   ,
     gameId_(gameId)                                     ,
     state_(ST_NSTARTED)                                 ,
-    nPlaced_(0)                                         ,
-    nDecks_(4*1+3*2+2*3+1*4)                            ,
+    startedPlaced_(false)                               ,
+    acceptedPlaced_(false)                              ,
+    nDecks_(rules.getDecks())                           ,
     nStartedDamaged_(0)                                 ,
     nAcceptedDamaged_(0)                                ,
+    rules_(rules)                                       ,
     winnerLogin_()
 {
 
@@ -37,6 +40,11 @@ int GameController::getGameId()
     return gameId_;
 }
 
+const RuleSet& GameController::getRules() const
+{
+    return rules_;
+}
+
 bool GameController::checkGameFinish(bool isStartedKilled)
 {
     if (isStartedKilled)
@@ -48,7 +56,7 @@ bool GameController::checkGameFinish(bool isStartedKilled)
 void GameController::updateState(GameController::GameState state)
 {
     state_ = state;
-    qDebug() << "game" << gameId_ << " state updated to " << state_;
+    LOG_DEBUG(LOG_CAT_GAME) << "game" << gameId_ << " state updated to " << state_;
 }
 
 GameController::GameState GameController::getState()
@@ -56,9 +64,22 @@ GameController::GameState GameController::getState()
     return state_;
 }
 
-void GameController::incNPlaced()
+void GameController::setPlaced(bool isStarted, bool placed)
+{
+    if (isStarted)
+        startedPlaced_ = placed;
+    else
+        acceptedPlaced_ = placed;
+}
+
+bool GameController::isPlaced(bool isStarted) const
 {
-    nPlaced_++;
+    return isStarted ? startedPlaced_ : acceptedPlaced_;
+}
+
+bool GameController::isAllPlaced() const
+{
+    return startedPlaced_ && acceptedPlaced_;
 }
 
 void GameController::incNDamaged(bool isStartedDamaged)
@@ -66,20 +87,15 @@ void GameController::incNDamaged(bool isStartedDamaged)
     if (isStartedDamaged)
     {
         nStartedDamaged_++;
-        qDebug() << "Increased nStartedDamaged_: " << nStartedDamaged_;
+        LOG_DEBUG(LOG_CAT_GAME) << "Increased nStartedDamaged_: " << nStartedDamaged_;
     }
     else
     {
         nAcceptedDamaged_++;
-        qDebug() << "Increased nAcceptedDamaged_: " << nAcceptedDamaged_;
+        LOG_DEBUG(LOG_CAT_GAME) << "Increased nAcceptedDamaged_: " << nAcceptedDamaged_;
     }
 }
 
-int GameController::getNPlaced()
-{
-    return nPlaced_;
-}
-
 //void GameController::startGame()
 //{
 
@@ -11,6 +11,7 @@
 
 #include "config.hpp"
 #include "client.hpp"
+#include "ruleset.hpp"
 #include <QTimer>
 #include <QDateTime>
 
@@ -40,8 +41,9 @@ public:
      * @param gameId ID игры
      * @param clientStarted Итератор на клиента, начавшего игру
      * @param clientAccepted Итератор на клиента, принявшего игру
+     * @param rules Правила игры, согласованные при GAME:START
      */
-    GameController(int gameId, ClientsIterator clientStarted, ClientsIterator clientAccepted);
+    GameController(int gameId, ClientsIterator clientStarted, ClientsIterator clientAccepted, const RuleSet& rules = RuleSet::classic());
     
     /**
      * @brief Деструктор
@@ -66,6 +68,12 @@ public:
      */
     int getGameId();
     
+    /**
+     * @brief Получить правила игры
+     * @return Правила; неклассические играются на SparseBoard клиентов
+     */
+    const RuleSet& getRules() const;
+
     /**
      * @brief Получить текущее состояние игры
      * @return Состояние игры
@@ -79,15 +87,24 @@ public:
     void updateState(GameController::GameState state);
 
     /**
-     * @brief Увеличить счетчик размещенных кораблей
+     * @brief Отметить, принята ли расстановка игрока
+     * @param isStarted true для игрока, начавшего игру
+     * @param placed true, если расстановка принята
      */
-    void incNPlaced();
-    
+    void setPlaced(bool isStarted, bool placed);
+
+    /**
+     * @brief Проверить, принята ли расстановка игрока
+     * @param isStarted true для игрока, начавшего игру
+     * @return true, если расстановка принята
+     */
+    bool isPlaced(bool isStarted) const;
+
     /**
-     * @brief Получить количество размещенных кораблей
-     * @return Количество кораблей
+     * @brief Проверить, что расстановки обоих игроков приняты
+     * @return true, если можно начинать бой
      */
-    int getNPlaced();
+    bool isAllPlaced() const;
     
     /**
      * @brief Увеличить счетчик поврежденных клеток
@@ -138,10 +155,12 @@ public:
 private:
     int gameId_;             ///< ID игры
     GameState state_;        ///< Текущее состояние игры
-    int nPlaced_;            ///< Количество размещенных кораблей
+    bool startedPlaced_;     ///< Расстановка начавшего игру принята
+    bool acceptedPlaced_;    ///< Расстановка принявшего игру принята
     int nAcceptedDamaged_;   ///< Количество поврежденных клеток принявшего игру
     int nStartedDamaged_;    ///< Количество поврежденных клеток начавшего игру
     int nDecks_;             ///< Общее количество палуб
+    RuleSet rules_;          ///< Правила игры
 
     ClientsIterator clientStarted_;     ///< Итератор на клиента, начавшего игру
     ClientsIterator clientAccepted_;    ///< Итератор на клиента, принявшего игру
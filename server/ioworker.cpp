@@ -0,0 +1,224 @@
+#include "ioworker.hpp"
+#include "logger.hpp"
+#include "config.hpp"
+#include <QTimerEvent>
+
+IOWorker::IOWorker(int index) :
+    index_(index),
+    nCongested_(0),
+    checkTimerId_(0)
+{
+
+}
+
+IOWorker::~IOWorker()
+{
+    closeAll();
+}
+
+int IOWorker::getIndex() const
+{
+    return index_;
+}
+
+void IOWorker::addConnection(int clientId, qintptr socketDescriptor)
+{
+    Connection* connection = new Connection;
+    connection->socket_ = new QTcpSocket(this);
+
+    if (!connection->socket_->setSocketDescriptor(socketDescriptor))
+    {
+        LOG_WARNING(LOG_CAT_NET) << "io" << index_ << ": cannot accept socket" << socketDescriptor;
+        delete connection->socket_;
+        delete connection;
+        emit clientDisconnected(clientId);
+        return;
+    }
+
+    connect(connection->socket_, &QTcpSocket::readyRead, this, [this, clientId]() { receiveData(clientId); });
+    connect(connection->socket_, &QTcpSocket::disconnected, this, [this, clientId]() { removeConnection(clientId); });
+    connect(connection->socket_, &QTcpSocket::errorOccurred, this, [this, clientId](QAbstractSocket::SocketError error) { emit clientError(clientId, error); });
+    connect(connection->socket_, &QTcpSocket::bytesWritten, this, [this, clientId]()
+    {
+        Connection* connection = connections_.value(clientId);
+        if (connection && connection->congested_)
+            updateWriteState(clientId, connection);
+    });
+
+    connections_.insert(clientId, connection);
+}
+
+void IOWorker::send(int clientId, const QByteArrayList& chunks)
+{
+    Connection* connection = connections_.value(clientId);
+    if (!connection)
+        return;
+
+    // буферизованный сокет отправит всё одной записью при возврате в цикл событий
+    for (const QByteArray& chunk : chunks)
+        connection->socket_->write(chunk);
+
+    updateWriteState(clientId, connection);
+}
+
+void IOWorker::setBinaryMode(int clientId)
+{
+    Connection* connection = connections_.value(clientId);
+    if (!connection)
+        return;
+
+    connection->decoder_.setMode(FrameDecoder::MODE_BINARY);
+}
+
+void IOWorker::disconnectClient(int clientId)
+{
+    Connection* connection = connections_.value(clientId);
+    if (!connection)
+        return;
+
+    connection->socket_->disconnectFromHost();  // disconnected() придёт после записи остатка буфера
+}
+
+void IOWorker::abortClient(int clientId)
+{
+    Connection* connection = connections_.value(clientId);
+    if (!connection)
+        return;
+
+    connection->socket_->abort();
+    removeConnection(clientId);     // если abort() уже вызвал disconnected(), ничего не делает
+}
+
+void IOWorker::closeAll()
+{
+    for (Connection* connection : std::as_const(connections_))
+    {
+        connection->socket_->disconnect(this);
+        connection->socket_->flush();
+        connection->socket_->close();
+        delete connection->socket_;
+        delete connection;
+    }
+
+    connections_.clear();
+    nCongested_ = 0;
+
+    if (checkTimerId_)
+    {
+        killTimer(checkTimerId_);
+        checkTimerId_ = 0;
+    }
+}
+
+void IOWorker::receiveData(int clientId)
+{
+    Connection* connection = connections_.value(clientId);
+    if (!connection)
+        return;
+
+    FrameDecoder& decoder = connection->decoder_;
+    decoder.readFrom(connection->socket_);
+
+    // кадры одного чтения лежат в буфере декодера подряд: копируется весь отрезок один раз
+    QList<FrameSpan> frames;
+    QByteArrayView frame;
+    const char* batchBegin = nullptr;
+    const char* batchEnd = nullptr;
+
+    while (decoder.nextFrame(frame))
+    {
+        if (!batchBegin)
+            batchBegin = frame.data();
+
+        frames.append(FrameSpan{ frame.data() - batchBegin, frame.size() });
+        batchEnd = frame.data() + frame.size();
+    }
+
+    QByteArray batch = batchBegin ? QByteArray(batchBegin, batchEnd - batchBegin) : QByteArray();
+
+    if (decoder.takeOverflow())
+        LOG_WARNING(LOG_CAT_NET) << "io" << index_ << ": client" << clientId << "too long frame dropped";
+
+    decoder.compact();   // неполный кадр остаётся в буфере до следующего readyRead; batch уже скопирован
+
+    bool isBroken = decoder.isBroken();
+
+    if (!frames.isEmpty())
+        emit framesReceived(clientId, decoder.getMode() == FrameDecoder::MODE_BINARY, batch, frames);
+
+    if (isBroken)   // кадры до испорченного уже отданы; соединение удаляется вместе с декодером
+    {
+        LOG_WARNING(LOG_CAT_NET) << "io" << index_ << ": client" << clientId << "sent a malformed frame length, disconnecting";
+        abortClient(clientId);
+    }
+}
+
+void IOWorker::removeConnection(int clientId)
+{
+    Connection* connection = connections_.take(clientId);
+    if (!connection)
+        return;
+
+    if (connection->congested_)
+        nCongested_--;
+
+    connection->socket_->deleteLater();
+    delete connection;
+
+    emit clientDisconnected(clientId);
+}
+
+void IOWorker::updateWriteState(int clientId, Connection* connection)
+{
+    qint64 pending = connection->socket_->bytesToWrite();
+
+    // два порога, чтобы состояние не переключалось на каждой записи
+    if (!connection->congested_ && pending > SERVER_WRITE_HIGH_WATERMARK)
+    {
+        connection->congested_ = true;
+        connection->congestedSince_.start();
+        nCongested_++;
+
+        if (!checkTimerId_)
+            checkTimerId_ = startTimer(SERVER_WRITE_CHECK_INTERVAL_MS);
+
+        LOG_WARNING(LOG_CAT_NET) << "io" << index_ << ": client" << clientId << "congested," << pending << "bytes pending";
+        emit clientCongested(clientId, true);
+    }
+    else if (connection->congested_ && pending < SERVER_WRITE_LOW_WATERMARK)
+    {
+        connection->congested_ = false;
+        nCongested_--;
+
+        LOG_INFO(LOG_CAT_NET) << "io" << index_ << ": client" << clientId << "drained after" << connection->congestedSince_.elapsed() << "ms";
+        emit clientCongested(clientId, false);
+    }
+}
+
+void IOWorker::timerEvent(QTimerEvent* event)
+{
+    if (event->timerId() != checkTimerId_)
+        return;
+
+    QList<int> slowClients;
+
+    for (auto it = connections_.cbegin(); it != connections_.cend(); ++it)
+    {
+        if ((*it)->congested_ && (*it)->congestedSince_.hasExpired(SERVER_SLOW_CONSUMER_TIMEOUT_MS))
+            slowClients.append(it.key());
+    }
+
+    for (int clientId : slowClients)
+    {
+        Connection* connection = connections_.value(clientId);
+        LOG_WARNING(LOG_CAT_NET) << "io" << index_ << ": client" << clientId << "evicted," << connection->socket_->bytesToWrite() << "bytes not read for" << connection->congestedSince_.elapsed() << "ms";
+
+        abortClient(clientId);   // не ждём записи остатка, которого клиент не читает
+    }
+
+    if (nCongested_ == 0)
+    {
+        killTimer(checkTimerId_);
+        checkTimerId_ = 0;
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * @file ioworker.hpp
+ * @brief Поток ввода-вывода сервера
+ *
+ * Каждый IOWorker живёт в своём QThread со своим циклом событий и владеет
+ * частью сокетов клиентов: читает из них, выделяет кадры и пишет ответы.
+ * Игровая логика остаётся в потоке Server. Все вызовы слотов из других
+ * потоков идут через очередь событий (QMetaObject::invokeMethod), поэтому
+ * порядок команд для одного клиента сохраняется.
+ *
+ * Исходящий буфер сокета ограничен порогами SERVER_WRITE_HIGH/LOW_WATERMARK:
+ * о переходе через них сервер узнаёт из clientCongested(), а клиент,
+ * не разгрузившийся за SERVER_SLOW_CONSUMER_TIMEOUT_MS, отключается.
+ */
+
+#ifndef IOWORKER_H
+#define IOWORKER_H
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QHash>
+#include <QByteArrayList>
+#include <QElapsedTimer>
+#include "framedecoder.hpp"
+
+/**
+ * @brief Кадр внутри пачки, переданной серверу одним буфером
+ */
+struct FrameSpan
+{
+    qsizetype offset_;  ///< Начало кадра в буфере пачки
+    qsizetype size_;    ///< Размер кадра
+};
+
+Q_DECLARE_METATYPE(FrameSpan)
+
+/**
+ * @brief Класс потока ввода-вывода
+ */
+class IOWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Конструктор
+     * @param index Номер потока (для логов)
+     */
+    explicit IOWorker(int index);
+
+    /**
+     * @brief Деструктор
+     */
+    ~IOWorker();
+
+    /**
+     * @brief Получить номер потока
+     */
+    int getIndex() const;
+
+public slots:
+    /**
+     * @brief Принять сокет нового клиента в этот поток
+     * @param clientId ID клиента на сервере
+     * @param socketDescriptor Дескриптор принятого соединения
+     */
+    void addConnection(int clientId, qintptr socketDescriptor);
+
+    /**
+     * @brief Записать данные клиенту
+     * @param clientId ID клиента
+     * @param chunks Готовые к отправке буферы; сокет склеивает их в один буфер записи
+     */
+    void send(int clientId, const QByteArrayList& chunks);
+
+    /**
+     * @brief Переключить приём от клиента на двоичные кадры
+     * @param clientId ID клиента
+     */
+    void setBinaryMode(int clientId);
+
+    /**
+     * @brief Отключить клиента
+     * @param clientId ID клиента
+     */
+    void disconnectClient(int clientId);
+
+    /**
+     * @brief Сбросить соединение, не дожидаясь записи буфера (клиент не читает или не отвечает)
+     * @param clientId ID клиента
+     */
+    void abortClient(int clientId);
+
+    /**
+     * @brief Отключить всех клиентов потока (при остановке сервера)
+     */
+    void closeAll();
+
+signals:
+    /**
+     * @brief Из сокета клиента выделены полные кадры
+     *
+     * Кадры одного чтения уходят в другой поток одним разделяемым буфером:
+     * одно копирование на пачку вместо копии каждого кадра.
+     * @param clientId ID клиента
+     * @param binary true если кадры двоичные
+     * @param batch Байты пачки: кадры вместе с разделителями или префиксами длины
+     * @param frames Положение кадров в batch (без разделителя или префикса длины)
+     */
+    void framesReceived(int clientId, bool binary, const QByteArray& batch, const QList<FrameSpan>& frames);
+
+    /**
+     * @brief Клиент отключился
+     * @param clientId ID клиента
+     */
+    void clientDisconnected(int clientId);
+
+    /**
+     * @brief Ошибка сокета клиента
+     * @param clientId ID клиента
+     * @param error Код ошибки
+     */
+    void clientError(int clientId, QAbstractSocket::SocketError error);
+
+    /**
+     * @brief Исходящий буфер клиента перешёл через порог
+     * @param clientId ID клиента
+     * @param congested true - выше верхнего порога, false - снова ниже нижнего
+     */
+    void clientCongested(int clientId, bool congested);
+
+protected:
+    /**
+     * @brief Проверка перегруженных клиентов
+     */
+    void timerEvent(QTimerEvent* event) override;
+
+private:
+    /**
+     * @brief Соединение с клиентом
+     */
+    struct Connection
+    {
+        QTcpSocket* socket_;            ///< Сокет клиента
+        FrameDecoder decoder_;          ///< Декодер входящих кадров
+        bool congested_ = false;        ///< Буфер записи выше верхнего порога
+        QElapsedTimer congestedSince_;  ///< Когда буфер перешёл верхний порог
+    };
+
+    /**
+     * @brief Прочитать данные клиента и отдать полные кадры серверу
+     * @param clientId ID клиента
+     */
+    void receiveData(int clientId);
+
+    /**
+     * @brief Удалить соединение
+     * @param clientId ID клиента
+     */
+    void removeConnection(int clientId);
+
+    /**
+     * @brief Сравнить буфер записи с порогами и сообщить серверу о переходе
+     * @param clientId ID клиента
+     * @param connection Соединение клиента
+     */
+    void updateWriteState(int clientId, Connection* connection);
+
+private:
+    int index_;                             ///< Номер потока
+    QHash<int, Connection*> connections_;   ///< Соединения этого потока по ID клиента
+    int nCongested_;                        ///< Сколько соединений выше верхнего порога
+    int checkTimerId_;                      ///< Таймер проверки перегруженных (0 - не запущен)
+};
+
+#endif // IOWORKER_H
@@ -0,0 +1,232 @@
+#include "logger.hpp"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <cstdio>
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+LogRecord::LogRecord(LogLevel level, LogCategory category) :
+    level_(level),
+    category_(category)
+{
+
+}
+
+LogRecord::~LogRecord()
+{
+    Logger::instance().push(level_, category_, std::move(text_));
+}
+
+QDebug LogRecord::stream()
+{
+    return QDebug(&text_).noquote();
+}
+
+Logger& Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() :
+    ring_(LOG_RING_SIZE),
+    enqueuePos_(0),
+    dequeuePos_(0),
+    dropped_(0),
+    running_(true),
+    sleeping_(false),
+    tailSkipped_(0)
+{
+    for (size_t i = 0; i < ring_.size(); i++)
+        ring_[i].seq.store(i, std::memory_order_relaxed);
+
+    writer_ = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    stop();
+}
+
+bool Logger::push(LogLevel level, LogCategory category, QString text)
+{
+    const size_t mask = ring_.size() - 1;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Slot* slot = nullptr;
+
+    // ограниченная очередь Вьюкова: ячейка свободна, когда её seq равен позиции записи
+    for (;;)
+    {
+        slot = &ring_[pos & mask];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            dropped_.fetch_add(1, std::memory_order_relaxed);  // поток вывода не успевает - не ждём его
+            return false;
+        }
+        else
+        {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record.time = QDateTime::currentMSecsSinceEpoch();
+    slot->record.level = level;
+    slot->record.category = category;
+    slot->record.text = std::move(text);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // пара к барьеру в run(): либо поток вывода увидит запись, либо писатель увидит sleeping_
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed))
+        wakeWriter();
+
+    return true;
+}
+
+bool Logger::pop(Record& record)
+{
+    Slot& slot = ring_[dequeuePos_ & (ring_.size() - 1)];
+
+    if (slot.seq.load(std::memory_order_acquire) != dequeuePos_ + 1)
+        return false;
+
+    record = std::move(slot.record);
+    slot.seq.store(dequeuePos_ + ring_.size(), std::memory_order_release);
+    dequeuePos_++;
+
+    return true;
+}
+
+bool Logger::hasRecord() const
+{
+    return ring_[dequeuePos_ & (ring_.size() - 1)].seq.load(std::memory_order_acquire) == dequeuePos_ + 1;
+}
+
+void Logger::wakeWriter()
+{
+    QMutexLocker locker(&wakeMutex_);   // поток вывода либо ещё проверяет буфер под мьютексом, либо уже ждёт
+    wakeCondition_.wakeOne();
+}
+
+void Logger::run()
+{
+    Record record;
+
+    for (;;)
+    {
+        bool wasRunning = running_.load(std::memory_order_acquire);
+        int written = 0;
+
+        while (pop(record))
+        {
+            write(record);
+            written++;
+        }
+
+        quint64 dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if (dropped)
+            fprintf(stderr, "logger: %llu records dropped\n", (unsigned long long)dropped);
+
+        if (written)
+            fflush(stderr);
+
+        if (!wasRunning)
+            break;
+
+        if (written)
+            continue;
+
+        // буфер пуст: ждём, пока push() или stop() разбудят, без опроса по таймеру
+        QMutexLocker locker(&wakeMutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!hasRecord() && running_.load(std::memory_order_acquire))
+            wakeCondition_.wait(&wakeMutex_);
+
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Logger::write(const Record& record)
+{
+    QString line = QDateTime::fromMSecsSinceEpoch(record.time).toString("hh:mm:ss.zzz") + " "
+                 + levelName(record.level) + " " + categoryName(record.category) + ": " + record.text;
+
+    fputs(line.toLocal8Bit().constData(), stderr);
+    fputc('\n', stderr);
+
+    QMutexLocker locker(&tailMutex_);
+
+    tail_.append(record.text);
+    if (tail_.size() > LOG_TAIL_SIZE)
+    {
+        tail_.removeFirst();
+        tailSkipped_++;
+    }
+}
+
+QStringList Logger::takeTail(int maxLines, int& skipped)
+{
+    QMutexLocker locker(&tailMutex_);
+
+    skipped = tailSkipped_;
+    tailSkipped_ = 0;
+
+    if (tail_.size() > maxLines)
+    {
+        skipped += tail_.size() - maxLines;
+        tail_.erase(tail_.begin(), tail_.end() - maxLines);
+    }
+
+    QStringList lines;
+    lines.swap(tail_);
+
+    return lines;
+}
+
+void Logger::stop()
+{
+    if (!writer_.joinable())
+        return;
+
+    running_.store(false, std::memory_order_release);
+    wakeWriter();
+    writer_.join();
+}
+
+const char* Logger::levelName(LogLevel level)
+{
+    switch (level)
+    {
+        case LOG_LEVEL_DEBUG  : return "DEBUG";
+        case LOG_LEVEL_INFO   : return "INFO ";
+        case LOG_LEVEL_WARNING: return "WARN ";
+        case LOG_LEVEL_ERROR  : return "ERROR";
+    }
+
+    return "?";
+}
+
+const char* Logger::categoryName(LogCategory category)
+{
+    switch (category)
+    {
+        case LOG_CAT_SERVER  : return "server";
+        case LOG_CAT_NET     : return "net";
+        case LOG_CAT_PROTOCOL: return "protocol";
+        case LOG_CAT_GAME    : return "game";
+        case LOG_CAT_DB      : return "db";
+        case LOG_CAT_COUNT   : break;
+    }
+
+    return "?";
+}
@@ -0,0 +1,217 @@
+/**
+ * @file logger.hpp
+ * @brief Асинхронный журнал сервера
+ *
+ * Записи кладутся в кольцевой буфер без блокировок (несколько писателей,
+ * один читатель) и выводятся фоновым потоком, поэтому обработчики сервера
+ * не ждут вывода в консоль. Уровень и категории отсекаются при компиляции:
+ * условие выключенной записи LOG_*() константно, её аргументы не вычисляются
+ * и код выбрасывается компилятором.
+ *
+ * Использование: LOG_INFO(LOG_CAT_SERVER) << "Listening on port" << port;
+ */
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QDebug>
+#include <QString>
+#include <QStringList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Уровни важности записей
+ */
+enum LogLevel
+{
+    LOG_LEVEL_DEBUG   = 0,  ///< Отладочные подробности (поля, кадры)
+    LOG_LEVEL_INFO       ,  ///< Штатные события сервера
+    LOG_LEVEL_WARNING    ,  ///< Некорректные запросы и сбои соединений
+    LOG_LEVEL_ERROR      ,  ///< Ошибки сервера
+};
+
+/**
+ * @brief Категории записей
+ */
+enum LogCategory
+{
+    LOG_CAT_SERVER   = 0,   ///< Запуск, остановка, подключения
+    LOG_CAT_NET         ,   ///< Сокеты и потоки ввода-вывода
+    LOG_CAT_PROTOCOL    ,   ///< Входящие и исходящие сообщения
+    LOG_CAT_GAME        ,   ///< Игровая логика и поля
+    LOG_CAT_DB          ,   ///< База данных
+
+    LOG_CAT_COUNT           ///< Количество категорий
+};
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL       LOG_LEVEL_INFO  ///< Записи ниже этого уровня не компилируются (DEFINES += LOG_MIN_LEVEL=0 для отладки)
+#endif
+
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES      0xFFFFFFFFu     ///< Маска включённых категорий (бит 1 << LogCategory)
+#endif
+
+#define LOG_RING_SIZE       4096            ///< Ёмкость кольцевого буфера (степень двойки)
+#define LOG_TAIL_SIZE       1000            ///< Сколько последних строк хранится для окна сервера
+
+/**
+ * @brief Включена ли запись при компиляции
+ */
+constexpr bool logEnabled(LogLevel level, LogCategory category)
+{
+    return level >= LOG_MIN_LEVEL && (LOG_CATEGORIES & (1u << category)) != 0;
+}
+
+// форма "?:" вместо if, чтобы макрос был одним выражением и не забирал чужой else
+#define LOG(level, category) \
+    !logEnabled(level, category) ? (void)0 : LogVoidify() & LogRecord(level, category).stream()
+
+#define LOG_DEBUG(category)     LOG(LOG_LEVEL_DEBUG  , category)
+#define LOG_INFO(category)      LOG(LOG_LEVEL_INFO   , category)
+#define LOG_WARNING(category)   LOG(LOG_LEVEL_WARNING, category)
+#define LOG_ERROR(category)     LOG(LOG_LEVEL_ERROR  , category)
+
+/**
+ * @brief Приводит выражение записи к void для макроса LOG
+ */
+struct LogVoidify
+{
+    void operator&(const QDebug&) {}
+};
+
+/**
+ * @brief Одна запись журнала, собираемая через QDebug
+ *
+ * Текст передаётся в Logger в деструкторе, то есть в конце выражения LOG_*() << ...;
+ */
+class LogRecord
+{
+public:
+    LogRecord(LogLevel level, LogCategory category);
+    ~LogRecord();
+
+    /**
+     * @brief Поток для записи текста (без кавычек вокруг строк)
+     */
+    QDebug stream();
+
+private:
+    LogLevel level_;
+    LogCategory category_;
+    QString text_;
+};
+
+/**
+ * @brief Журнал: кольцевой буфер и фоновый поток вывода
+ */
+class Logger
+{
+public:
+    /**
+     * @brief Получить журнал (поток вывода стартует при первом обращении)
+     */
+    static Logger& instance();
+
+    /**
+     * @brief Положить запись в буфер, не блокируясь
+     * @return false если буфер полон и запись отброшена
+     */
+    bool push(LogLevel level, LogCategory category, QString text);
+
+    /**
+     * @brief Забрать новые строки для окна сервера
+     * @param maxLines Не больше стольких строк за вызов
+     * @param skipped Сколько более старых строк пропущено
+     * @return Строки в порядке записи
+     */
+    QStringList takeTail(int maxLines, int& skipped);
+
+    /**
+     * @brief Вывести всё накопленное и остановить поток вывода
+     */
+    void stop();
+
+    /**
+     * @brief Получить имя уровня
+     */
+    static const char* levelName(LogLevel level);
+
+    /**
+     * @brief Получить имя категории
+     */
+    static const char* categoryName(LogCategory category);
+
+private:
+    Logger();
+    ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /**
+     * @brief Запись в буфере
+     */
+    struct Record
+    {
+        qint64 time;
+        LogLevel level;
+        LogCategory category;
+        QString text;
+    };
+
+    /**
+     * @brief Ячейка кольцевого буфера с номером последовательности
+     */
+    struct Slot
+    {
+        std::atomic<size_t> seq;
+        Record record;
+    };
+
+    /**
+     * @brief Достать запись (вызывается только потоком вывода)
+     */
+    bool pop(Record& record);
+
+    /**
+     * @brief Проверить, есть ли запись для вывода (вызывается только потоком вывода)
+     */
+    bool hasRecord() const;
+
+    /**
+     * @brief Разбудить поток вывода, если он ждёт записей
+     */
+    void wakeWriter();
+
+    /**
+     * @brief Цикл потока вывода
+     */
+    void run();
+
+    /**
+     * @brief Вывести запись
+     */
+    void write(const Record& record);
+
+private:
+    std::vector<Slot> ring_;                ///< Кольцевой буфер
+    std::atomic<size_t> enqueuePos_;        ///< Позиция записи
+    size_t dequeuePos_;                     ///< Позиция чтения (только поток вывода)
+    std::atomic<quint64> dropped_;          ///< Отброшено при переполнении
+    std::atomic<bool> running_;             ///< Поток вывода работает
+    std::thread writer_;                    ///< Поток вывода
+
+    QMutex wakeMutex_;                      ///< Мьютекс ожидания потока вывода
+    QWaitCondition wakeCondition_;          ///< Поток вывода ждёт здесь, пока буфер пуст
+    std::atomic<bool> sleeping_;            ///< Поток вывода ждёт или собирается ждать
+
+    QMutex tailMutex_;                      ///< Защищает tail_ и tailSkipped_
+    QStringList tail_;                      ///< Ещё не показанные в окне строки
+    int tailSkipped_;                       ///< Вытеснено из tail_ до показа
+};
+
+#endif // LOGGER_H
@@ -7,7 +7,7 @@ int main(int argc, char *argv[])
 {
     QApplication server(argc, argv);
 
-    MainWindow window(50000);
+    MainWindow window(SERVER_PORT_DEFAULT);
 //    DBWindow dbWindow;
 
 //    dbWindow.show();
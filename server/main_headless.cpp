@@ -0,0 +1,88 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSocketNotifier>
+#include <csignal>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "server.hpp"
+
+static int terminateFds[2] = { -1, -1 };    ///< Пара сокетов: обработчик сигнала пишет в [1], цикл событий читает [0]
+
+/**
+ * @brief Обработчик SIGINT/SIGTERM
+ *
+ * В обработчике сигнала можно вызывать только async-signal-safe функции,
+ * поэтому он лишь пишет байт в сокет; quit() вызывает цикл событий.
+ */
+static void onTerminate(int)
+{
+    char signal = 1;
+    ssize_t written = ::write(terminateFds[1], &signal, sizeof(signal));
+    (void)written;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("server-headless");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Network battleship server without GUI");
+    parser.addHelpOption();
+
+    QCommandLineOption portOption({"p", "port"}, "Port to listen on.", "port", QString::number(SERVER_PORT_DEFAULT));
+    QCommandLineOption dbOption({"d", "db"}, "Path to the SQLite database.", "path", SERVER_DB_PATH_DEFAULT);
+    QCommandLineOption corpusOption({"c", "corpus"}, "Path to the binary placement corpus.", "path", SERVER_CORPUS_PATH_DEFAULT);
+    QCommandLineOption threadsOption({"t", "threads"}, "Number of I/O threads (0 - one per core).", "count", QString::number(SERVER_IO_THREADS_DEFAULT));
+    parser.addOption(portOption);
+    parser.addOption(dbOption);
+    parser.addOption(corpusOption);
+    parser.addOption(threadsOption);
+
+    parser.process(app);
+
+    bool portOk = false, threadsOk = false;
+    uint port = parser.value(portOption).toUInt(&portOk);
+    int threads = parser.value(threadsOption).toInt(&threadsOk);
+
+    if (!portOk || port == 0 || port > 65535 || !threadsOk || threads < 0)
+    {
+        qCritical() << "Wrong --port or --threads value";
+        return 1;
+    }
+
+    Server server(port, threads, parser.value(dbOption), parser.value(corpusOption));
+
+    if (!server.startServer())
+        return 1;
+
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, terminateFds) != 0)
+    {
+        qCritical() << "Cannot create the signal socket pair";
+        return 1;
+    }
+
+    QSocketNotifier terminateNotifier(terminateFds[0], QSocketNotifier::Read);
+    QObject::connect(&terminateNotifier, &QSocketNotifier::activated, &app, [&terminateNotifier]()
+    {
+        terminateNotifier.setEnabled(false);
+
+        char signal = 0;
+        ssize_t nRead = ::read(terminateFds[0], &signal, sizeof(signal));
+        (void)nRead;
+
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = onTerminate;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+
+    sigaction(SIGINT , &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, &server, &Server::stopServer);
+
+    return app.exec();
+}
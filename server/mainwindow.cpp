@@ -2,6 +2,7 @@
 #include "ui_mainwindow.h"
 #include <QCloseEvent>
 #include <QMessageBox>
+#include "logger.hpp"
 
 MainWindow::MainWindow(quint16 port, QWidget *parent) :
     QMainWindow(parent),
@@ -10,6 +11,7 @@ MainWindow::MainWindow(quint16 port, QWidget *parent) :
 {
     ui->setupUi(this);
     startTimer(500);
+
 //    qInstallMessageHandler([](QtMsgType type, const QMessageLogContext& context, const QString& msg) {qDebug(msg.toUtf8()); this->ui->textBrowser->append(msg); });
 }
 
@@ -21,7 +23,16 @@ MainWindow::~MainWindow()
 
 void MainWindow::on_startButton_clicked()
 {
-    server_.startServer(ui->textBrowser);
+    if (!server_.startServer())
+    {
+        QMessageBox::warning(this, "ERROR!", "Cannot start server on port " + QString::number(server_.getPort()) + "... Try again!");
+        return;
+    }
+
+    ui->textBrowser->setStyleSheet("background-color: rgb(255, 255, 255, 5);"\
+                                   "background-image: url(:/images/images/background.jpg);"\
+                                   "color: rgb(255, 255, 177);");
+
     ui->startButton->setDisabled(true);
 }
 
@@ -42,6 +53,15 @@ void MainWindow::timerEvent(QTimerEvent *event)
 {
     ui->statusbar->showMessage("SERVER " + getServerStateStr());
 
+    // журнал показывается порциями по таймеру, а не виджетом на каждую запись
+    int skipped = 0;
+    QStringList lines = Logger::instance().takeTail(LOG_VIEW_LINES_PER_TICK, skipped);
+
+    if (skipped)
+        ui->textBrowser->append("... " + QString::number(skipped) + " lines skipped");
+    if (!lines.isEmpty())
+        ui->textBrowser->append(lines.join('\n'));
+
     event->accept();
 }
 
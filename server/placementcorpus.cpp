@@ -0,0 +1,152 @@
+#include "placementcorpus.hpp"
+#include "field.hpp"
+#include "logger.hpp"
+#include <QtEndian>
+#include <cstring>
+
+PlacementCorpus::PlacementCorpus() :
+    boards_(nullptr),
+    nBoards_(0),
+    boardSize_(0),
+    nTransforms_(0)
+{
+    const BoardGeometry& geometry = Field::GEOMETRY;
+    int width = geometry.width_;
+    int height = geometry.height_;
+
+    // сначала 4 преобразования, сохраняющие размеры поля, затем 4 с обменом осей (только квадрат)
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int xr = width - 1 - x;
+            int yr = height - 1 - y;
+
+            transforms_[0][geometry.index(x , y )] = (quint8)geometry.index(x , y );  // без изменений
+            transforms_[1][geometry.index(x , y )] = (quint8)geometry.index(xr, yr);  // поворот на 180
+            transforms_[2][geometry.index(x , y )] = (quint8)geometry.index(xr, y );  // отражение слева направо
+            transforms_[3][geometry.index(x , y )] = (quint8)geometry.index(x , yr);  // отражение сверху вниз
+
+            if (width != height)
+                continue;
+
+            transforms_[4][geometry.index(x , y )] = (quint8)geometry.index(y , x );  // транспонирование
+            transforms_[5][geometry.index(x , y )] = (quint8)geometry.index(yr, x );  // поворот на 90
+            transforms_[6][geometry.index(x , y )] = (quint8)geometry.index(y , xr);  // поворот на 270
+            transforms_[7][geometry.index(x , y )] = (quint8)geometry.index(yr, xr);  // отражение по побочной диагонали
+        }
+    }
+}
+
+PlacementCorpus::~PlacementCorpus()
+{
+    close();
+}
+
+bool PlacementCorpus::open(const QString& path)
+{
+    close();
+
+    file_.setFileName(path);
+    if (!file_.open(QIODevice::ReadOnly))
+        return false;
+
+    const uchar* data = file_.map(0, file_.size());
+    if (!data || file_.size() < PLACEMENT_CORPUS_HEADER_SIZE)
+    {
+        LOG_WARNING(LOG_CAT_DB) << "Placement corpus" << path << "cannot be mapped";
+        close();
+        return false;
+    }
+
+    // magic[4] version(u16) width(u8) height(u8) boardSize(u16) reserved(u16) count(u32)
+    quint16 version = qFromLittleEndian<quint16>(data + 4);
+    int width       = data[6];
+    int height      = data[7];
+    int boardSize   = qFromLittleEndian<quint16>(data + 8);
+    quint64 count   = qFromLittleEndian<quint32>(data + 12);
+
+    const BoardGeometry& geometry = Field::GEOMETRY;
+
+    if (std::memcmp(data, PLACEMENT_CORPUS_MAGIC, 4) != 0 || version != PLACEMENT_CORPUS_VERSION ||
+        width != geometry.width_ || height != geometry.height_ || boardSize != (width * height + 7) / 8 ||
+        (quint64)file_.size() != PLACEMENT_CORPUS_HEADER_SIZE + count * boardSize)
+    {
+        LOG_WARNING(LOG_CAT_DB) << "Placement corpus" << path << "has a wrong header or size";
+        close();
+        return false;
+    }
+
+    // записи уходят клиентам как есть, поэтому каждая проверяется один раз при открытии
+    for (quint64 i = 0; i < count; i++)
+    {
+        Bitboard cells = Bitboard::fromBytes(data + PLACEMENT_CORPUS_HEADER_SIZE + i * boardSize, boardSize);
+
+        ClassicBoard board;
+        board.setShips(cells);
+
+        if ((cells & ~geometry.board_).any() || !board.isCorrect())
+        {
+            LOG_WARNING(LOG_CAT_DB) << "Placement corpus" << path << "has an incorrect board" << i;
+            close();
+            return false;
+        }
+    }
+
+    boards_      = data + PLACEMENT_CORPUS_HEADER_SIZE;
+    nBoards_     = count;
+    boardSize_   = boardSize;
+    nTransforms_ = width == height ? PLACEMENT_CORPUS_TRANSFORMS : PLACEMENT_CORPUS_TRANSFORMS / 2;
+
+    LOG_INFO(LOG_CAT_DB) << "Placement corpus" << path << ":" << nBoards_ << "boards," << size() << "layouts";
+    return true;
+}
+
+void PlacementCorpus::close()
+{
+    if (boards_)
+        file_.unmap(const_cast<uchar*>(boards_ - PLACEMENT_CORPUS_HEADER_SIZE));
+
+    file_.close();
+
+    boards_ = nullptr;
+    nBoards_ = 0;
+    boardSize_ = 0;
+    nTransforms_ = 0;
+}
+
+bool PlacementCorpus::isOpen() const
+{
+    return boards_ != nullptr;
+}
+
+quint64 PlacementCorpus::size() const
+{
+    return nBoards_ * nTransforms_;
+}
+
+Bitboard PlacementCorpus::at(quint64 index) const
+{
+    if (index >= size())
+        return Bitboard();
+
+    const uchar* board = boards_ + (index / nTransforms_) * boardSize_;
+    const std::array<quint8, Bitboard::BITS>& transform = transforms_[index % nTransforms_];
+
+    // запись - биты клеток подряд, как маски Bitboard; биты дополнения до байта не выдаются
+    Bitboard cells = Bitboard::fromBytes(board, boardSize_) & Field::GEOMETRY.board_;
+
+    if (index % nTransforms_ == 0)
+        return cells;
+
+    // перестановка битов: проходим только занятые клетки (20 у стандартного флота)
+    Bitboard result;
+    while (cells.any())
+    {
+        int cell = cells.first();
+        cells.reset(cell);
+        result.set(transform[cell]);
+    }
+
+    return result;
+}
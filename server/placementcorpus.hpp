@@ -0,0 +1,94 @@
+/**
+ * @file placementcorpus.hpp
+ * @brief Двоичный набор готовых расстановок, отображённый в память
+ *
+ * Файл - заголовок и расстановки по биту на клетку (13 байт на поле 10x10),
+ * собирается скриптом placements/pack_corpus.py. При старте файл отображается
+ * в память целиком, в БД ничего не пишется. Хранятся только исходные поля:
+ * 8 поворотов и отражений квадрата (4 для прямоугольного поля) сервер
+ * получает перестановкой битов при выдаче, поэтому одна запись даёт
+ * 8 расстановок.
+ *
+ * Формат (little-endian), версия PLACEMENT_CORPUS_VERSION:
+ * - заголовок 16 байт: magic "SBPC", version u16, width u8, height u8,
+ *   boardSize u16 = ceil(width*height/8), reserved u16 = 0, count u32;
+ * - count записей по boardSize байт: клетка y*width + x - бит (i % 8) байта i / 8.
+ *
+ * Файл в репозиторий не входит. Изменение формата меняет версию здесь и
+ * в pack_corpus.py: файл другой версии не открывается.
+ */
+
+#ifndef PLACEMENTCORPUS_H
+#define PLACEMENTCORPUS_H
+
+#include <QFile>
+#include <QString>
+#include <array>
+#include "bitboard.hpp"
+#include "config.hpp"
+
+#define PLACEMENT_CORPUS_MAGIC          "SBPC"  ///< Первые 4 байта файла
+#define PLACEMENT_CORPUS_VERSION        1       ///< Версия формата
+#define PLACEMENT_CORPUS_HEADER_SIZE    16      ///< Размер заголовка
+#define PLACEMENT_CORPUS_TRANSFORMS     8       ///< Повороты и отражения квадрата
+
+/**
+ * @brief Класс набора расстановок
+ */
+class PlacementCorpus
+{
+public:
+    /**
+     * @brief Конструктор
+     */
+    PlacementCorpus();
+
+    /**
+     * @brief Деструктор
+     */
+    ~PlacementCorpus();
+
+    PlacementCorpus(const PlacementCorpus&) = delete;
+    PlacementCorpus& operator=(const PlacementCorpus&) = delete;
+
+    /**
+     * @brief Отобразить файл набора в память
+     * @param path Путь к файлу
+     * @return false если файла нет, заголовок не подходит к полю сервера или
+     *         хотя бы одна запись не является корректной расстановкой
+     */
+    bool open(const QString& path);
+
+    /**
+     * @brief Снять отображение файла
+     */
+    void close();
+
+    /**
+     * @brief Проверить, открыт ли набор
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief Получить количество расстановок с учётом поворотов и отражений
+     */
+    quint64 size() const;
+
+    /**
+     * @brief Получить расстановку
+     * @param index Номер от 0 до size() - 1: запись index / nTransforms_, преобразование index % nTransforms_
+     * @return Клетки кораблей
+     */
+    Bitboard at(quint64 index) const;
+
+private:
+    QFile file_;                ///< Файл набора
+    const uchar* boards_;       ///< Начало записей в отображённой памяти
+    quint64 nBoards_;           ///< Записей в файле
+    int boardSize_;             ///< Байт на запись
+    int nTransforms_;           ///< Преобразований поля: 8 для квадрата, 4 иначе
+
+    std::array<std::array<quint8, Bitboard::BITS>, PLACEMENT_CORPUS_TRANSFORMS> transforms_;  ///< Куда переходит клетка i при преобразовании
+};
+
+#endif // PLACEMENTCORPUS_H
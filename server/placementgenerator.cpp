@@ -0,0 +1,129 @@
+#include "placementgenerator.hpp"
+#include "field.hpp"
+#include "protocol.hpp"
+
+PlacementGenerator::PlacementGenerator(quint64 seed) :
+    fleet_(Rules::ClassicFleet::LENGTHS.begin(), Rules::ClassicFleet::LENGTHS.end())
+{
+    // splitmix64 раскладывает одно число в четыре слова состояния, нулевым состояние не бывает
+    for (quint64& word : state_)
+    {
+        seed += 0x9E3779B97F4A7C15ull;
+        quint64 z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        word = z ^ (z >> 31);
+    }
+
+    const BoardGeometry& geometry = Field::GEOMETRY;
+
+    for (int length = 1; length <= Rules::SHIP_LENGTH_MAX; length++)
+    {
+        for (int y = 0; y < geometry.height_; y++)
+        {
+            for (int x = 0; x < geometry.width_; x++)
+            {
+                Bitboard horizontal;
+                Bitboard vertical;
+
+                for (int i = 0; i < length; i++)
+                {
+                    if (x + i < geometry.width_)
+                        horizontal.set(geometry.index(x + i, y));
+                    if (y + i < geometry.height_)
+                        vertical.set(geometry.index(x, y + i));
+                }
+
+                if (horizontal.count() == length)
+                    positions_[length].append(Position{ horizontal, geometry.dilate8(horizontal) });
+
+                if (length > 1 && vertical.count() == length)   // однопалубный корабль уже поставлен
+                    positions_[length].append(Position{ vertical, geometry.dilate8(vertical) });
+            }
+        }
+    }
+}
+
+quint64 PlacementGenerator::next()
+{
+    auto rotl = [](quint64 value, int n) { return (value << n) | (value >> (64 - n)); };
+
+    quint64 result = rotl(state_[1] * 5, 7) * 9;
+    quint64 t = state_[1] << 17;
+
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+
+    return result;
+}
+
+int PlacementGenerator::nextIndex(int n)
+{
+    // умножение вместо деления; смещение порядка n / 2^32 для нескольких сотен позиций незаметно
+    return (int)(((next() >> 32) * (quint64)n) >> 32);
+}
+
+quint64 PlacementGenerator::nextBelow(quint64 n)
+{
+    return next() % n;
+}
+
+Bitboard PlacementGenerator::generate()
+{
+    for (;;)
+    {
+        Bitboard ships;
+        Bitboard blocked;   // корабли с ореолом: сюда следующий корабль ставить нельзя
+        bool placed = true;
+
+        for (int length : std::as_const(fleet_))
+        {
+            const QVector<Position>& positions = positions_[length];
+            const Position& position = positions[nextIndex(positions.size())];
+
+            if ((position.cells_ & blocked).any())
+            {
+                placed = false;
+                break;
+            }
+
+            ships   |= position.cells_;
+            blocked |= position.area_;
+        }
+
+        if (placed)
+            return ships;
+    }
+}
+
+QString PlacementGenerator::encodeFieldText(const Bitboard& ships)
+{
+    // клетка i - бит i, как в Protocol::packFieldBits: байты масок little-endian подряд
+    char packed[PROTOCOL_FIELD_BITS_SIZE] = {};
+
+    for (int i = 0; i < PROTOCOL_FIELD_BITS_SIZE; i++)
+        packed[i] = (char)ships.byte(i);
+
+    return Protocol::encodePackedText(QByteArrayView(packed, sizeof(packed)));
+}
+
+PlacementWorker::PlacementWorker(quint64 seed) :
+    generator_(seed)
+{
+
+}
+
+void PlacementWorker::generate(int count)
+{
+    QStringList fields;
+    fields.reserve(count);
+
+    for (int i = 0; i < count; i++)
+        fields.append(PlacementGenerator::encodeFieldText(generator_.generate()));
+
+    emit generated(fields);
+}
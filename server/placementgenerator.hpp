@@ -0,0 +1,112 @@
+/**
+ * @file placementgenerator.hpp
+ * @brief Генератор случайных расстановок флота
+ *
+ * Каждый корабль флота ставится в случайную позицию из всех позиций своей
+ * длины. Клетки и ореол позиции - готовые маски Bitboard. Если корабль задел
+ * уже поставленные, расстановка начинается заново. Наборы позиций
+ * равновероятны, и одинаковые корабли лишь переставляются между собой, поэтому
+ * равновероятны и все корректные расстановки. Попытка - несколько AND над
+ * масками, без обращения к БД.
+ *
+ * PlacementWorker держит генератор в отдельном потоке и отдаёт серверу
+ * готовые расстановки пачками, поток сервера на генерацию не тратится.
+ */
+
+#ifndef PLACEMENTGENERATOR_H
+#define PLACEMENTGENERATOR_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <array>
+#include "bitboard.hpp"
+#include "config.hpp"
+
+/**
+ * @brief Класс генератора расстановок
+ */
+class PlacementGenerator
+{
+public:
+    /**
+     * @brief Конструктор
+     * @param seed Начальное значение генератора случайных чисел
+     */
+    explicit PlacementGenerator(quint64 seed);
+
+    /**
+     * @brief Сгенерировать корректную расстановку флота Rules::ClassicFleet
+     * @return Клетки кораблей
+     */
+    Bitboard generate();
+
+    /**
+     * @brief Записать расстановку для протокола и БД (Protocol::encodeFieldText)
+     * @param ships Клетки кораблей
+     */
+    static QString encodeFieldText(const Bitboard& ships);
+
+    /**
+     * @brief Случайное число от 0 до n - 1 (n > 0)
+     */
+    quint64 nextBelow(quint64 n);
+
+private:
+    /**
+     * @brief Позиция корабля
+     */
+    struct Position
+    {
+        Bitboard cells_;    ///< Клетки корабля
+        Bitboard area_;     ///< Клетки корабля вместе с ореолом
+    };
+
+    /**
+     * @brief Следующее случайное число (xoshiro256**)
+     */
+    quint64 next();
+
+    /**
+     * @brief Случайный номер от 0 до n - 1
+     */
+    int nextIndex(int n);
+
+    std::array<quint64, 4> state_;                              ///< Состояние xoshiro256**
+    QVector<Position> positions_[Rules::SHIP_LENGTH_MAX + 1];    ///< Все позиции корабля по длине
+    QVector<int> fleet_;                                        ///< Длины кораблей флота
+};
+
+/**
+ * @brief Генератор расстановок в отдельном потоке
+ */
+class PlacementWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Конструктор
+     * @param seed Начальное значение генератора случайных чисел
+     */
+    explicit PlacementWorker(quint64 seed);
+
+public slots:
+    /**
+     * @brief Сгенерировать расстановки
+     * @param count Сколько расстановок нужно
+     */
+    void generate(int count);
+
+signals:
+    /**
+     * @brief Расстановки готовы
+     * @param fields Упакованные расстановки (Protocol::encodeFieldText)
+     */
+    void generated(const QStringList& fields);
+
+private:
+    PlacementGenerator generator_;  ///< Генератор потока
+};
+
+#endif // PLACEMENTGENERATOR_H
@@ -3,22 +3,56 @@
 #include "field.hpp"
 #include <QString>
 #include <QStringList>
-#include <QMessageBox>
 #include <QFile>
 #include <QTextStream>
+#include <QElapsedTimer>
+#include <QTimerEvent>
+#include <QThread>
+#include <QRandomGenerator>
+#include "logger.hpp"
 
 
 //static int NUM_IND = 0;
-#define PRINT(msg) { qDebug() << msg; browser->append(msg); }
-
-Server::Server(quint16 port) :
-    port_(port)
+#define PRINT(msg) { LOG_INFO(LOG_CAT_SERVER) << msg; }
+
+Server::Server(quint16 port, int ioThreads, const QString& dbPath, const QString& corpusPath) :
+    port_(port),
+    ioThreads_(ioThreads),
+    dbPath_(dbPath),
+    corpusPath_(corpusPath),
+    nextClientId_(1),
+    nextWorker_(0),
+    placementThread_(nullptr),
+    placementWorker_(nullptr),
+    placementGenerator_(QRandomGenerator::system()->generate64()),
+    placementRequested_(false),
+    shipsRandom_(QRandomGenerator::system()->generate64()),
+    flushScheduled_(false),
+    presenceSeq_(0),
+    state_(ST_NSTARTED),
+    timerId_(0),
+    heartbeatWheel_(HEARTBEAT_WHEEL_SLOTS, HEARTBEAT_TICK_MS)
 {
 
 }
 
 Server::Server(const Server& other) :
-    port_(other.port_)
+    port_(other.port_),
+    ioThreads_(other.ioThreads_),
+    dbPath_(other.dbPath_),
+    corpusPath_(other.corpusPath_),
+    nextClientId_(1),
+    nextWorker_(0),
+    placementThread_(nullptr),
+    placementWorker_(nullptr),
+    placementGenerator_(QRandomGenerator::system()->generate64()),
+    placementRequested_(false),
+    shipsRandom_(QRandomGenerator::system()->generate64()),
+    flushScheduled_(false),
+    presenceSeq_(0),
+    state_(ST_NSTARTED),
+    timerId_(0),
+    heartbeatWheel_(HEARTBEAT_WHEEL_SLOTS, HEARTBEAT_TICK_MS)
 {
 
 }
@@ -29,6 +63,9 @@ Server& Server::operator=(const Server& other)
         return *this;
 
     port_ = other.port_;
+    ioThreads_ = other.ioThreads_;
+    dbPath_ = other.dbPath_;
+    corpusPath_ = other.corpusPath_;
     updateState(ST_NSTARTED);
 
     return *this;
@@ -36,51 +73,69 @@ Server& Server::operator=(const Server& other)
 
 Server::~Server()
 {
-
+    stopWorkers();
 }
 
-#define DB_PATH "data.db"
-
-void Server::startServer(QTextBrowser* textBrowser)
+bool Server::startServer()
 {
+    clock_.start();
+
     if (!this->listen(QHostAddress::Any, port_))
     {
-        qDebug() << "Not listening";
-        QMessageBox::warning(textBrowser, "ERROR!", "Cannot start server on port " + QString::number(port_) + "... Try again!");
-        return;
+        PRINT("Cannot start server on port " + QString::number(port_))
+        return false;
     }
 
-    dbController_.connectDatabase(DB_PATH);
+    dbController_.connectDatabase(dbPath_);
     dbController_.printTable("Fields");
     dbController_.printTable("GamesEndings");
 
-    browser = textBrowser;
-//    qInstallMessageHandler([this](QtMsgType type, const QMessageLogContext& context, const QString& msg) {qDebug(msg.toUtf8()); browser->append(msg); });
+    // набор подключается явно (--corpus): генератор даёт любое число расстановок, набор - только свои
+    if (corpusPath_.isEmpty())
+        PRINT("No placement corpus given, placements will be generated")
+    else if (!corpus_.open(corpusPath_))
+        PRINT("No valid placement corpus at " + corpusPath_ + ", placements will be generated")
 
-    PRINT("Listening")
-    updateState(ST_STARTED);
+    startWorkers();
 
-    textBrowser->setStyleSheet("background-color: rgb(255, 255, 255, 5);"\
-                               "background-image: url(:/images/images/background.jpg);"\
-                               "color: rgb(255, 255, 177);");
+    PRINT("Listening on port " + QString::number(port_))
+    updateState(ST_STARTED);
 
-    timerId_ = startTimer(DEFAULT_SEARCH_INTERVAL);
+    timerId_ = startTimer(heartbeatWheel_.getTickMs());
 
     dbController_.createTable("Fields", "field_text TEXT");
     dbController_.createTable("GamesEndings", "player1 TEXT, player2 TEXT, field_text1 TEXT, field_text2 TEXT, start_date DATE, end_date DATE, winner TEXT");
+    dbController_.createIndex("GamesEndings_end_date", "GamesEndings", "end_date");    // для HISTORY:PAGE
+
+    return true;
 }
 
 void Server::stopServer()
 {
+    if (state_ != ST_STARTED)   // уже остановлен (окно и aboutToQuit могут вызвать дважды)
+        return;
+
+    close();    // новые подключения больше не принимаются
     killTimer(timerId_);
 
     sendMessageToAll("STOP:");
     PRINT("server: STOP: to all clients")
     updateState(ST_STOPPED);
 
-    // TODO: finish the function
+    flushOutbox();
+    stopWorkers();
+
+    printCommandStats();
+
+    // сокеты закрыты потоками ввода-вывода, клиенты и игры больше не нужны
+    games_.clear();
+    logins_.clear();
+    sessions_.clear();
+    congested_.clear();
+    clients_.clear();
 
     dbController_.disconnectDatabase();
+    corpus_.close();
 }
 
 void Server::updateState(ServerState state)
@@ -93,688 +148,1076 @@ Server::ServerState Server::getServerState()
     return state_;
 }
 
+quint16 Server::getPort() const
+{
+    return port_;
+}
+
+void Server::startWorkers()
+{
+    int nThreads = ioThreads_ > 0 ? ioThreads_ : QThread::idealThreadCount();
+
+    qRegisterMetaType<FrameSpan>();
+    qRegisterMetaType<QList<FrameSpan>>();  // framesReceived идёт из потока ввода-вывода через очередь
+
+    for (int i = 0; i < nThreads; i++)
+    {
+        QThread* thread = new QThread(this);
+        IOWorker* worker = new IOWorker(i);
+        worker->moveToThread(thread);
+
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+        connect(worker, &IOWorker::framesReceived    , this, &Server::on_framesReceived    );
+        connect(worker, &IOWorker::clientDisconnected, this, &Server::on_clientDisconnected);
+        connect(worker, &IOWorker::clientError       , this, &Server::on_clientError       );
+        connect(worker, &IOWorker::clientCongested   , this, &Server::on_clientCongested   );
+
+        thread->start();
+
+        threads_.append(thread);
+        workers_.append(worker);
+    }
+
+    PRINT("I/O threads: " + QString::number(nThreads))
+
+    placementThread_ = new QThread(this);
+    placementWorker_ = new PlacementWorker(QRandomGenerator::system()->generate64());
+    placementWorker_->moveToThread(placementThread_);
+
+    connect(placementThread_, &QThread::finished, placementWorker_, &QObject::deleteLater);
+    connect(placementWorker_, &PlacementWorker::generated, this, &Server::on_placementsGenerated);
+
+    placementThread_->start();
+    requestPlacements();
+}
+
+void Server::requestPlacements()
+{
+    if (!placementWorker_ || corpus_.isOpen() || placementRequested_ || placementPool_.size() > PLACEMENT_POOL_SIZE / 2)
+        return;
+
+    placementRequested_ = true;
+
+    PlacementWorker* worker = placementWorker_;
+    int count = PLACEMENT_POOL_SIZE - placementPool_.size();
+    QMetaObject::invokeMethod(worker, [worker, count]() { worker->generate(count); }, Qt::QueuedConnection);
+}
+
+void Server::on_placementsGenerated(const QStringList& fields)
+{
+    placementRequested_ = false;
+    placementPool_.append(fields);
+}
+
+void Server::stopWorkers()
+{
+    for (IOWorker* worker : std::as_const(workers_))
+    {
+        // отправленное ранее (STOP:) уже стоит в очереди потока перед закрытием
+        QMetaObject::invokeMethod(worker, &IOWorker::closeAll, Qt::BlockingQueuedConnection);
+    }
+
+    for (QThread* thread : std::as_const(threads_))
+    {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+
+    threads_.clear();
+    workers_.clear();
+
+    if (placementThread_)
+    {
+        placementThread_->quit();
+        placementThread_->wait();
+        delete placementThread_;
+    }
+
+    placementThread_ = nullptr;
+    placementWorker_ = nullptr;
+    placementRequested_ = false;
+}
+
 void Server::incomingConnection(qintptr socketDescriptor)
 {
+    if (workers_.isEmpty())
+        return;
+
+    IOWorker* worker = workers_[nextWorker_];
+    nextWorker_ = (nextWorker_ + 1) % workers_.size();
+
+    int clientId = nextClientId_++;
+
     Client client;
-//    client.socket_ = this->nextPendingConnection();
-    client.socket_ = new QTcpSocket(this);
-    client.socket_->setSocketDescriptor(socketDescriptor);
+    client.worker_ = worker;
+    client.id_ = clientId;
     client.status_ = Client::ST_CONNECTED;
     client.readiness_ = Client::ST_NREADY;
-//    client.playingWith = clients_.end();
-    int clientId = client.socket_->socketDescriptor();
+    client.lastSeen_ = clock_.elapsed();
+
+    sessions_.insert(clientId, clients_.insert(clientId, client));
+    heartbeatWheel_.schedule(clientId, HEARTBEAT_IDLE_MS);
+
+    QMetaObject::invokeMethod(worker, [worker, clientId, socketDescriptor]() { worker->addConnection(clientId, socketDescriptor); }, Qt::QueuedConnection);
+}
+
+ClientsIterator Server::findClient(const QString& login)
+{
+    return logins_.value(login, clients_.end());
+}
+
+ClientsIterator Server::findClient(int clientId)
+{
+    return sessions_.value(clientId, clients_.end());
+}
+
+void Server::registerLogin(ClientsIterator cit, const QString& login)
+{
+    unregisterLogin(cit);   // повторный AUTH с другим логином
+
+    // ключ реестра и login_ клиента разделяют одну строку
+    auto lit = logins_.insert(login, cit);
+    cit->setLogin(lit.key());
+}
+
+void Server::unregisterLogin(ClientsIterator cit)
+{
+    auto lit = logins_.find(cit->login_);
+    if (lit != logins_.end() && lit.value() == cit)
+        logins_.erase(lit);
+}
+
+
+void Server::on_framesReceived(int clientId, bool binary, const QByteArray& batch, const QList<FrameSpan>& frames)
+{
+    // колесо не трогается: срок сессии пересчитается, когда до неё дойдёт тик
+    ClientsIterator cit = findClient(clientId);
+    if (cit != clients_.end())
+        cit->lastSeen_ = clock_.elapsed();
+
+    for (const FrameSpan& span : frames)
+    {
+        QByteArrayView frame = QByteArrayView(batch).sliced(span.offset_, span.size_);    // без копирования
 
-//    socket_ = new QTcpSocket(this);
-//    socket_->setSocketDescriptor(socketDescriptor);
+        if (binary)
+        {
+            handleBinaryData(frame, clientId);
+        }
+        else
+        {
+            LOG_DEBUG(LOG_CAT_PROTOCOL) << "client" + QString::number(clientId) + ": " + QString::fromUtf8(frame);
+            handleData(frame, clientId);
+        }
 
-    connect(client.socket_, SIGNAL(errorOccurred(QAbstractSocket::SocketError)), this, SLOT(on_sockError(QAbstractSocket::SocketError)));  // handles socket errors
-    connect(client.socket_, SIGNAL(connected())   , this, SLOT(on_sockConnect())   );  // when new socket connected, sockConnect slot runs
-    connect(client.socket_, SIGNAL(readyRead())   , this, SLOT(on_receiveData())     );  // when new network data comes, sockReady slot runs
-    connect(client.socket_, SIGNAL(disconnected()), this, SLOT(on_sockDisconnect()));  // when socket disconnected, sockDisconnect slot run
+        // обработчик мог удалить клиента (EXIT:)
+        if (!sessions_.contains(clientId))
+            break;
+    }
 
-    clients_.insert(clientId, client);
+    flushOutbox();  // всё, что накопилось за пачку кадров, уходит одной записью на клиента
+}
+
+void Server::sendMessageToAll(const QString& message, Traffic traffic)
+{
+    broadcast(message, [](const Client&) { return true; }, traffic);
 }
 
-ClientsIterator Server::findClient(QString& login)
+int Server::broadcast(const QString& message, const ClientFilter& filter, Traffic traffic)
 {
-    for (ClientsIterator cit = clients_.begin(); cit != clients_.end(); ++cit)
+    // кодируется один раз на версию протокола, всем получателям уходит один и тот же разделяемый буфер
+    QByteArray encoded[PROTOCOL_VERSION_BINARY + 1];
+    int nReceivers = 0;
+
+    for (const Client& client : std::as_const(clients_))
     {
-        if (cit->login_ == login)
-            return cit;
+        if (!filter(client))
+            continue;
+
+        QByteArray& bytes = encoded[client.protocolVersion_];
+        if (bytes.isNull())
+            bytes = Protocol::encodeText(message, client.protocolVersion_);
+
+        writeToClient(client, bytes, traffic);
+        nReceivers++;
     }
 
-    return clients_.end();
+    LOG_DEBUG(LOG_CAT_PROTOCOL) << "broadcast to" << nReceivers << "clients:" << message;
+
+    return nReceivers;
 }
 
+void Server::writeToClient(const Client& client, const QByteArray& data, Traffic traffic)
+{
+    if (dropIfCongested(client, traffic))
+        return;
+
+    PendingWrite& pending = outbox_[client.id_];
+    pending.worker_ = client.worker_;
+    pending.chunks_.append(data);   // без копирования: общий буфер рассылки просто разделяется
+
+    // ответы вне пачки кадров (таймер, отключение) уходят в конце текущего прохода цикла событий
+    if (!flushScheduled_)
+    {
+        flushScheduled_ = true;
+        QMetaObject::invokeMethod(this, &Server::flushOutbox, Qt::QueuedConnection);
+    }
+}
 
-void Server::on_receiveData()
+void Server::flushOutbox()
 {
-    socket_ = (QTcpSocket*)sender();
-    data_ = socket_->readAll();
+    flushScheduled_ = false;
 
-    QList<QByteArray> dataArr = data_.split('@');
-    for (int i = 0; i < dataArr.size()-1; i++)
+    for (auto it = outbox_.begin(); it != outbox_.end(); ++it)
     {
-        data_ = dataArr[i];
-        qDebug() << "DATA: " << data_;
-        PRINT("client" + QString::number(socket_->socketDescriptor()) + ": " + data_)
-        handleData(data_, socket_->socketDescriptor());
+        IOWorker* worker = it->worker_;
+        int clientId = it.key();
+        QByteArrayList chunks = std::move(it->chunks_);
+
+        // запись выполняет поток, владеющий сокетом; очередь сохраняет порядок сообщений
+        QMetaObject::invokeMethod(worker, [worker, clientId, chunks]() { worker->send(clientId, chunks); }, Qt::QueuedConnection);
     }
+
+    outbox_.clear();
+}
+
+void Server::sendToClient(const Client& client, const QString& message, Traffic traffic)
+{
+    if (dropIfCongested(client, traffic))   // проверка до кодирования
+        return;
+
+    writeToClient(client, Protocol::encodeText(message, client.protocolVersion_));
 }
 
-void Server::sendMessageToAll(const QString& message)
+bool Server::dropIfCongested(const Client& client, Traffic traffic)
 {
-    for (ClientsIterator receiver_it = clients_.begin(); receiver_it != clients_.end(); ++receiver_it)
+    if (traffic == TRAFFIC_CRITICAL)
+        return false;
+
+    auto congestedIt = congested_.find(client.id_);
+    if (congestedIt == congested_.end())
+        return false;
+
+    *congestedIt |= 1 << traffic;   // что именно отброшено - чтобы дослать актуальное при разгрузке
+    return true;
+}
+
+void Server::sendShotResult(const Client& client, ShotResult result, int x, int y)
+{
+    if (client.protocolVersion_ >= PROTOCOL_VERSION_BINARY)
     {
-        receiver_it->socket_->write((message+"@").toUtf8());
-//        receiver_it->socket_->flush();
-        PRINT(message + " to " + receiver_it->login_)
+        writeToClient(client, Protocol::encodeShotResult(result, x, y));
+        return;
     }
+
+    static const char* resultNames[] = { "DOT", "DAMAGED", "KILLED" };
+
+    sendToClient(client, "SHOT:" + QString(resultNames[result]) + ":" + QString::number(x) + ":" + QString::number(y));
 }
 
-static QString convertFieldToBin(const QString& fieldStr)
+void Server::sendFieldError(const Client& client)
 {
-    QString fieldStrBin = "";
+    // клиент возвращается к расстановке, до GAME:FIGHT игра не дойдёт без корректного поля
+    sendToClient(client, "ERROR:FIELD");
+}
 
-    for (QString::const_iterator it = fieldStr.begin(); it != fieldStr.end(); ++it)
+void Server::sendFieldDraw(const Client& client, FieldOwner owner, const Field& field)
+{
+    if (client.protocolVersion_ >= PROTOCOL_VERSION_BINARY)
     {
-        if (it->digitValue() == 0)
-            fieldStrBin += QString::number((int)CELL_EMPTY);
+        writeToClient(client, Protocol::encodeFieldUpdate(owner, field.getDrawView()));
+        return;
+    }
 
-        else if (it->digitValue() > 0 && it->digitValue() < 9)
-            fieldStrBin += QString::number((int)CELL_SHIP);
+    // клиент версии 1 знает только прежнюю запись из PROTOCOL_FIELD_AREA цифр
+    QString prefix = (owner == OWNER_MY) ? "FIELD:UPDATE:MY:" : "FIELD:UPDATE:ENEMY:";
+    sendToClient(client, prefix + field.getFieldDrawStr());
+}
 
-        else
-            qDebug() << "Wrong fieldStr!";
+void Server::sendFieldDiff(const Client& client, FieldOwner owner, const QVector<CellRange>& ranges, int area)
+{
+    if (client.protocolVersion_ >= PROTOCOL_VERSION_BINARY && area <= 256)
+    {
+        writeToClient(client, Protocol::encodeFieldDiff(owner, ranges));
+        return;
     }
 
-    return fieldStrBin;
+    QString prefix = (owner == OWNER_MY) ? "FIELD:DIFF:MY:" : "FIELD:DIFF:ENEMY:";
+    sendToClient(client, prefix + Protocol::encodeFieldDiffText(ranges));
 }
 
-void Server::handleData(const QByteArray& data, int clientId)
+const Server::CommandHandler Server::commandHandlers_[CMD_COUNT] =
+{
+    nullptr,                            // CMD_UNKNOWN
+    &Server::handleMessageRequest,      // CMD_MESSAGE
+    &Server::handleAuthRequest,         // CMD_AUTH
+    &Server::handleUsersRequest,        // CMD_USERS
+    &Server::handleUpdateRequest,       // CMD_UPDATE
+    &Server::handleReadinessRequest,    // CMD_READINESS
+    &Server::handleConnectionRequest,   // CMD_CONNECTION
+    &Server::handleGameRequest,         // CMD_GAME
+    &Server::handleHistoryRequest,      // CMD_HISTORY
+    &Server::handleGenerateRequest,     // CMD_GENERATE
+    &Server::handleExitRequest,         // CMD_EXIT
+    &Server::handlePongRequest,         // CMD_PONG
+};
+
+void Server::handleData(QByteArrayView data, int clientId)
 {
-    QString request = QString::fromUtf8(data).trimmed();
-//    PRINT("client: " + request)
+    ClientsIterator cit = findClient(clientId);
+    if (cit == clients_.end())
+        return;
+
+    QByteArrayView args;
+    Command command = parseCommand(data, args);
+
+    CommandStats& stats = commandStats_[command];
+    stats.count++;
+    stats.bytes += data.size();
+
+    if (command == CMD_UNKNOWN)
+    {
+        PRINT("Unknown request")
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    (this->*commandHandlers_[command])(args, cit);
+
+    stats.nsecs += timer.nsecsElapsed();
+}
 
-    ClientsIterator cit = clients_.find(clientId);
+void Server::handleMessageRequest(QByteArrayView args, ClientsIterator cit)    // MESSAGE:<receiver_login>:<message>
+{
     QString sender_login = cit->getLogin();
+    QString receiver_login = QString::fromUtf8(nextField(args));
+    QString message = QString::fromUtf8(args);
+
+    PRINT("sender: " + sender_login + ", receiver:" + receiver_login)
+
+    ClientsIterator receiver_it = findClient(receiver_login);
 
-    if (request.startsWith("MESSAGE:"))
+    if (receiver_login == "all")
     {
-        QStringList message_request = request.split(":");
-        QString receiver_login = message_request[1];
-        QString message = message_request[2];
+        sendMessageToAll("MESSAGE:all:" + sender_login + ":" + message, TRAFFIC_CHAT);
+    }
 
-        PRINT("sender: " + sender_login + ", receiver:" + receiver_login)
+    else if (receiver_it != clients_.end())
+    {
+        QString message_answer = "MESSAGE:" + sender_login + ":" + message;
+        sendToClient(*receiver_it, message_answer, TRAFFIC_CHAT);
 
-//        if (request.startsWith("SHOT:"))
-//        {
-//            cit->socket_->write(((QString)"DOT").toUtf8());
-//            cit->socket_->write(((QString)"DAMAGE").toUtf8());
-//            cit->socket_->write(((QString)"KILL").toUtf8());
+        PRINT(message_answer)
+    }
 
-//        }
+    else
+    {
+        // TODO: add error answer to the client
+        PRINT("No such user")
+    }
+}
 
-        if (receiver_login == "all")
+void Server::handleAuthRequest(QByteArrayView args, ClientsIterator cit)    // AUTH:<login>[:V2]
+{
+    QString login = QString::fromUtf8(nextField(args));
+    bool wantsBinary = fieldEquals(nextField(args), PROTOCOL_V2_TOKEN);
+
+    if (checkLogin(login))   // check if login valid
+    {
+        // повторный AUTH с другим логином: подписчики убирают прежний логин до появления нового
+        if (cit->isAuthorized())
+            publishPresence(PRESENCE_REMOVE, *cit);
+
+        registerLogin(cit, login);  // прежняя запись logins_ снимается здесь же, до ADD
+
+        if (wantsBinary)
         {
-            sendMessageToAll("MESSAGE:all:" + sender_login + ":" + message);
+            // декодер переключается раньше, чем клиент получит ответ и начнёт слать двоичные кадры
+            IOWorker* worker = cit->worker_;
+            int clientId = cit->id_;
+            QMetaObject::invokeMethod(worker, [worker, clientId]() { worker->setBinaryMode(clientId); }, Qt::QueuedConnection);
+
+            // ответ ещё текстовый, все следующие кадры в обе стороны - двоичные
+            sendToClient(*cit, "AUTH:SUCCESS:" PROTOCOL_V2_TOKEN);
+            cit->protocolVersion_ = PROTOCOL_VERSION_BINARY;
         }
+        else
+        {
+            sendToClient(*cit, "AUTH:SUCCESS");
+        }
+
+        cit->updateState(Client::ST_AUTHORIZED);
 
-        else if (is_logined(receiver_login))
+        publishPresence(PRESENCE_ADD, *cit);   // снимок списка клиент запросит сам (USERS:) после входа
+
+        PRINT("AUTH SUCCESS!!!")
+        PRINT("Send client connection status - YES")
+    }
+    else
+    {
+        PRINT("AUTH UNSUCCESS... Already have " + login + " login")
+
+        sendToClient(*cit, "AUTH:UNSUCCESS");
+        cit->updateState(Client::ST_CONNECTED);
+
+        PRINT("Send client connection status - YES")
+    }
+}
+
+void Server::handleUsersRequest(QByteArrayView /*args*/, ClientsIterator cit)
+{
+    if (cit->protocolVersion_ >= PROTOCOL_VERSION_BINARY)
+        sendUsersSnapshot(*cit);
+    else
+        handleUsersRequest();
+}
+
+void Server::handleReadinessRequest(QByteArrayView args, ClientsIterator cit)    // READINESS:<readiness>
+{
+    cit->readiness_ = (Client::Readiness) fieldToInt(nextField(args));
+
+    publishPresence(PRESENCE_UPDATE, *cit);
+    handleUsersRequest();
+}
+
+void Server::handleConnectionRequest(QByteArrayView args, ClientsIterator cit)
+{
+    QString sender_login = cit->getLogin();
+    QString receiver_login = QString::fromUtf8(nextField(args));
+
+    ClientsIterator receiver_it = findClient(receiver_login);
+
+    if (receiver_it != clients_.end())
+    {
+        QString message_answer = "CONNECTION:" + sender_login;
+        QByteArrayView answer = nextField(args);
+
+        if (fieldEquals(answer, "RULES") || answer.isEmpty())   // приглашение CONNECTION:<login2>[:RULES:<rules>]
         {
-            quintptr receiver_socketDescriptor = 0;
+            // правила приглашения видит приглашённый; старый клиент их не покажет, с ним - классические
+            RuleSet rules;
+            QByteArrayView rulesText = nextField(args);
 
-            for (auto it = logins_.begin(); it != logins_.end(); ++it)
+            if (!rulesText.isEmpty() && (!RuleSet::parse(rulesText.toByteArray().toStdString(), rules) ||
+                cit->protocolVersion_ < PROTOCOL_VERSION_BINARY || receiver_it->protocolVersion_ < PROTOCOL_VERSION_BINARY))
             {
-                if (it.value() == receiver_login)
-                {
-                    receiver_socketDescriptor = it.key();
-                    break;
-                }
+                LOG_INFO(LOG_CAT_GAME) << "Rules" << QString::fromLatin1(rulesText) << "from" << sender_login << "not offered to" << receiver_login << ", playing classic";
+                rules = RuleSet::classic();
             }
 
-            ClientsIterator receiver_it = clients_.find(receiver_socketDescriptor);
-            QString message_answer = "MESSAGE:" + sender_login + ":" + message;
-            receiver_it->socket_->write((message_answer+"@").toUtf8());
-//            receiver_it->socket_->flush();
+            // isValid() проверяет лишь площадь: флот, который не расставить, не предлагается вовсе
+            std::vector<Ship> ships;
+            if (!rules.isClassic() && !SparseBoard::generate(rules, shipsRandom_, ships))
+            {
+                LOG_INFO(LOG_CAT_GAME) << "Rules" << QString::fromStdString(rules.toString()) << "from" << sender_login << "cannot be placed, playing classic";
+                rules = RuleSet::classic();
+            }
 
-            PRINT(message_answer)
-        }
+            cit->invitedLogin_ = receiver_login;
+            cit->invitedRules_ = rules;
 
-        else
+            if (!rules.isClassic())
+                message_answer += ":RULES:" + QString::fromStdString(rules.toString());  // CONNECTION:<login1>:RULES:<rules>
+        }
+        else    // CONNECTION:<login1>:ACCEPT/REJECT request from the 2nd user
         {
-            // TODO: add error answer to the client
-            PRINT("No such user")
+            message_answer += ":" + QString::fromUtf8(answer); // CONNECTION:<login1>:ACCEPT/REJECT for the 1st user
         }
+
+        sendToClient(*receiver_it, message_answer);
+        LOG_DEBUG(LOG_CAT_GAME) << message_answer << " to " << receiver_login;
+
+        PRINT(message_answer)
     }
 
-    else if (request.startsWith("AUTH:"))
+    else
+    {
+        // TODO: add error answer to the client
+        PRINT("No such user")
+    }
+}
+
+void Server::handleGameRequest(QByteArrayView args, ClientsIterator cit)
+{
+    QByteArrayView first = nextField(args);
+
+    if (fieldEquals(first, "START"))  // GAME:START:<login_started>:<login_accepted>
     {
-        QString login = request.mid(5); // get login from the 1st line of request
-        if (checkLogin(login))   // check if login valid
+        nextField(args);    // начавший игру - отправитель запроса, логин из запроса не используется
+        QString login_started = cit->login_;
+        QString login_accepted = QString::fromUtf8(nextField(args));
+
+        ClientsIterator acceptedIt = findClient(login_accepted);
+        if (acceptedIt == clients_.end())
         {
-            logins_.insert(cit->socket_->socketDescriptor(), login);
-            cit->setLogin(login);
-
-            cit->socket_->write(((QString)"AUTH:SUCCESS" + "@").toUtf8());
-//            cit->socket_->flush();
-            cit->updateState(Client::ST_AUTHORIZED);
-//            cit->socket_->flush();
-            PRINT("AUTH SUCCESS!!!")
-            PRINT("Send client connection status - YES")
+            PRINT("No such user")
+            return;
         }
-        else
+
+        // игра начинается только по приглашению отправителя, с правилами, которые приглашённый видел в CONNECTION
+        if (cit->invitedLogin_ != login_accepted)
         {
-            PRINT("AUTH UNSUCCESS... Already have " + login + " login")
+            LOG_INFO(LOG_CAT_GAME) << login_started << "did not invite" << login_accepted;
+            return;
+        }
 
-            cit->socket_->write(((QString)"AUTH:UNSUCCESS" + "@").toUtf8());
-            cit->socket_->flush();
-            cit->updateState(Client::ST_CONNECTED);
+        RuleSet rules = cit->invitedRules_;
 
-            PRINT("Send client connection status - YES")
-        }
+        cit->invitedLogin_.clear();
+        cit->invitedRules_ = RuleSet::classic();
+
+        // Init game for these 2 users
+        startGame(login_started, login_accepted, rules);
+        return;
     }
 
-    else if (request.startsWith("USERS:"))
+    int gameId = fieldToInt(first); // get gameId
+    QByteArrayView second = nextField(args);
+
+    GamesIterator gIt = games_.find(gameId);
+
+    if (gIt == games_.end())
     {
-        handleUsersRequest();
+        LOG_DEBUG(LOG_CAT_GAME) << "No such game";
+        return;
     }
 
-    else if (request.startsWith("UPDATE:"))
+    // действует отправитель запроса: логин из запроса (GAME:<gameId>:<login>:...) не используется
+    bool is_ClientStarted = false;
+    if (!findPlayer(gIt, cit, is_ClientStarted))
+        return;
+
+    if (fieldEquals(second, "FINISH"))   // GAME:<gameId>:FINISH
     {
-        handleUpdateRequest();
+        finishGame(gameId);
+        return;
     }
 
-    else if (request.startsWith("READINESS:"))
+    QString login = cit->login_;
+    QByteArrayView action = nextField(args);
+
+    if (fieldEquals(action, "FIELD"))  // "GAME:<gameId>:<login>:FIELD:<packedField>"
     {
-//        handleReadinessRequest();
-        qintptr cId = ((QTcpSocket*)sender())->socketDescriptor();    // descriptor of client to disconnect
-        ClientsIterator cit = clients_.find(cId);
+        QString fieldStr = QString::fromLatin1(nextField(args));
+        LOG_DEBUG(LOG_CAT_GAME) << "Player " << login << " field from client: " << fieldStr;
 
-        QStringList message_request = request.split(":");
-        Client::Readiness readiness = (Client::Readiness) message_request[1].toInt();
+        QString fieldBinStr;
+        if (!Protocol::decodeFieldText(fieldStr, fieldBinStr))
+        {
+            LOG_DEBUG(LOG_CAT_GAME) << "Wrong fieldStr!";
+            sendFieldError(is_ClientStarted ? *gIt->getClientStartedIt() : *gIt->getClientAcceptedIt());
+            return;
+        }
 
-        cit->readiness_ = readiness;
+        handleFieldPlacement(gIt, is_ClientStarted, fieldBinStr);
+    }
+    else if (fieldEquals(action, "SHIPS"))  // "GAME:<gameId>:<login>:SHIPS:<packedShips>"
+    {
+        std::vector<Ship> ships;
+        if (!Protocol::decodeShipsText(QString::fromLatin1(nextField(args)), ships))
+        {
+            LOG_DEBUG(LOG_CAT_GAME) << "Wrong ships from" << login;
+            sendFieldError(is_ClientStarted ? *gIt->getClientStartedIt() : *gIt->getClientAcceptedIt());
+            return;
+        }
 
-        handleUsersRequest();   // TODO: delete it Later and write a function that dont delete all chats
+        handleShipsPlacement(gIt, is_ClientStarted, ships);
     }
+    else if (fieldEquals(action, "SHOT"))  // "GAME:<gameId>:<login>:SHOT:<x>:<y>"
+    {
+        int x = fieldToInt(nextField(args));
+        int y = fieldToInt(nextField(args));
 
-    else if (request.startsWith("CONNECTION:"))
+        handleShot(gIt, is_ClientStarted, x, y);
+    }
+    else
     {
-        QStringList message_request = request.split(":");
-        QString receiver_login = message_request[1];
+        PRINT("Wrong GAME: request")
+    }
+}
 
-        if (is_logined(receiver_login))
-        {
-            quintptr receiver_socketDescriptor = 0;
+void Server::handleHistoryRequest(QByteArrayView args, ClientsIterator cit)    // HISTORY:UPDATE: / HISTORY:PAGE:<cursor>:<limit>
+{
+    QByteArrayView op = nextField(args);
 
-            for (auto it = logins_.begin(); it != logins_.end(); ++it)
-            {
-                if (it.value() == receiver_login)
-                {
-                    receiver_socketDescriptor = it.key();
-                    break;
-                }
-            }
+    if (fieldEquals(op, "PAGE"))
+    {
+        handleHistoryPageRequest(args, cit);
+        return;
+    }
 
-            ClientsIterator receiver_it = clients_.find(receiver_socketDescriptor);
-            QString message_answer = "CONNECTION:" + sender_login;
+    if (fieldEquals(op, "SUBSCRIBE") || fieldEquals(op, "UNSUBSCRIBE"))
+    {
+        cit->historySubscribed_ = fieldEquals(op, "SUBSCRIBE");
+        return;
+    }
 
-            if (message_request.size() == 3)    // CONNECTION:<login1>:ACCEPT/REJECT request from the 2nd user
-            {
-                message_answer += ":" + message_request[2]; // CONNECTION:<login1>:ACCEPT/REJECT for the 1st user
-            }
+    if (!fieldEquals(op, "UPDATE"))
+    {
+        PRINT("Wrong request")
+        return;
+    }
 
-            else if (message_request.size() == 2)   // CONNECTION:<login2> request from the 1st user
-            {
-                // nothing
-            }
-            else
-                qDebug() << "Wrong request";
+    // вся история - только запросившему
+    sendToClient(*cit, "HISTORY:UPDATE:" + dbController_.getGamesEndings().join("$$"), TRAFFIC_HISTORY);
+}
 
-            receiver_it->socket_->write((message_answer+"@").toUtf8());
-//            receiver_it->socket_->flush();
-            qDebug() << message_answer << " to " << receiver_login;
+void Server::handleHistoryPageRequest(QByteArrayView args, ClientsIterator cit)    // <cursor>:<limit>
+{
+    qint64 cursor = fieldToInt(nextField(args));
+    int limit = fieldToInt(nextField(args));
 
-            PRINT(message_answer)
-        }
+    if (cursor < 0 || limit <= 0)
+    {
+        PRINT("Wrong HISTORY:PAGE: request")
+        return;
+    }
 
-        else
+    limit = qMin(limit, HISTORY_PAGE_LIMIT_MAX);
+
+    qint64 nextCursor = 0;
+    QStringList page = dbController_.getGamesEndingsPage(cursor, limit, nextCursor);
+
+    // HISTORY:PAGE:<cursor>:<next_cursor>:<row1>$$<row2>...
+    // ответ ограничен по размеру и ждётся клиентом, поэтому не отбрасывается как рассылка истории
+    sendToClient(*cit, "HISTORY:PAGE:" + QString::number(cursor) + ":" + QString::number(nextCursor) + ":" + page.join("$$"));
+}
+
+void Server::handleGenerateRequest(QByteArrayView /*args*/, ClientsIterator cit)  // "GENERATE:"
+{
+    const RuleSet& rules = cit->getBoard().getRules();
+
+    if (!rules.isClassic())     // правила из GAME:START: расстановка списком кораблей, GENERATE:SHIPS:<packedShips>
+    {
+        std::vector<Ship> ships;
+        if (!SparseBoard::generate(rules, shipsRandom_, ships))
         {
-            // TODO: add error answer to the client
-            PRINT("No such user")
+            LOG_WARNING(LOG_CAT_GAME) << "Could not place fleet" << QString::fromStdString(rules.toString());
+            sendToClient(*cit, "ERROR:GENERATE");
+            return;
         }
+
+        sendToClient(*cit, "GENERATE:SHIPS:" + Protocol::encodeShipsText(ships));
+        return;
     }
 
-    else if (request.startsWith("GAME:"))
+    QString fieldText;
+
+    if (corpus_.isOpen())
     {
-        QStringList message_request = request.split(":");
+        // запись набора со случайным поворотом или отражением - перестановка двух десятков битов
+        fieldText = PlacementGenerator::encodeFieldText(corpus_.at(placementGenerator_.nextBelow(corpus_.size())));
+    }
+    else
+    {
+        // расстановку готовит генератор в своём потоке; пул пуст только сразу после старта
+        fieldText = placementPool_.isEmpty() ? PlacementGenerator::encodeFieldText(placementGenerator_.generate())
+                                             : placementPool_.takeLast();
+        requestPlacements();
+    }
 
-        if (message_request.size() == 4)
-        {
-            if (message_request[1] == "START")  // GAME:START:<login_started>:<login_accepted>
-            {
-                QString login_started = message_request[2];
-                QString login_accepted = message_request[3];
+    // клиент версии 1 знает только прежнюю запись из PROTOCOL_FIELD_AREA цифр
+    if (cit->protocolVersion_ < PROTOCOL_VERSION_BINARY)
+    {
+        QString fieldBinStr;
+        Protocol::decodeFieldText(fieldText, fieldBinStr);
+        fieldText = fieldBinStr;
+    }
 
-                // Init game for these 2 users
-                startGame(login_started, login_accepted);
-            }
-            else
-                PRINT("Wrong request")
-        }
+    LOG_DEBUG(LOG_CAT_GAME) << "Generated field: " << fieldText;
+    QString message = "GENERATE:" + fieldText;
+
+    sendToClient(*cit, message);
+    LOG_DEBUG(LOG_CAT_GAME) << "Client's" + cit->login_ + "field generated and sended!";
+}
 
-        else if (message_request.size() == 3)   // GAME:<gameId>:FINISH
+void Server::printCommandStats()
+{
+    for (int command = 0; command < CMD_COUNT; command++)
+    {
+        const CommandStats& stats = commandStats_[command];
+        if (stats.count == 0)
+            continue;
+
+        PRINT(QString("%1: %2 requests, %3 bytes, %4 us total")
+                  .arg(commandName((Command)command))
+                  .arg(stats.count)
+                  .arg(stats.bytes)
+                  .arg(stats.nsecs / 1000))
+    }
+}
+
+void Server::handleBinaryData(QByteArrayView frame, int clientId)
+{
+    ClientsIterator cit = findClient(clientId);
+    if (cit == clients_.end())
+        return;
+
+    Opcode opcode = (Opcode)(quint8)frame[0];
+    QByteArrayView payload = frame.sliced(1);
+
+    switch (opcode)
+    {
+        case OP_TEXT:
         {
-            if (message_request[2] == "FINISH")
-            {
-                int gameId = message_request[1].toInt(); // get gameId
-                finishGame(gameId);
-            }
-            else
-                PRINT("Wrong request")
+            LOG_DEBUG(LOG_CAT_PROTOCOL) << "client" + QString::number(clientId) + ": " + QString::fromUtf8(payload);
+            handleData(payload, clientId);
+            break;
         }
 
-        else if (message_request.size() >= 5)
+        case OP_SHOT:
         {
-            int gameId = message_request[1].toInt(); // get gameId
-            QString login = message_request[2];
+            quint32 gameId = 0;
+            int x = 0, y = 0;
 
-            GamesIterator gIt = games_.find(gameId);
+            if (!Protocol::decodeShot(payload, gameId, x, y))
+            {
+                LOG_DEBUG(LOG_CAT_GAME) << "Wrong SHOT frame";
+                break;
+            }
 
+            GamesIterator gIt = games_.find(gameId);
             if (gIt == games_.end())
             {
-                qDebug() << "No such game";
-                return;
+                LOG_DEBUG(LOG_CAT_GAME) << "No such game";
+                break;
             }
 
-            bool is_ClientStarted = (login == gIt->getClientStartedIt()->login_);
+            bool is_ClientStarted = false;
+            if (findPlayer(gIt, cit, is_ClientStarted))
+                handleShot(gIt, is_ClientStarted, x, y);
+            break;
+        }
+
+        case OP_FIELD:
+        {
+            quint32 gameId = 0;
+            QString fieldBinStr;
 
-            if (message_request[3] == "FIELD")  // "GAME:<gameId>:<login>:FIELD:<fieldState>"
-            {
-                QString fieldStr = message_request[4];
-                qDebug() << "Player " << login << " field from client: " << fieldStr;
-
-                QString fieldBinStr = convertFieldToBin(fieldStr);
-                qDebug() << "Player " << login << " field on server: " << fieldBinStr;
-
-                if (is_ClientStarted)
-                {
-//                    gIt->setClientStartedFieldState(fieldStr);
-//                    gIt->setClientStartedField(fieldBinStr);
-                    gIt->getClientStartedIt()->initField(fieldBinStr);
-                    qDebug() << "Started client field setted!";
-                }
-                else
-                {
-//                    gIt->setClientAcceptedFieldState(fieldStr);
-//                    gIt->setClientAcceptedField(fieldBinStr);
-                    gIt->getClientAcceptedIt()->initField(fieldBinStr);
-                    qDebug() << "Accepted client field setted!";
-                }
-
-                gIt->incNPlaced();
-
-                if (gIt->getNPlaced() == 2)
-                {
-                    QString message = "GAME:FIGHT";
-                    gIt->getClientAcceptedIt()->socket_->write((message+"@").toUtf8());
-//                    gIt->getClientAcceptedIt()->socket_->flush();
-                    gIt->getClientStartedIt()->socket_->write((message+"@").toUtf8());
-//                    gIt->getClientStartedIt()->socket_->flush();
-
-                    gIt->updateState(GameController::GameState::ST_STARTED_STEP);
-                    qDebug() << "GAME:FIGHT";
-                }
-            }
-            else if (message_request[3] == "SHOT")  // "GAME:<gameId>:<login>:SHOT:<x>:<y>"
+            if (!Protocol::decodeField(payload, gameId, fieldBinStr))
             {
-                int x = message_request[4].toInt();
-                int y = message_request[5].toInt();
-
-//                ClientsIterator shooterIt = gIt->getClientAcceptedIt();
-                ClientsIterator enemyIt = gIt->getClientStartedIt();
-
-                if (is_ClientStarted)
-                {
-                    enemyIt = gIt->getClientAcceptedIt();
-//                    shooterIt = gIt->getClientStartedIt();
-                }
-
-                Field f = enemyIt->getField();
-                qDebug() << "bin  : " << f.getFieldStr();
-                qDebug() << "state: " << f.getFieldStateStr();
-                qDebug() << "draw : " << f.getFieldDrawStr();
-
-                QString enemyLogin = enemyIt->login_;
-                qDebug() << login + " -> " + enemyLogin +  ": SHOT (" + QString::number(x) + "," + QString::number(y) + ")";
-
-                QString message = "SHOT:";
-
-                bool isGameFinished = false;
-
-                if (!enemyIt->isCellEmpty(x, y))
-                {
-                    gIt->incNDamaged(is_ClientStarted);
-
-//                    qDebug() << "HERE1";
-                    if(enemyIt->isKilled(x, y)) // TODO: drawKilledShip(x, y); <-- функция класса server, которая ещё и отправляет ответ игроку drawKilledShip(enemyIt, x, y);
-                    {
-                        message += "KILLED"; // временно
-                        qDebug() << "Убит!";
-
-                        drawKilledShip(enemyIt, x, y);
-                        sendFieldDrawToUsers(enemyIt);
-
-                         isGameFinished = gIt->checkGameFinish(is_ClientStarted);
-
-//                        return;
-                    }
-                    else
-                    {
-                    //    qDebug() << "HERE2";
-                        // else    // DAMAGED
-                        enemyIt->setCellDraw(x, y, Field::CellDraw::CELL_DAMAGED);
-                        qDebug() << "Попадание!";
-                        message += "DAMAGED";
-                    }
-                }
-                else    // DOT
-                {
-//                    qDebug() << "HERE3";
-                    enemyIt->setCellDraw(x, y, Field::CellDraw::CELL_DOT);
-                    qDebug() << "Промах!";
-                    message += "DOT";
-
-                    if (is_ClientStarted)
-                    {
-                        gIt->updateState(GameController::GameState::ST_ACCEPTED_STEP);
-                    }
-                    else
-                    {
-                        gIt->updateState(GameController::GameState::ST_STARTED_STEP);
-                    }
-                }
-
-                message += ":" + QString::number(x) + ":" + QString::number(y);
-
-                gIt->getClientStartedIt()->socket_->write(((QString)(message+"@")).toUtf8());
-//                gIt->getClientStartedIt()->socket_->flush();
-                gIt->getClientAcceptedIt()->socket_->write(((QString)(message+"@")).toUtf8());
-//                gIt->getClientAcceptedIt()->socket_->flush();
-
-                if (isGameFinished)
-                {
-                    gIt->updateState(GameController::GameState::ST_FINISHED);
-                    gIt->winnerLogin_ = enemyIt->enemy_->getLogin();
-                    qDebug() << "all ships killed! game finished!";
-                    finishGame(gameId);
-                    // end timer and push to database
-                }
+                LOG_DEBUG(LOG_CAT_GAME) << "Wrong FIELD frame";
+                sendFieldError(*cit);
+                break;
             }
-            else
+
+            GamesIterator gIt = games_.find(gameId);
+            if (gIt == games_.end())
             {
-                qDebug() << "Wrong GAME: request";
+                LOG_DEBUG(LOG_CAT_GAME) << "No such game";
+                break;
             }
+
+            bool is_ClientStarted = false;
+            if (findPlayer(gIt, cit, is_ClientStarted))
+                handleFieldPlacement(gIt, is_ClientStarted, fieldBinStr);
+            break;
         }
-        else if (message_request.size() == 6)
+
+        default:
         {
+            LOG_DEBUG(LOG_CAT_GAME) << "Unknown opcode " << (int)opcode << " from client" << clientId;
+            break;
+        }
+    }
+}
 
+void Server::handleFieldPlacement(GamesIterator gIt, bool is_ClientStarted, const QString& fieldBinStr)
+{
+    LOG_DEBUG(LOG_CAT_GAME) << "Player field on server: " << fieldBinStr;
 
-        }
+    ClientsIterator playerIt = is_ClientStarted ? gIt->getClientStartedIt() : gIt->getClientAcceptedIt();
 
-        else
-            PRINT("Wrong request")
+    if (gIt->getState() != GameController::GameState::ST_PLACING || !gIt->getRules().isClassic())
+    {
+        // после GAME:FIGHT поле не меняется; поле других правил приходит списком кораблей (SHIPS)
+        sendFieldError(*playerIt);
+        return;
     }
 
-    else if (request.startsWith("HISTORY:UPDATE:"))
+    if (gIt->isPlaced(is_ClientStarted))
     {
-        QStringList gamesHistoryList = dbController_.getGamesEndings();
-        sendGamesHistoryListToUsers(gamesHistoryList);
+        // принятая расстановка не меняется до конца игры
+        LOG_INFO(LOG_CAT_GAME) << "Player" << playerIt->login_ << "sent a field again, ignored";
+        return;
     }
 
-    else if (request.startsWith("GENERATE:"))  // "GENERATE:"
-    {
-        QString randomFieldStr = dbController_.getRandomField();
+    playerIt->initField(fieldBinStr);
 
-        if (randomFieldStr.size() < 100)
-        {
-            qDebug() << "Wrong generated by db field";
-            return;
-        }
+    if (!playerIt->getField().isCorrect())
+    {
+        LOG_INFO(LOG_CAT_GAME) << "Player" << playerIt->login_ << "sent an incorrect field, rejected";
+        playerIt->initField();
+        gIt->setPlaced(is_ClientStarted, false);
+        sendFieldError(*playerIt);
+        return;
+    }
 
-        Field field = Field(randomFieldStr);
-//        field.generate();
-        qDebug() << "Generated field_ : " << field.getFieldStr();
-        qDebug() << "Generated fieldState_: " << field.getFieldStateStr();
-        qDebug() << "Generated fieldDraw_: "<< field.getFieldDrawStr();
-        QString message = "GENERATE:" + field.getFieldStr();
+    LOG_DEBUG(LOG_CAT_GAME) << (is_ClientStarted ? "Started" : "Accepted") << "client field setted!";
 
-        qintptr cId = ((QTcpSocket*)sender())->socketDescriptor();    // descriptor of client to disconnect
-        ClientsIterator cit = clients_.find(cId);
+    confirmPlacement(gIt, is_ClientStarted);
+}
 
-        if (cit == clients_.end())
-        {
-            qDebug() << "No such client";
-            return;
-        }
+void Server::handleShipsPlacement(GamesIterator gIt, bool is_ClientStarted, const std::vector<Ship>& ships)
+{
+    ClientsIterator playerIt = is_ClientStarted ? gIt->getClientStartedIt() : gIt->getClientAcceptedIt();
 
-        cit->socket_->write((message+"@").toUtf8());
-//        cit->socket_->flush();
-        qDebug() << "Client's" + cit->login_ + "field generated and sended!";
+    if (gIt->getState() != GameController::GameState::ST_PLACING || gIt->getRules().isClassic())
+    {
+        // классическое поле приходит битами (FIELD)
+        sendFieldError(*playerIt);
+        return;
     }
 
-    else if (request.startsWith("EXIT:"))
+    if (gIt->isPlaced(is_ClientStarted))
     {
-        handleExitRequest();
+        LOG_INFO(LOG_CAT_GAME) << "Player" << playerIt->login_ << "sent ships again, ignored";
+        return;
     }
 
-    else
-    {
+    SparseBoard& board = playerIt->getBoard();
+    board.setRules(gIt->getRules());
+    board.setShips(ships);
 
+    if (!board.isCorrect())
+    {
+        LOG_INFO(LOG_CAT_GAME) << "Player" << playerIt->login_ << "sent an incorrect ship list, rejected";
+        board.clear();
+        gIt->setPlaced(is_ClientStarted, false);
+        sendFieldError(*playerIt);
+        return;
     }
 
-    // TODO: add more handlers
+    LOG_DEBUG(LOG_CAT_GAME) << (is_ClientStarted ? "Started" : "Accepted") << "client ships setted:" << (int)ships.size();
+
+    confirmPlacement(gIt, is_ClientStarted);
 }
 
-void Server::sendFieldDrawToUsers(ClientsIterator cIt)
+void Server::confirmPlacement(GamesIterator gIt, bool is_ClientStarted)
 {
-    cIt->socket_->write(("FIELD:UPDATE:MY:" + cIt->getField().getFieldDrawStr() + "@").toUtf8());
-    cIt->enemy_->socket_->write(("FIELD:UPDATE:ENEMY:" + cIt->getField().getFieldDrawStr() + "@").toUtf8());
+    gIt->setPlaced(is_ClientStarted, true);
+
+    if (gIt->isAllPlaced())    // по флагу на игрока: повтор одним игроком бой не начинает
+    {
+        QString message = "GAME:FIGHT";
+        sendToClient(*gIt->getClientAcceptedIt(), message);
+        sendToClient(*gIt->getClientStartedIt(), message);
+
+        gIt->updateState(GameController::GameState::ST_STARTED_STEP);
+        LOG_DEBUG(LOG_CAT_GAME) << "GAME:FIGHT";
+    }
 }
 
-void printField(const QVector<Field::CellDraw>& field)
+bool Server::findPlayer(GamesIterator gIt, ClientsIterator cit, bool& is_ClientStarted)
 {
-    int width = sqrt(field.size());
-    int height = width;
-
-    QDebug debugOut = qDebug();
-    debugOut << "\n";
-    for(int i = 0; i < height; i++)
+    if (gIt->getClientStartedIt() == cit)
+        is_ClientStarted = true;
+    else if (gIt->getClientAcceptedIt() == cit)
+        is_ClientStarted = false;
+    else
     {
-        for(int j = 0; j < width; j++)
-        {
-           debugOut << (int)(field[i*width+j]) << " ";
-        }
-        debugOut << "\n";
+        LOG_INFO(LOG_CAT_GAME) << cit->login_ << "is not a player of game" << gIt->getGameId();
+        return false;
     }
+
+    return true;
 }
 
-void Server::drawKilledShip(ClientsIterator cIt, int x, int y)
+void Server::handleShot(GamesIterator gIt, bool is_ClientStarted, int x, int y)
 {
-    qDebug() << "Drawing killed ship...!";
+    ClientsIterator enemyIt = gIt->getClientStartedIt();
 
-    // Получаем поле клиента, у которого нужно сделать отрисовку убитого корабля
-    Field field = cIt->getField();
-    QVector<Field::CellState> fieldState = field.getFieldState();
-    QVector<Field::CellDraw> fieldDraw   = field.getFieldDraw();
-    int width_  = field.getWidth();
-    int height_ = field.getHeight();
+    if (is_ClientStarted)
+    {
+        enemyIt = gIt->getClientAcceptedIt();
+    }
 
-    // По традиции создаём поля State и Draw размером 12x12. Делаем их пустыми
-    QVector<Field::CellState> fieldStateWithBorders((width_+2)*(height_+2));
-    QVector<Field::CellDraw> fieldDrawWithBorders((width_+2)*(height_+2));
-    fieldStateWithBorders.fill(Field::CL_ST_EMPTY);
-    fieldDrawWithBorders.fill(Field::CELL_EMPTY);
+    GameController::GameState step = is_ClientStarted ? GameController::GameState::ST_STARTED_STEP
+                                                      : GameController::GameState::ST_ACCEPTED_STEP;
+    if (gIt->getState() != step)   // стрелять можно только в бою и только в свой ход
+    {
+        LOG_INFO(LOG_CAT_GAME) << "Shot out of turn in game" << gIt->getGameId();
+        return;
+    }
 
-    // Копируем в них поля State и Draw размерами 10x10
-    for(int i = 0; i < height_; i++)
+    if (gIt->getRules().isClassic() && !enemyIt->hasField())
     {
-        for(int j = 0; j < width_; j++)
-        {
-            fieldStateWithBorders[(width_+2)*(i+1)+(j+1)] = fieldState[width_*i+j];
-        }
+        LOG_WARNING(LOG_CAT_GAME) << "Shot at a missing field in game" << gIt->getGameId();
+        return;
     }
 
-    for(int i = 0; i < height_; i++)
+    QString enemyLogin = enemyIt->login_;
+    LOG_DEBUG(LOG_CAT_GAME) << enemyIt->enemy_->login_ + " -> " + enemyLogin +  ": SHOT (" + QString::number(x) + "," + QString::number(y) + ")";
+
+    bool isGameFinished = false;
+    ShotResult result = gIt->getRules().isClassic() ? shootField(gIt, enemyIt, is_ClientStarted, x, y, isGameFinished)
+                                                    : shootBoard(gIt, enemyIt, is_ClientStarted, x, y, isGameFinished);
+
+    if (result == SHOT_DOT)
     {
-        for(int j = 0; j < width_; j++)
+        LOG_DEBUG(LOG_CAT_GAME) << "Промах!";
+
+        if (is_ClientStarted)
+        {
+            gIt->updateState(GameController::GameState::ST_ACCEPTED_STEP);
+        }
+        else
         {
-            fieldDrawWithBorders[(width_+2)*(i+1)+(j+1)] = fieldDraw[width_*i+j];
+            gIt->updateState(GameController::GameState::ST_STARTED_STEP);
         }
     }
 
-    // Переводим координаты клетки, в которую попали, из пространства 10x10 в пространство 12x12
-    int damagedCell = (width_+2)*(y+1)+(x+1);
+    sendShotResult(*gIt->getClientStartedIt(), result, x, y);
+    sendShotResult(*gIt->getClientAcceptedIt(), result, x, y);
 
-    // Сам алгоритм отрисовки клеток убитого корабля
-    switch(fieldStateWithBorders[damagedCell])
+    if (isGameFinished)
     {
-        case(Field::CellState::CL_ST_CENTER):
-        {
-            for(int cell = damagedCell - (width_ + 2) - 1, cnt = 0; cnt < 3; ++cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 1 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 2 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-            }
+        gIt->updateState(GameController::GameState::ST_FINISHED);
+        gIt->winnerLogin_ = enemyIt->enemy_->getLogin();
+        LOG_DEBUG(LOG_CAT_GAME) << "all ships killed! game finished!";
+        finishGame(gIt->getGameId());
+        // end timer and push to database
+    }
+}
 
-            fieldDrawWithBorders[damagedCell] = Field::CellDraw::CELL_KILLED;
-            break;
-        }
+ShotResult Server::shootField(GamesIterator gIt, ClientsIterator enemyIt, bool is_ClientStarted, int x, int y, bool& isGameFinished)
+{
+    if (enemyIt->isCellEmpty(x, y))
+    {
+        enemyIt->setCellDraw(x, y, Field::CellDraw::CELL_DOT);
+        return SHOT_DOT;
+    }
 
-        case(Field::CellState::CL_ST_TOP):
-        {
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell + lenght * (width_ + 2)] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    if (!enemyIt->isShot(x, y))    // повторный выстрел в ту же клетку не считается новым попаданием
+        gIt->incNDamaged(is_ClientStarted);
 
-            for(int cell = damagedCell - (width_ + 2) - 1, cnt = 0; cnt < 3; ++cell, ++cnt)
-            {
-                for(int tmpCell = cell, tmpCnt = 0; tmpCnt < lenght + 2; tmpCell += width_ + 2, tmpCnt++)
-                {
-                    fieldDrawWithBorders[tmpCell] = Field::CellDraw::CELL_DOT;
-                }
-            }
+    if (!enemyIt->isKilled(x, y))
+    {
+        enemyIt->setCellDraw(x, y, Field::CellDraw::CELL_DAMAGED);
+        LOG_DEBUG(LOG_CAT_GAME) << "Попадание!";
+        return SHOT_DAMAGED;
+    }
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; cell += width_ + 2, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    LOG_DEBUG(LOG_CAT_GAME) << "Убит!";
+    sendFieldDiffToUsers(enemyIt, drawKilledShip(enemyIt, x, y));
 
-        case(Field::CellState::CL_ST_LEFT):
-        {
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell + lenght] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    isGameFinished = enemyIt->isFleetDestroyed();
+    return SHOT_KILLED;
+}
 
-            for(int cell = damagedCell - (width_ + 2) - 1, cnt = 0; cnt < lenght + 2; ++cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 1 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 2 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-            }
+ShotResult Server::shootBoard(GamesIterator gIt, ClientsIterator enemyIt, bool is_ClientStarted, int x, int y, bool& isGameFinished)
+{
+    SparseBoard& board = enemyIt->getBoard();
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; ++cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    bool isRepeat = board.isShot(x, y);     // повторный выстрел ничего не меняет на поле
+    CellDraw state = board.shoot(x, y);
 
-        case(Field::CellState::CL_ST_BOTTOM):
-        {
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell - lenght * (width_ + 2)] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    if (state == CELL_DOT)
+        return SHOT_DOT;
 
-            for(int cell = damagedCell + (width_ + 2) - 1, cnt = 0; cnt < 3; ++cell, ++cnt)
-            {
-                for(int tmpCell = cell, tmpCnt = 0; tmpCnt < lenght + 2; tmpCell -= width_ + 2, tmpCnt++)
-                {
-                    fieldDrawWithBorders[tmpCell] = Field::CellDraw::CELL_DOT;
-                }
-            }
+    if (!isRepeat)
+        gIt->incNDamaged(is_ClientStarted);
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; cell -= width_ + 2, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    if (state == CELL_DAMAGED)
+    {
+        LOG_DEBUG(LOG_CAT_GAME) << "Попадание!";
+        return SHOT_DAMAGED;
+    }
 
-        case(Field::CellState::CL_ST_VMIDDLE):
-        {
-            for(; fieldStateWithBorders[damagedCell] != Field::CellState::CL_ST_EMPTY; damagedCell -= (width_+2)) {}
-            damagedCell += (width_+2);
+    LOG_DEBUG(LOG_CAT_GAME) << "Убит!";
+    if (!isRepeat)
+        sendBoardDiffToUsers(enemyIt, board.shipAt(x, y));
 
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell + lenght * (width_ + 2)] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    isGameFinished = board.isFleetDestroyed();
+    return SHOT_KILLED;
+}
 
-            for(int cell = damagedCell - (width_ + 2) - 1, cnt = 0; cnt < 3; ++cell, ++cnt)
-            {
-                for(int tmpCell = cell, tmpCnt = 0; tmpCnt < lenght + 2; tmpCell += width_ + 2, tmpCnt++)
-                {
-                    fieldDrawWithBorders[tmpCell] = Field::CellDraw::CELL_DOT;
-                }
-            }
+// клетки маски подряд с одинаковым состоянием отрисовки собираются в один отрезок
+static QVector<CellRange> collectDrawRanges(const Field& field, Bitboard cells)
+{
+    QVector<CellRange> ranges;
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; cell += width_ + 2, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    while (cells.any())
+    {
+        int index = cells.first();
+        int state = field.getCellDraw(index);
+        cells.reset(index);
 
-        case(Field::CellState::CL_ST_HMIDDLE):
-        {
-            for(; fieldStateWithBorders[damagedCell] != Field::CellState::CL_ST_EMPTY; damagedCell--) {}
-            damagedCell++;
+        if (!ranges.isEmpty() && ranges.last().start_ + ranges.last().count_ == index && ranges.last().state_ == state)
+            ranges.last().count_++;
+        else
+            ranges.append(CellRange{ index, 1, state });
+    }
 
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell + lenght] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    return ranges;
+}
 
-            for(int cell = damagedCell - (width_ + 2) - 1, cnt = 0; cnt < lenght + 2; ++cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 1 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 2 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-            }
+void Server::sendFieldDiffToUsers(ClientsIterator cIt, const Bitboard& changed)
+{
+    if (changed.none())     // повторный выстрел по убитому кораблю ничего не меняет
+        return;
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; ++cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    const Field& field = cIt->getField();   // поле клиента, без копии
+    QVector<CellRange> ranges = collectDrawRanges(field, changed);
 
-        case(Field::CellState::CL_ST_RIGHT):
-        {
-            int lenght = 0;
-            for(; fieldStateWithBorders[damagedCell - lenght] != Field::CellState::CL_ST_EMPTY; lenght++) {}
+    // клиент версии 1 не знает FIELD:DIFF и получает поле целиком
+    bool isWhole = PROTOCOL_FIELD_DIFF_SIZE(ranges.size()) >= 1 + PROTOCOL_FIELD_DRAW_SIZE;
 
-            for(int cell = damagedCell - (width_ + 2) + 1, cnt = 0; cnt < lenght + 2; --cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 1 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-                fieldDrawWithBorders[cell + 2 * (width_ + 2)] = Field::CellDraw::CELL_DOT;
-            }
+    if (isWhole || cIt->protocolVersion_ < PROTOCOL_VERSION_BINARY)
+        sendFieldDraw(*cIt, OWNER_MY, field);
+    else
+        sendFieldDiff(*cIt, OWNER_MY, ranges);
 
-            for(int cell = damagedCell, cnt = 0; cnt < lenght; --cell, ++cnt)
-            {
-                fieldDrawWithBorders[cell] = Field::CellDraw::CELL_KILLED;
-            }
-            break;
-        }
+    if (isWhole || cIt->enemy_->protocolVersion_ < PROTOCOL_VERSION_BINARY)
+        sendFieldDraw(*cIt->enemy_, OWNER_ENEMY, field);
+    else
+        sendFieldDiff(*cIt->enemy_, OWNER_ENEMY, ranges);
+}
 
-        default:
-        {
-            qDebug() << "From function drawKilledShip: unknown cell state!";
-            break;
-        }
-    }
+void Server::sendBoardDiffToUsers(ClientsIterator cIt, int ship)
+{
+    const SparseBoard& board = cIt->getBoard();
+
+    std::vector<CellRun> runs;
+    board.getKilledRuns(ship, runs);
+
+    QVector<CellRange> ranges;
+    ranges.reserve((qsizetype)runs.size());
+    for (const CellRun& run : runs)
+        ranges.append(CellRange{ run.start_, run.count_, run.state_ });
+
+    int area = board.getRules().getArea();
+    sendFieldDiff(*cIt, OWNER_MY, ranges, area);
+    sendFieldDiff(*cIt->enemy_, OWNER_ENEMY, ranges, area);
+}
+
+void printField(const QVector<Field::CellDraw>& field, int width)
+{
+    int height = field.size() / width;
+
+    if (!logEnabled(LOG_LEVEL_DEBUG, LOG_CAT_GAME))
+        return;
 
-    // Переводим отрисованное поле из 12x12 в 10x10
-    for(int i = 0; i < height_; i++)
+    LogRecord record(LOG_LEVEL_DEBUG, LOG_CAT_GAME);
+    QDebug debugOut = record.stream();
+    debugOut << "\n";
+    for(int i = 0; i < height; i++)
     {
-        for(int j = 0; j < width_; j++)
+        for(int j = 0; j < width; j++)
         {
-            fieldDraw[width_*i+j]  = fieldDrawWithBorders[(width_+2)*(i+1)+(j+1)];
+           debugOut << (int)(field[i*width+j]) << " ";
         }
+        debugOut << "\n";
     }
+}
 
-    cIt->setFieldDraw(fieldDraw);
+Bitboard Server::drawKilledShip(ClientsIterator cIt, int x, int y)
+{
+    LOG_DEBUG(LOG_CAT_GAME) << "Drawing killed ship...!";
 
-//    printField(fieldDraw);
+    return cIt->markKilled(x, y);  // клетки корабля и его ореол - маски поля, без копий и рамки 12x12
 }
 
 
@@ -785,90 +1228,107 @@ void Server::drawKilledShip(ClientsIterator cIt, int x, int y)
 //}
 
 
-void Server::handleUsersRequest()
+QString Server::getPresenceStr(const Client& client)
+{
+    return client.login_ + ":" + QString::number(client.status_) + ":" + QString::number(client.readiness_); // <login>:<status>:<readiness>
+}
+
+QString Server::getUsersListStr()
 {
     QList<QString> users_list;
 
     foreach (const Client& client, clients_)
     {
         if (client.isAuthorized())
-        {
-            QString user_str = client.login_ + ":" + QString::number(client.status_) + ":" + QString::number(client.readiness_); // <login>:<status>:<readiness>
-            users_list.append(user_str);
-        }
+            users_list.append(getPresenceStr(client));
     }
 
-    QString answer = "USERS:" + users_list.join(" ");    // USERS:<login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
+    return users_list.join(" ");   // <login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
+}
 
-    foreach (const Client& client, clients_)
-    {
-        if (client.isAuthorized())
-        {
-            client.socket_->write(((answer+"@").toUtf8())); // sending to all clients list of all user logins
-//            client.socket_->write(((QString)"\n").toUtf8()); // sending to all clients list of all user logins
-            client.socket_->flush();
+void Server::handleUsersRequest()
+{
+    QString answer = "USERS:" + getUsersListStr();    // USERS:<login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
 
-            PRINT("to " + client.login_ + " : " + answer)
-        }
-    }
+    // клиенты версии 2 получают изменения USER:*, полный список нужен только версии 1
+    broadcast(answer, [](const Client& client) { return client.isAuthorized() && client.protocolVersion_ < PROTOCOL_VERSION_BINARY; }, TRAFFIC_PRESENCE);
 }
 
-void Server::handleUpdateRequest()
+void Server::sendUsersSnapshot(const Client& client)
 {
-    QList<QString> users_list;
-
-    foreach (const Client& client, clients_)
-    {
-        if (client.isAuthorized())
-        {
-            QString user_str = client.login_ + ":" + QString::number(client.status_) + ":" + QString::number(client.readiness_); // <login>:<status>:<readiness>
-            users_list.append(user_str);
-        }
-    }
+    sendToClient(client, "USERS:SNAPSHOT:" + QString::number(presenceSeq_) + ":" + getUsersListStr(), TRAFFIC_PRESENCE);   // USERS:SNAPSHOT:<seq>:<login1>:<status1>:<readiness1> ...
+}
 
-    const char* answer = ("USERS:" + users_list.join(" ")).toUtf8();    // USERS:<login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
+void Server::publishPresence(PresenceOp op, const Client& client)
+{
+    static const char* const opNames[] = { "ADD", "UPDATE", "REMOVE" };
 
+    quint64 seq = ++presenceSeq_;
+    QString message = QString("USER:") + opNames[op] + ":" + QString::number(seq) + ":"
+                    + (op == PRESENCE_REMOVE ? client.login_ : getPresenceStr(client));   // USER:<op>:<seq>:<login>[:<status>:<readiness>]
 
-    qintptr cId = ((QTcpSocket*)sender())->socketDescriptor();    // descriptor of client to disconnect
-    ClientsIterator cit = clients_.find(cId);
-    cit->socket_->write(((QString)answer+"@").toUtf8()); // sending to all clients list of all user logins
-    cit->socket_->flush();
+    // сам клиент получает только UPDATE: о своём входе он узнаёт из снимка, а при выходе ему уже не нужно
+    int clientId = client.id_;
+    bool toSelf = (op == PRESENCE_UPDATE);
 
-    PRINT(answer)
+    broadcast(message, [clientId, toSelf](const Client& receiver)
+    {
+        return receiver.isAuthorized() && receiver.protocolVersion_ >= PROTOCOL_VERSION_BINARY && (toSelf || receiver.id_ != clientId);
+    }, TRAFFIC_PRESENCE);
 }
 
-void Server::handleReadinessRequest()
+void Server::handleUpdateRequest(QByteArrayView /*args*/, ClientsIterator cit)
 {
+    if (cit->protocolVersion_ >= PROTOCOL_VERSION_BINARY)
+    {
+        sendUsersSnapshot(*cit);
+        return;
+    }
 
-}
+    QString answer = "USERS:" + getUsersListStr();    // USERS:<login1>:<status1>:<readiness1> <login2>:<status2>:<readiness2> ...
 
-void Server::handleConnectionRequest()
-{
-//    QStringList message_request = request.split(":");
+    sendToClient(*cit, answer, TRAFFIC_PRESENCE); // sending to all clients list of all user logins
 
+    PRINT(answer)
 }
 
-void Server::handleExitRequest()
+void Server::handleExitRequest(QByteArrayView /*args*/, ClientsIterator cit)
 {
-    qintptr cId = ((QTcpSocket*)sender())->socketDescriptor();    // descriptor of client to disconnect
-    ClientsIterator cit = clients_.find(cId);
+    int cId = cit.key();    // ID of client to disconnect
 
-    qDebug() << "sender: " << cit->login_;
+    LOG_DEBUG(LOG_CAT_GAME) << "sender: " << cit->login_;
 
     QString login = cit->login_;
 
+    if (cit->isAuthorized())
+        publishPresence(PRESENCE_REMOVE, *cit);
+
     clientDisconnect(cit);
+    stopGamesOf(cit);
+    unregisterLogin(cit);
+    sessions_.remove(cId);
+    congested_.remove(cId);
     clients_.erase(cit);
-    logins_.remove(cId);
-    qDebug() << login + " removed from clients_ and logins_";
+    LOG_DEBUG(LOG_CAT_GAME) << login + " removed from clients_ and logins_";
 
-    if (clients_.find(cId)==clients_.end() && logins_.find(cId)==logins_.end())
+    if (!sessions_.contains(cId) && !logins_.contains(login))
         PRINT("User " + login + " is really deleted")
 
     handleUsersRequest();
+}
+
+void Server::handlePongRequest(QByteArrayView /*args*/, ClientsIterator cit)   // PONG:
+{
+    if (!cit->pingSentAt_)
+        return;
 
-    // TODO: send to users message about this client has disconnected
-//    sendMessageToAll(":" + login);
+    int rtt = (int)(clock_.elapsed() - cit->pingSentAt_);
+    cit->pingSentAt_ = 0;
+
+    // сглаживание как у SRTT в TCP: 7/8 старого + 1/8 нового
+    cit->rttMs_ = cit->rttMs_ < 0 ? rtt : (7 * cit->rttMs_ + rtt) / 8;
+
+    LOG_DEBUG(LOG_CAT_NET) << "client" << cit->id_ << "rtt" << rtt << "ms, smoothed" << cit->rttMs_ << "ms";
 }
 
 void Server::handleFieldRequest()
@@ -878,80 +1338,85 @@ void Server::handleFieldRequest()
 
 void Server::clientDisconnect(ClientsIterator& cit)
 {
-//    socket_ = cit->socket_;
+    IOWorker* worker = cit->worker_;
+    int clientId = cit->id_;
+    QMetaObject::invokeMethod(worker, [worker, clientId]() { worker->disconnectClient(clientId); }, Qt::QueuedConnection);
 
-    cit->socket_->disconnectFromHost();
     cit->status_ = Client::ST_DISCONNECTED;
-    cit->socket_->close();
 
     PRINT("User " + cit->login_ + " is disconnected")
 }
 
-void Server::on_sockConnect()
+void Server::on_clientDisconnected(int clientId)
 {
-    PRINT("Connect")
+    PRINT("Disconnected client " + QString::number(clientId))
+
+    ClientsIterator cit = findClient(clientId);
+    if (cit == clients_.end())
+        return;
+
+    bool wasAuthorized = cit->isAuthorized();
+    if (wasAuthorized)
+        publishPresence(PRESENCE_REMOVE, *cit);
+
+    cit->status_ = Client::ST_DISCONNECTED;
+    stopGamesOf(cit);       // противник получает GAME:STOP, игры больше не ссылаются на клиента
+    unregisterLogin(cit);
+    sessions_.remove(clientId);
+    congested_.remove(clientId);
+    clients_.erase(cit);    // срок в heartbeatWheel_ снимется лениво: id уже нет в sessions_
+
+    if (wasAuthorized)
+        handleUsersRequest();
 }
 
-void Server::on_sockDisconnect()
+void Server::on_clientError(int clientId, QAbstractSocket::SocketError error)
 {
-    PRINT("Disconnected socket " + QString::number(socket_->socketDescriptor()))
-
-    if (socket_)
-        socket_->deleteLater();
+    PRINT("Socket error " + QString::number(error) + " on client " + QString::number(clientId))
 }
 
-void Server::removeDisconnectedClients()   // TODO: rewrite the function
+void Server::on_clientCongested(int clientId, bool congested)
 {
-    ClientsIterator freeClient = clients_.end();
+    ClientsIterator cit = findClient(clientId);
+    if (cit == clients_.end())
+        return;
 
-    for(ClientsIterator cit = clients_.begin(); cit != clients_.end(); cit++)
+    if (congested)
     {
-//        if(freeClient == cit)
-//            freeClient = clients_.end();
-
-        if (cit->socket_ && !cit->socket_->isValid())  // check socket for valideness
-        {
-            socket_ = cit->socket_;
-
-            logins_.remove(cit.key());     // remove login of this user from the logins_
-//            clients_.remove(cit.key());    // remove the client from the clients_
-
-//            PRINT(clients_.keys())
-//          PRINT("Remove unexpected exited user " + cit->login_)
-
-//            socket_ = cit->socket_;
-        }
+        congested_.insert(clientId, 0);
+        return;
     }
-}
 
-void Server::on_sockError(QAbstractSocket::SocketError error)
-{
-    PRINT("Socket error " + QString::number(error))
+    quint8 dropped = congested_.take(clientId);
 
-    switch(error)
+    if (dropped & (1 << TRAFFIC_PRESENCE) && cit->isAuthorized())
     {
-        case QAbstractSocket::SocketError::RemoteHostClosedError:   // unexpected exit
-        {
-            // TODO: delete users
-            removeDisconnectedClients();
-            break;
-        }
-
-    default:
-        {
+        if (cit->protocolVersion_ >= PROTOCOL_VERSION_BINARY)
+            sendUsersSnapshot(*cit);    // пропущенные USER:* заменяются снимком с текущим номером
+        else
+            sendToClient(*cit, "USERS:" + getUsersListStr(), TRAFFIC_PRESENCE);
+    }
 
-        }
+    if (dropped & (1 << TRAFFIC_HISTORY))
+    {
+        if (cit->historySubscribed_)
+            sendToClient(*cit, "HISTORY:RESET:", TRAFFIC_HISTORY);    // пропущены HISTORY:APPEND - окно перезапросит первую страницу
+        else
+            sendToClient(*cit, "HISTORY:UPDATE:" + dbController_.getGamesEndings().join("$$"), TRAFFIC_HISTORY);
     }
+
+    if (dropped & (1 << TRAFFIC_CHAT))
+        LOG_INFO(LOG_CAT_NET) << "client" << clientId << "missed chat messages while congested";
 }
 
-bool Server::is_logined(QString& login) // check if login available
+bool Server::is_logined(const QString& login) // check if login available
 {
-    return logins_.values().contains(login);
+    return logins_.contains(login);
 }
 
-bool Server::checkLogin(QString& login) // check if login available
+bool Server::checkLogin(const QString& login) // check if login available
 {
-    if (!logins_.values().contains(login))
+    if (!logins_.contains(login))
     {
         PRINT("client " + login + " connected")
         return true;
@@ -962,58 +1427,88 @@ bool Server::checkLogin(QString& login) // check if login available
 
 void Server::timerEvent(QTimerEvent* event)
 {
-    Q_UNUSED(event);
-//    PRINT("timer tick")
+    if (event->timerId() != timerId_)
+        return;
+
+    qint64 now = clock_.elapsed();
+
+    // за тик проверяются только сессии, срок которых наступил
+    for (int clientId : heartbeatWheel_.advance())
+    {
+        ClientsIterator cit = findClient(clientId);
+        if (cit == clients_.end() || cit->status_ == Client::ST_DISCONNECTED)
+            continue;   // снята со срока лениво
+
+        if (!cit->isAuthorized())
+        {
+            // клиент отвечает на PING: только после AUTH, до входа сессию не проверяем и не отключаем
+            heartbeatWheel_.schedule(clientId, HEARTBEAT_IDLE_MS);
+            continue;
+        }
+
+        if (cit->pingSentAt_ && cit->lastSeen_ < cit->pingSentAt_)  // после PING: ничего не пришло
+        {
+            qint64 waited = now - cit->pingSentAt_;
 
-//    ClientsIterator freeClient = clients_.end();
+            if (waited < HEARTBEAT_TIMEOUT_MS)
+            {
+                heartbeatWheel_.schedule(clientId, HEARTBEAT_TIMEOUT_MS - waited);
+                continue;
+            }
 
-//    for(ClientsIterator cit = clients_.begin(); cit != clients_.end(); cit++)
-//    {
-//        if(cit->status_ == Client::ST_DISCONNECTED)
-//        {
-//           if(freeClient == cit)
-//              freeClient = clients_.end();
+            PRINT("Client " + cit->login_ + " (" + QString::number(clientId) + ") did not answer PING: for " + QString::number(waited) + " ms, disconnecting")
 
-//           cit = clients_.erase(cit);
-//           continue;
-//        }
+            // клиент не читает, ждать записи буфера бессмысленно; disconnected() придёт от потока ввода-вывода
+            IOWorker* worker = cit->worker_;
+            QMetaObject::invokeMethod(worker, [worker, clientId]() { worker->abortClient(clientId); }, Qt::QueuedConnection);
+            continue;
+        }
 
-//        if(cit->socket_->write("PING:") != -1)
-//        {
-//            if(!cit->socket_->waitForReadyRead(1000))
-//            {
-//                PRINT("Client " + cit->login_ +  " don't answer.")
-//                cit = clients_.erase(cit);
-//                continue;
-//            }
-//        }
-//        else
-//        {
-//            PRINT("Client " + cit->login_ +  " exited urgently.")
-//        }
+        qint64 idle = now - cit->lastSeen_;
 
+        if (idle < HEARTBEAT_IDLE_MS)
+        {
+            heartbeatWheel_.schedule(clientId, HEARTBEAT_IDLE_MS - idle);   // клиент активен, PING: не нужен
+            continue;
+        }
 
-//    }
+        sendToClient(*cit, "PING:");
+        cit->pingSentAt_ = now;
+        heartbeatWheel_.schedule(clientId, HEARTBEAT_TIMEOUT_MS);
+    }
 }
 
-void Server::startGame(QString login_started, QString login_accepted)
+void Server::startGame(QString login_started, QString login_accepted, const RuleSet& gameRules)
 {
     ClientsIterator c1It = findClient(login_started);
     ClientsIterator c2It = findClient(login_accepted);
 
+    // клиент версии 1 не знает ни пятого поля GAME:START, ни SHIPS: с ним играется классика
+    RuleSet rules = gameRules;
+    if (!rules.isClassic() && (c1It->protocolVersion_ < PROTOCOL_VERSION_BINARY || c2It->protocolVersion_ < PROTOCOL_VERSION_BINARY))
+    {
+        LOG_INFO(LOG_CAT_GAME) << "Rules" << QString::fromStdString(rules.toString()) << "need protocol version 2 on both sides, playing classic";
+        rules = RuleSet::classic();
+    }
+
     c1It->enemy_ = c2It;
     c2It->enemy_ = c1It;
 
     static int gameId = 0;
     gameId++;   // get gameId
 
-    GameController gameController(gameId, c1It, c2It);
+    GameController gameController(gameId, c1It, c2It, rules);
+
+    // поле правил из GAME:START заполняется расстановкой SHIPS, классическое - прежним Field
+    c1It->getBoard().setRules(rules);
+    c2It->getBoard().setRules(rules);
 
     // start timer
     gameController.startTime_  = QDateTime::currentDateTime();
     gameController.startDate_ = QDate::currentDate();
-//    qDebug() << "Время начала:" << gameController.startTime_.toString("hh:mm:ss");
+//    LOG_DEBUG(LOG_CAT_GAME) << "Время начала:" << gameController.startTime_.toString("hh:mm:ss");
 
+    gameController.updateState(GameController::GameState::ST_PLACING);    // до вставки: games_ хранит копию
     games_.insert(gameId, gameController);
 
     if (games_.find(gameId) != games_.end())
@@ -1024,18 +1519,21 @@ void Server::startGame(QString login_started, QString login_accepted)
     QString message1 = "GAME:START:" + login_accepted + ":" + QString::number(gameId);
     QString message2 = "GAME:START:" + login_started + ":" + QString::number(gameId);
 
+    if (!rules.isClassic())     // классическая игра объявляется как раньше, старые клиенты её понимают
+    {
+        QString rulesText = ":" + QString::fromStdString(rules.toString());
+        message1 += rulesText;
+        message2 += rulesText;
+    }
+
 //    c1It->readiness_ = Client::ST_PLAYING;
 //    c2It->readiness_ = Client::ST_PLAYING;
 
-    c1It->socket_->write((message1+"@").toUtf8());
-//    c1It->socket_->flush();
-    c2It->socket_->write((message2+"@").toUtf8());
-//    c2It->socket_->flush();
-
-    gameController.updateState(GameController::GameState::ST_PLACING);
+    sendToClient(*c1It, message1);
+    sendToClient(*c2It, message2);
 
-    qDebug() << message1;
-    qDebug() << message2;
+    LOG_DEBUG(LOG_CAT_GAME) << message1;
+    LOG_DEBUG(LOG_CAT_GAME) << message2;
     PRINT("Start game " + login_started + " vs " + login_accepted + " with gameId=" + QString::number(gameId))
 }
 
@@ -1043,7 +1541,7 @@ void Server::finishGame(int gameId)
 {
     GamesIterator gameIt = games_.find(gameId);
 
-    qDebug() << "We have now " + QString::number(games_.size()) + " active games";
+    LOG_DEBUG(LOG_CAT_GAME) << "We have now " + QString::number(games_.size()) + " active games";
 
     for (GamesIterator git = games_.begin(); git != games_.end(); ++git)
     {
@@ -1071,7 +1569,7 @@ void Server::finishGame(int gameId)
     {
         if (gameIt->winnerLogin_ == "")
         {
-            qDebug() << "Game " << gameId << " has no winner yet...";
+            LOG_DEBUG(LOG_CAT_GAME) << "Game " << gameId << " has no winner yet...";
             return;
         }
 
@@ -1081,10 +1579,12 @@ void Server::finishGame(int gameId)
         // Заполняем базу данных завершившейся игрой
         gameIt->endTime_ = QDateTime::currentDateTime();
         gameIt->endDate_ = QDate::currentDate();
-        dbController_.addNewGameEnding(gameIt);
-        dbController_.printTable("GamesEndings");
-        QStringList gamesHistoryList = dbController_.getGamesEndings();
-        sendGamesHistoryListToUsers(gamesHistoryList);
+
+        // история хранит и показывает поля 10x10, игры других правил в неё не пишутся
+        if (gameIt->getRules().isClassic())
+            publishGameEnding(dbController_.addNewGameEnding(gameIt));
+        else
+            LOG_INFO(LOG_CAT_DB) << "Game" << gameId << "with rules" << QString::fromStdString(gameIt->getRules().toString()) << "is not stored in history";
     }
     else
     {
@@ -1095,10 +1595,8 @@ void Server::finishGame(int gameId)
 //    c1It->readiness_ = Client::ST_NREADY;
 //    c2It->readiness_ = Client::ST_NREADY;
 
-    c1It->socket_->write((message+"@").toUtf8());
-//    c1It->socket_->flush();
-    c2It->socket_->write((message+"@").toUtf8());
-//    c2It->socket_->flush();
+    sendToClient(*c1It, message);
+    sendToClient(*c2It, message);
 
     PRINT(message + " to " + login1)
     PRINT(message + " to " + login2)
@@ -1108,6 +1606,28 @@ void Server::finishGame(int gameId)
     games_.erase(gameIt);
 }
 
+void Server::stopGamesOf(ClientsIterator cit)
+{
+    QList<int> gameIds;
+
+    for (GamesIterator git = games_.begin(); git != games_.end(); ++git)
+    {
+        if (git->getClientStartedIt() == cit || git->getClientAcceptedIt() == cit)
+            gameIds.append(git->getGameId());
+    }
+
+    for (int gameId : gameIds)
+    {
+        GamesIterator gameIt = games_.find(gameId);
+        ClientsIterator enemyIt = gameIt->getClientStartedIt() == cit ? gameIt->getClientAcceptedIt() : gameIt->getClientStartedIt();
+
+        finishGame(gameId);     // незавершённая игра - GAME:STOP обоим
+        games_.remove(gameId);  // завершённая без победителя finishGame не удаляет
+
+        enemyIt->enemy_ = clients_.end();
+    }
+}
+
 void Server::testDB()
 {
     const QString &fileName = ":/placements.txt";
@@ -1115,7 +1635,7 @@ void Server::testDB()
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
     {
-        qWarning() << "Could not open file" << fileName;
+        LOG_WARNING(LOG_CAT_DB) << "Could not open file" << fileName;
         return;
     }
 
@@ -1123,7 +1643,7 @@ void Server::testDB()
     while (!in.atEnd())
     {
         QString line = in.readLine();
-        qDebug() << line << "@";
+        LOG_DEBUG(LOG_CAT_GAME) << line << "@";
         dbController_.addNewPlacement(line);
     }
 
@@ -1132,17 +1652,24 @@ void Server::testDB()
     dbController_.printTable("Fields");
 
 //    QString randomFieldStr = dbController_.getRandomField();
-//    qDebug() << "Random field: " + randomFieldStr;
+//    LOG_DEBUG(LOG_CAT_GAME) << "Random field: " + randomFieldStr;
 
 //    dbController_.clearDatabase();
 //    dbController_.printTable("Fields");
 //    dbController_.printTable("GameEndings");
 }
 
-void Server::sendGamesHistoryListToUsers(QStringList& gamesHistoryList)
+void Server::publishGameEnding(qint64 rowId)
 {
-    QString message = "HISTORY:UPDATE:" + gamesHistoryList.join("$$");
+    if (rowId <= 0)
+        return;
+
+    QString message = "HISTORY:APPEND:" + dbController_.getGameEnding(rowId);   // HISTORY:APPEND:<player1>:<player2>:<field1>:<field2>:<start>:<end>:<winner>
+
+    int nReceivers = broadcast(message, [](const Client& client)
+    {
+        return client.historySubscribed_ && client.status_ != Client::ST_DISCONNECTED;
+    }, TRAFFIC_HISTORY);
 
-    qDebug() << "GameEndings table: " << message;
-    sendMessageToAll(message);
+    LOG_DEBUG(LOG_CAT_GAME) << "Game ending" << rowId << "sent to" << nReceivers << "history subscribers";
 }
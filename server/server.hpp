@@ -13,12 +13,23 @@
 #include <QTcpSocket>
 //#include <QtSerialPort/QSerialPort>
 #include <vector>
-#include <QTextBrowser>
-#include <QLabel>
+#include <random>
 #include "client.hpp"
 #include "gamecontroller.hpp"
 #include "dbcontroller.hpp"
+#include "protocol.hpp"
+#include "command.hpp"
+#include "ioworker.hpp"
+#include "config.hpp"
+#include "timingwheel.hpp"
+#include "placementcorpus.hpp"
+#include "placementgenerator.hpp"
+#include <QThread>
+#include <QVector>
+#include <QHash>
+#include <functional>
 #include <QDateTime>
+#include <QElapsedTimer>
 
 /**
  * @brief Класс сервера
@@ -41,12 +52,41 @@ public:
         ST_STOPPED     ,  ///< Сервер остановлен
     };
 
+    /**
+     * @brief Изменения присутствия пользователей (USER:ADD/UPDATE/REMOVE)
+     */
+    enum PresenceOp
+    {
+        PRESENCE_ADD    = 0,  ///< Пользователь авторизовался
+        PRESENCE_UPDATE    ,  ///< Изменились состояние или готовность
+        PRESENCE_REMOVE    ,  ///< Пользователь вышел
+    };
+
+    /**
+     * @brief Виды исходящих сообщений
+     *
+     * Перегруженному клиенту уходят только обязательные сообщения. Отброшенные
+     * присутствие и история заменяются актуальным состоянием, когда клиент
+     * разгрузится; чат теряется.
+     */
+    enum Traffic
+    {
+        TRAFFIC_CRITICAL = 0,  ///< Авторизация, игра, остановка сервера
+        TRAFFIC_PRESENCE    ,  ///< USERS, USER:*
+        TRAFFIC_CHAT        ,  ///< MESSAGE
+        TRAFFIC_HISTORY     ,  ///< HISTORY
+    };
+
 public:
     /**
      * @brief Конструктор
      * @param port Порт для прослушивания подключений
+     * @param ioThreads Количество потоков ввода-вывода (0 - по числу ядер)
+     * @param dbPath Путь к файлу базы данных
+     * @param corpusPath Путь к набору расстановок (нет файла - расстановки генерируются)
      */
-    Server(quint16 port);
+    Server(quint16 port, int ioThreads = SERVER_IO_THREADS_DEFAULT, const QString& dbPath = SERVER_DB_PATH_DEFAULT,
+           const QString& corpusPath = SERVER_CORPUS_PATH_DEFAULT);
     
     /**
      * @brief Конструктор копирования
@@ -66,8 +106,6 @@ public:
      */
     ~Server();
 
-    QTextBrowser* browser;  ///< Виджет для отображения логов сервера
-
     /**
      * @brief Обновить состояние сервера
      * @param state Новое состояние
@@ -80,33 +118,174 @@ public:
      */
     ServerState getServerState();
 
+    /**
+     * @brief Получить порт, заданный при создании
+     */
+    quint16 getPort() const;
+
     /**
      * @brief Проверить логин пользователя
      * @param login Проверяемый логин
      * @return true если логин валидный
      */
-    bool checkLogin(QString& login);
+    bool checkLogin(const QString& login);
     
     /**
      * @brief Проверить авторизацию пользователя
      * @param login Логин пользователя
      * @return true если пользователь авторизован
      */
-    bool is_logined(QString& login);
+    bool is_logined(const QString& login);
     
     /**
-     * @brief Найти клиента по логину
+     * @brief Найти авторизованного клиента по логину
      * @param login Логин пользователя
-     * @return Итератор на клиента
+     * @return Итератор на клиента или clients_.end()
+     */
+    ClientsIterator findClient(const QString& login);
+
+    /**
+     * @brief Найти клиента по ID
+     * @param clientId ID клиента
+     * @return Итератор на клиента или clients_.end()
      */
-    ClientsIterator findClient(QString& login);
+    ClientsIterator findClient(int clientId);
     
     /**
      * @brief Обработать данные от клиента
-     * @param data Полученные данные
+     * @param data Один полный кадр без разделителя
      * @param clientId ID клиента
      */
-    void handleData(const QByteArray& data, int clientId);
+    void handleData(QByteArrayView data, int clientId);
+
+    /**
+     * @brief Обработать двоичный кадр протокола версии 2
+     * @param frame Кадр без префикса длины (код операции и нагрузка)
+     * @param clientId ID клиента
+     */
+    void handleBinaryData(QByteArrayView frame, int clientId);
+
+    /**
+     * @brief Определить, за какую сторону игры действует клиент
+     * @param gIt Итератор на игру
+     * @param cit Итератор на клиента, приславшего запрос
+     * @param is_ClientStarted Выход: true если клиент начал игру
+     * @return false если клиент в игре не участвует
+     */
+    bool findPlayer(GamesIterator gIt, ClientsIterator cit, bool& is_ClientStarted);
+
+    /**
+     * @brief Принять расстановку кораблей игрока
+     * @param gIt Итератор на игру
+     * @param is_ClientStarted true если расстановка от начавшего игру
+     * @param fieldBinStr Расстановка в виде строки из '0' и '1'
+     */
+    void handleFieldPlacement(GamesIterator gIt, bool is_ClientStarted, const QString& fieldBinStr);
+
+    /**
+     * @brief Принять расстановку списком кораблей (правила игры не классические)
+     * @param gIt Итератор на игру
+     * @param is_ClientStarted true если расстановка от начавшего игру
+     * @param ships Корабли
+     */
+    void handleShipsPlacement(GamesIterator gIt, bool is_ClientStarted, const std::vector<Ship>& ships);
+
+    /**
+     * @brief Засчитать принятую расстановку игрока; когда приняты обе, начинается бой (GAME:FIGHT)
+     * @param gIt Итератор на игру
+     * @param is_ClientStarted true для игрока, начавшего игру
+     */
+    void confirmPlacement(GamesIterator gIt, bool is_ClientStarted);
+
+    /**
+     * @brief Обработать выстрел игрока
+     * @param gIt Итератор на игру
+     * @param is_ClientStarted true если стреляет начавший игру
+     * @param x Координата X
+     * @param y Координата Y
+     */
+    void handleShot(GamesIterator gIt, bool is_ClientStarted, int x, int y);
+
+    /**
+     * @brief Выстрел по полю классических правил (Field)
+     * @param gIt Итератор на игру
+     * @param enemyIt Итератор на владельца поля
+     * @param is_ClientStarted true если стреляет начавший игру
+     * @param x Координата X
+     * @param y Координата Y
+     * @param isGameFinished Уничтожен ли весь флот
+     * @return Результат выстрела
+     */
+    ShotResult shootField(GamesIterator gIt, ClientsIterator enemyIt, bool is_ClientStarted, int x, int y, bool& isGameFinished);
+
+    /**
+     * @brief Выстрел по полю правил из GAME:START (SparseBoard)
+     *
+     * Параметры и результат - как у shootField. Время не зависит от размера
+     * поля, после уничтожения уходят только клетки корабля и ореола.
+     */
+    ShotResult shootBoard(GamesIterator gIt, ClientsIterator enemyIt, bool is_ClientStarted, int x, int y, bool& isGameFinished);
+
+    /**
+     * @brief Добавить готовые байты в исходящий буфер клиента
+     * @param client Получатель
+     * @param data Закодированное сообщение
+     * @param traffic Вид сообщения; необязательные не шлются перегруженному клиенту
+     */
+    void writeToClient(const Client& client, const QByteArray& data, Traffic traffic = TRAFFIC_CRITICAL);
+
+    /**
+     * @brief Отдать накопленные исходящие буферы потокам ввода-вывода, по одной записи на клиента
+     */
+    void flushOutbox();
+
+    /**
+     * @brief Отправить сообщение клиенту в согласованной с ним версии протокола
+     * @param client Получатель
+     * @param message Текстовое сообщение без разделителя
+     * @param traffic Вид сообщения
+     */
+    void sendToClient(const Client& client, const QString& message, Traffic traffic = TRAFFIC_CRITICAL);
+
+    /**
+     * @brief Отбросить необязательное сообщение перегруженному клиенту
+     * @param client Получатель
+     * @param traffic Вид сообщения
+     * @return true если сообщение не нужно отправлять
+     */
+    bool dropIfCongested(const Client& client, Traffic traffic);
+
+    /**
+     * @brief Отправить результат выстрела клиенту
+     * @param client Получатель
+     * @param result Результат выстрела
+     * @param x Координата X
+     * @param y Координата Y
+     */
+    void sendShotResult(const Client& client, ShotResult result, int x, int y);
+
+    /**
+     * @brief Отклонить расстановку клиента: ERROR:FIELD
+     * @param client Получатель
+     */
+    void sendFieldError(const Client& client);
+
+    /**
+     * @brief Отправить клиенту поле отрисовки
+     * @param client Получатель
+     * @param owner Чьё это поле для получателя
+     * @param field Поле
+     */
+    void sendFieldDraw(const Client& client, FieldOwner owner, const Field& field);
+
+    /**
+     * @brief Отправить клиенту изменённые клетки поля отрисовки
+     * @param client Получатель версии 2: клиент версии 1 FIELD:DIFF не знает
+     * @param owner Чьё это поле для получателя
+     * @param ranges Отрезки изменённых клеток
+     * @param area Количество клеток поля; в двоичном кадре клетка - один байт, больше поля идут текстом
+     */
+    void sendFieldDiff(const Client& client, FieldOwner owner, const QVector<CellRange>& ranges, int area = PROTOCOL_FIELD_AREA);
     
     /**
      * @brief Обработать отключение клиента
@@ -115,29 +294,107 @@ public:
     void clientDisconnect(ClientsIterator& cit);
     
     /**
-     * @brief Обработать запрос списка пользователей
+     * @brief Разослать полный список пользователей авторизованным клиентам версии 1
      */
     void handleUsersRequest();
+
+    /**
+     * @brief Получить описание пользователя <login>:<status>:<readiness>
+     */
+    QString getPresenceStr(const Client& client);
+
+    /**
+     * @brief Получить список всех авторизованных пользователей через пробел
+     */
+    QString getUsersListStr();
+
+    /**
+     * @brief Отправить клиенту снимок списка пользователей с текущим номером изменения
+     * @param client Получатель
+     */
+    void sendUsersSnapshot(const Client& client);
+
+    /**
+     * @brief Разослать изменение присутствия клиентам версии 2
+     *
+     * Каждое изменение получает следующий номер; по пропуску номера клиент
+     * понимает, что потерял изменение, и запрашивает снимок (USERS:).
+     * @param op Вид изменения
+     * @param client Пользователь, которого касается изменение
+     */
+    void publishPresence(PresenceOp op, const Client& client);
+
+    /**
+     * @brief Обработчик команды: аргументы после "<command>:" и отправитель
+     */
+    typedef void (Server::*CommandHandler)(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать личное или общее сообщение
+     */
+    void handleMessageRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать запрос авторизации
+     */
+    void handleAuthRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать запрос списка пользователей
+     */
+    void handleUsersRequest(QByteArrayView args, ClientsIterator cit);
     
     /**
      * @brief Обработать запрос обновления состояния
      */
-    void handleUpdateRequest();
+    void handleUpdateRequest(QByteArrayView args, ClientsIterator cit);
     
     /**
      * @brief Обработать запрос готовности к игре
      */
-    void handleReadinessRequest();
+    void handleReadinessRequest(QByteArrayView args, ClientsIterator cit);
     
     /**
      * @brief Обработать запрос на подключение
      */
-    void handleConnectionRequest();
+    void handleConnectionRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать игровую команду (START, FINISH, FIELD, SHOT)
+     */
+    void handleGameRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать запрос истории игр
+     */
+    void handleHistoryRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Отправить страницу истории игр (новые сверху)
+     * @param args <cursor>:<limit>; cursor 0 - первая страница, иначе next_cursor предыдущего ответа
+     * @param cit Итератор на клиента
+     */
+    void handleHistoryPageRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать запрос случайной расстановки
+     */
+    void handleGenerateRequest(QByteArrayView args, ClientsIterator cit);
     
     /**
      * @brief Обработать запрос на выход
      */
-    void handleExitRequest();
+    void handleExitRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Обработать ответ на PING: и обновить время отклика клиента
+     */
+    void handlePongRequest(QByteArrayView args, ClientsIterator cit);
+
+    /**
+     * @brief Вывести статистику обработки команд
+     */
+    void printCommandStats();
     
     /**
      * @brief Обработать запрос состояния поля
@@ -147,40 +404,84 @@ public:
     /**
      * @brief Отправить сообщение всем клиентам
      * @param message Текст сообщения
+     * @param traffic Вид сообщения
+     */
+    void sendMessageToAll(const QString& message, Traffic traffic = TRAFFIC_CRITICAL);
+
+    /**
+     * @brief Условие выбора получателей рассылки
+     */
+    typedef std::function<bool(const Client&)> ClientFilter;
+
+    /**
+     * @brief Разослать сообщение клиентам, подходящим под условие
+     *
+     * Сообщение кодируется один раз для каждой версии протокола,
+     * все получатели разделяют один неизменяемый буфер.
+     * @param message Текст сообщения
+     * @param filter Условие (авторизован, не в игре и т.п.)
+     * @param traffic Вид сообщения
+     * @return Количество получателей
      */
-    void sendMessageToAll(const QString& message);
+    int broadcast(const QString& message, const ClientFilter& filter, Traffic traffic = TRAFFIC_CRITICAL);
     
     /**
-     * @brief Удалить отключенных клиентов
+     * @brief Занять логин за клиентом
+     *
+     * Строка логина хранится один раз: login_ клиента разделяет её с ключом реестра.
+     * @param cit Итератор на клиента
+     * @param login Проверенный checkLogin() логин
+     */
+    void registerLogin(ClientsIterator cit, const QString& login);
+
+    /**
+     * @brief Освободить логин клиента, если он занят этим клиентом
+     * @param cit Итератор на клиента
      */
-    void removeDisconnectedClients();
+    void unregisterLogin(ClientsIterator cit);
     
     /**
      * @brief Отметить уничтоженный корабль
      * @param cIt Итератор на клиента
      * @param x Координата X
      * @param y Координата Y
+     * @return Клетки, отображение которых изменилось
      */
-    void drawKilledShip(ClientsIterator cIt, int x, int y);
+    Bitboard drawKilledShip(ClientsIterator cIt, int x, int y);
     
     /**
-     * @brief Отправить состояние поля пользователям
-     * @param cIt Итератор на клиента
+     * @brief Отправить изменения поля владельцу и противнику
+     *
+     * Уходят только изменённые клетки; если отрезков набралось больше,
+     * чем весит всё поле, отправляется поле целиком.
+     * @param cIt Итератор на клиента - владельца поля
+     * @param changed Изменённые клетки
+     */
+    void sendFieldDiffToUsers(ClientsIterator cIt, const Bitboard& changed);
+
+    /**
+     * @brief Отправить владельцу и противнику уничтоженный корабль SparseBoard
+     *
+     * Отрезки - палубы и ореол по строкам, их число зависит от длины корабля,
+     * а не от размера поля; поле целиком не отправляется никогда.
+     * @param cIt Итератор на клиента - владельца поля
+     * @param ship Номер уничтоженного корабля
      */
-    void sendFieldDrawToUsers(ClientsIterator cIt);
+    void sendBoardDiffToUsers(ClientsIterator cIt, int ship);
     
     /**
-     * @brief Отправить историю игр пользователям
-     * @param gamesHistoryList Список игр
+     * @brief Отправить завершившуюся игру подписчикам истории (HISTORY:APPEND)
+     * @param rowId Номер записи игры в GamesEndings
      */
-    void sendGamesHistoryListToUsers(QStringList& gamesHistoryList);
+    void publishGameEnding(qint64 rowId);
 
     /**
      * @brief Начать игру между двумя игроками
      * @param login1 Логин первого игрока
      * @param login2 Логин второго игрока
+     * @param gameRules Согласованные правила; если хотя бы один клиент версии 1, игра классическая
      */
-    void startGame(QString login1, QString login2);
+    void startGame(QString login1, QString login2, const RuleSet& gameRules = RuleSet::classic());
     
     /**
      * @brief Завершить игру
@@ -188,6 +489,15 @@ public:
      */
     void finishGame(int gameId);
 
+    /**
+     * @brief Остановить игры, в которых участвует клиент
+     *
+     * Противник получает GAME:STOP. Вызывается перед удалением клиента из
+     * clients_: игры хранят итераторы на обоих игроков.
+     * @param cit Итератор на клиента
+     */
+    void stopGamesOf(ClientsIterator cit);
+
     /**
      * @brief Тестирование базы данных
      */
@@ -195,18 +505,68 @@ public:
 
 private:
     quint16 port_;                    ///< Порт сервера
-    QTcpSocket* socket_;              ///< Сокет для подключений
-    QByteArray data_;                 ///< Буфер для данных
+    int ioThreads_;                   ///< Заданное количество потоков ввода-вывода
+    QString dbPath_;                  ///< Путь к файлу базы данных
+    QString corpusPath_;              ///< Путь к набору расстановок
+    int nextClientId_;                ///< ID для следующего подключения
+    int nextWorker_;                  ///< Поток для следующего подключения (по кругу)
+    QVector<QThread*> threads_;       ///< Потоки ввода-вывода
+    QVector<IOWorker*> workers_;      ///< Обработчики сокетов, по одному на поток
+    QThread* placementThread_;        ///< Поток генератора расстановок
+    PlacementWorker* placementWorker_;        ///< Генератор расстановок в своём потоке
+    PlacementGenerator placementGenerator_;   ///< Запасной генератор в потоке сервера (пул пуст)
+    QStringList placementPool_;       ///< Готовые расстановки для GENERATE:
+    bool placementRequested_;         ///< Пополнение пула уже заказано
+    PlacementCorpus corpus_;          ///< Готовые расстановки из файла, отображённого в память
+    std::mt19937_64 shipsRandom_;     ///< Генератор расстановок для правил из GAME:START
+
+    /**
+     * @brief Накопленные за проход цикла событий исходящие данные клиента
+     */
+    struct PendingWrite
+    {
+        IOWorker* worker_ = nullptr;  ///< Поток, владеющий сокетом
+        QByteArrayList chunks_;       ///< Сообщения по порядку (буферы рассылок разделяются, не копируются)
+    };
+
+    QHash<int, PendingWrite> outbox_; ///< Исходящие буферы по ID клиента
+    bool flushScheduled_;             ///< flushOutbox() уже поставлен в очередь
+    QHash<int, quint8> congested_;    ///< Перегруженные клиенты по ID: биты (1 << Traffic) отброшенных сообщений
+    quint64 presenceSeq_;             ///< Номер последнего изменения присутствия
     Clients clients_;                 ///< Список подключенных клиентов
-    QMap<quintptr, QString> logins_;  ///< Маппинг сокетов к логинам
+
+    // итераторы QMap не меняются при вставке и удалении других клиентов, поэтому индексы хранят их
+    QHash<int, ClientsIterator> sessions_;    ///< Клиенты по ID
+    QHash<QString, ClientsIterator> logins_;  ///< Авторизованные клиенты по логину
+
     ServerState state_;               ///< Текущее состояние сервера
-    int timerId_;                     ///< ID таймера
+    int timerId_;                     ///< ID таймера колеса проверки живости
+    QElapsedTimer clock_;             ///< Монотонные часы сервера для lastSeen_ и RTT
+    TimingWheel heartbeatWheel_;      ///< Сроки проверки живости сессий
     Games games_;                     ///< Активные игры
     DBController dbController_;       ///< Контроллер базы данных
+    CommandStats commandStats_[CMD_COUNT];  ///< Статистика по командам
+
+    static const CommandHandler commandHandlers_[CMD_COUNT];  ///< Обработчики команд по коду
 
 protected:
     /**
-     * @brief Обработчик таймера
+     * @brief Запустить потоки ввода-вывода
+     */
+    void startWorkers();
+
+    /**
+     * @brief Закрыть все соединения и остановить потоки ввода-вывода
+     */
+    void stopWorkers();
+
+    /**
+     * @brief Заказать генератору пополнение пула расстановок, если пул опустел наполовину
+     */
+    void requestPlacements();
+
+    /**
+     * @brief Тик колеса проверки живости: PING: молчащим клиентам, отключение не ответивших
      * @param event Событие таймера
      */
     void timerEvent(QTimerEvent* event);
@@ -214,9 +574,9 @@ protected:
 public slots:
     /**
      * @brief Запустить сервер
-     * @param textBrowser Виджет для логов
+     * @return false если не удалось занять порт
      */
-    void startServer(QTextBrowser* textBrowser);
+    bool startServer();
     
     /**
      * @brief Остановить сервер
@@ -230,25 +590,41 @@ public slots:
     void incomingConnection(qintptr socketDescriptor);
     
     /**
-     * @brief Обработчик установки соединения
+     * @brief Обработчик кадров, выделенных потоком ввода-вывода
+     * @param clientId ID клиента
+     * @param binary true если кадры двоичные
+     * @param batch Байты пачки кадров
+     * @param frames Положение кадров в batch
      */
-    void on_sockConnect();
-    
+    void on_framesReceived(int clientId, bool binary, const QByteArray& batch, const QList<FrameSpan>& frames);
+
     /**
-     * @brief Обработчик получения данных
+     * @brief Обработчик готовых расстановок генератора
+     * @param fields Упакованные расстановки
      */
-    void on_receiveData();
+    void on_placementsGenerated(const QStringList& fields);
     
     /**
-     * @brief Обработчик отключения
+     * @brief Обработчик отключения клиента
+     * @param clientId ID клиента
      */
-    void on_sockDisconnect();
+    void on_clientDisconnected(int clientId);
     
     /**
      * @brief Обработчик ошибок сокета
+     * @param clientId ID клиента
      * @param error Код ошибки
      */
-    void on_sockError(QAbstractSocket::SocketError error);
+    void on_clientError(int clientId, QAbstractSocket::SocketError error);
+
+    /**
+     * @brief Обработчик перехода исходящего буфера клиента через порог
+     *
+     * При разгрузке клиенту досылается актуальное состояние вместо отброшенного.
+     * @param clientId ID клиента
+     * @param congested true если буфер выше верхнего порога
+     */
+    void on_clientCongested(int clientId, bool congested);
 };
 
 #endif // SERVER_H
@@ -0,0 +1,51 @@
+# Server logic shared by the GUI (server.pro) and headless (server-headless.pro) builds.
+# Nothing here may depend on QtWidgets.
+
+QT += core network sql
+
+CONFIG += c++17
+
+# Уровень журнала задаётся при компиляции (logger.hpp): 0 - DEBUG, 1 - INFO, 2 - WARNING, 3 - ERROR
+# DEFINES += LOG_MIN_LEVEL=0
+
+INCLUDEPATH += $$PWD $$PWD/../common
+
+include($$PWD/../core/seabattle-core.pri)
+
+SOURCES += \
+    $$PWD/client.cpp \
+    $$PWD/command.cpp \
+    $$PWD/dbcontroller.cpp \
+    $$PWD/field.cpp \
+    $$PWD/gamecontroller.cpp \
+    $$PWD/ioworker.cpp \
+    $$PWD/logger.cpp \
+    $$PWD/placementcorpus.cpp \
+    $$PWD/placementgenerator.cpp \
+    $$PWD/server.cpp \
+    $$PWD/timingwheel.cpp \
+    $$PWD/../common/framedecoder.cpp \
+    $$PWD/../common/protocol.cpp
+
+HEADERS += \
+    $$PWD/client.hpp \
+    $$PWD/command.hpp \
+    $$PWD/config.hpp \
+    $$PWD/dbcontroller.hpp \
+    $$PWD/field.hpp \
+    $$PWD/gamecontroller.hpp \
+    $$PWD/ioworker.hpp \
+    $$PWD/logger.hpp \
+    $$PWD/placementcorpus.hpp \
+    $$PWD/placementgenerator.hpp \
+    $$PWD/server.hpp \
+    $$PWD/timingwheel.hpp \
+    $$PWD/../common/framedecoder.hpp \
+    $$PWD/../common/protocol.hpp
+
+RESOURCES += \
+    $$PWD/database.qrc
+
+DISTFILES += \
+    $$PWD/placements.txt  \
+    $$PWD/data.db
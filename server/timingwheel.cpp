@@ -0,0 +1,38 @@
+#include "timingwheel.hpp"
+
+TimingWheel::TimingWheel(int nSlots, int tickMs) :
+    slots_(nSlots),
+    current_(0),
+    tickMs_(tickMs)
+{
+
+}
+
+void TimingWheel::schedule(int id, qint64 delayMs)
+{
+    qint64 ticks = (delayMs + tickMs_ - 1) / tickMs_;
+
+    // ячейка current_ уже ждёт ближайшего тика, дальше оборота колесо не заглядывает
+    if (ticks < 0)
+        ticks = 0;
+    if (ticks > slots_.size() - 1)
+        ticks = slots_.size() - 1;
+
+    int slot = (current_ + (int)ticks) % slots_.size();
+    slots_[slot].append(id);
+}
+
+QVector<int> TimingWheel::advance()
+{
+    QVector<int> due;
+    due.swap(slots_[current_]);
+
+    current_ = (current_ + 1) % slots_.size();
+
+    return due;
+}
+
+int TimingWheel::getTickMs() const
+{
+    return tickMs_;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file timingwheel.hpp
+ * @brief Хешированное колесо таймеров
+ *
+ * Колесо из N ячеек, каждая покрывает один тик. Поставить срок - добавить ID
+ * в ячейку (текущая + задержка) % N, тик - забрать одну ячейку целиком.
+ * Обе операции O(1) и не зависят от числа сессий. Задержка не длиннее
+ * оборота колеса, поэтому счётчик оборотов не нужен. Снятие со срока
+ * ленивое: владелец колеса сам пропускает ID, которых уже нет.
+ */
+
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QVector>
+
+/**
+ * @brief Класс колеса таймеров
+ */
+class TimingWheel
+{
+public:
+    /**
+     * @brief Конструктор
+     * @param nSlots Количество ячеек (оборот колеса = nSlots * tickMs)
+     * @param tickMs Длительность тика в миллисекундах
+     */
+    TimingWheel(int nSlots, int tickMs);
+
+    /**
+     * @brief Поставить срок
+     * @param id ID сессии
+     * @param delayMs Через сколько миллисекунд; округляется вверх до тика и ограничивается оборотом колеса
+     */
+    void schedule(int id, qint64 delayMs);
+
+    /**
+     * @brief Повернуть колесо на один тик
+     * @return ID, срок которых наступил (возможно, уже удалённых)
+     */
+    QVector<int> advance();
+
+    /**
+     * @brief Получить длительность тика
+     */
+    int getTickMs() const;
+
+private:
+    QVector<QVector<int>> slots_;   ///< Ячейки колеса
+    int current_;                   ///< Ячейка, которую заберёт следующий тик
+    int tickMs_;                    ///< Длительность тика
+};
+
+#endif // TIMINGWHEEL_H